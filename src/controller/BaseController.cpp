@@ -6,3 +6,7 @@
 // Project
 
 void BaseController::setDebuggingLevel(loggingLevel_e level) { _logging = level; }
+
+#ifdef CONTROLLER_PROFILING
+ControllerStats &BaseController::getStats() { return _stats; }
+#endif
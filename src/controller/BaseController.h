@@ -8,14 +8,20 @@
 #include "../logger/logging.h"
 #include "../validator/McValidator.h"
 #include "../validator/McValidatorEsp32.h"
+#include "ControllerStats.h"
 
 /**
  * @brief Abstract class for controlling active modules
+ *
+ * Controllers handled every cycle can also be called without virtual dispatch via ControllerRegistry
  */
 class BaseController {
    protected:
     loggingLevel_e _logging = NONE;                 // Logging level, no logging by default
     McValidator _mcValidator = McValidatorEsp32();  // Microcontroller-Validator for checking pin setup
+#ifdef CONTROLLER_PROFILING
+    ControllerStats _stats;  // Timing statistics of handle(), filled via PROFILE_HANDLE()
+#endif
    public:
     // TODO
     // void logPrint(loggingLevel_e currentLevel, loggingLevel_e messageLevel, char* message, ...);
@@ -23,12 +29,12 @@ class BaseController {
     /**
      * @brief Initialises the controller, for example by setting pins
      */
-    virtual void init();
+    virtual void init() = 0;
 
     /**
      * @brief Called repeatedly, handles states and changes
      */
-    virtual void handle();
+    virtual void handle() = 0;
 
     /**
      * @brief Check whether controller was initialised and is in a valid state
@@ -36,8 +42,13 @@ class BaseController {
      * @return true controller initialised and ready
      * @return false controller not ready
      */
-    virtual bool isReady();
+    virtual bool isReady() = 0;
 
     // Setter-method
     void setDebuggingLevel(loggingLevel_e level);
+
+#ifdef CONTROLLER_PROFILING
+    // Getter-method
+    ControllerStats &getStats();
+#endif
 };
@@ -0,0 +1,101 @@
+#pragma once
+
+// Related
+// System / External
+#include <stddef.h>
+#include <type_traits>
+// Selfmade
+// Project
+#include "BaseController.h"
+
+/**
+ * @brief Fixed collection of controllers that runs their lifecycle without virtual dispatch
+ *
+ * The types of all controllers are known at compile time, so every call is qualified with the concrete type and can be inlined. The
+ * recursion over the controllers unrolls into one call per controller:
+ *     auto machine = makeControllerRegistry(program, puller, spool, ferrari);
+ *     machine.init();    // in setup()
+ *     machine.handle();  // in loop(), calls program.handle(), puller.handle(), ... in this order
+ *
+ * The controllers are referenced, not copied, and can still be called directly.
+ *
+ * @tparam Controllers types derived from BaseController
+ */
+template <class... Controllers>
+class ControllerRegistry;
+
+/**
+ * @brief End of the recursion, an empty registry
+ *
+ */
+template <>
+class ControllerRegistry<> {
+   public:
+    static constexpr size_t COUNT = 0;  // Number of controllers
+
+    void init() {}
+
+    void handle() {}
+
+    bool isReady() { return true; }
+};
+
+template <class First, class... Rest>
+class ControllerRegistry<First, Rest...> {
+    static_assert(std::is_base_of<BaseController, First>::value, "Controllers have to be derived from BaseController");
+
+   private:
+    First &_first;                      // Controller called first
+    ControllerRegistry<Rest...> _rest;  // Controllers called afterwards
+
+   public:
+    static constexpr size_t COUNT = 1 + sizeof...(Rest);  // Number of controllers
+
+    /**
+     * @brief Constructor
+     *
+     * @param first controller called first
+     * @param rest controllers called afterwards, in this order
+     */
+    ControllerRegistry(First &first, Rest &...rest) : _first(first), _rest(rest...) {}
+
+    /**
+     * @brief Initialise all controllers in order
+     *
+     */
+    void init() {
+        _first.First::init();
+        _rest.init();
+    }
+
+    /**
+     * @brief Call handle() of all controllers in order, call repeatedly
+     *
+     */
+    void handle() {
+        _first.First::handle();
+        _rest.handle();
+    }
+
+    /**
+     * @brief Check whether all controllers are ready
+     *
+     * @return true every controller is ready
+     * @return false at least one controller is not ready
+     */
+    bool isReady() { return _first.First::isReady() && _rest.isReady(); }
+};
+
+template <class First, class... Rest>
+constexpr size_t ControllerRegistry<First, Rest...>::COUNT;
+
+/**
+ * @brief Create a registry without spelling out the controller types
+ *
+ * @param controllers controllers in the order they are called
+ * @return ControllerRegistry<Controllers...> registry referencing the controllers
+ */
+template <class... Controllers>
+ControllerRegistry<Controllers...> makeControllerRegistry(Controllers &...controllers) {
+    return ControllerRegistry<Controllers...>(controllers...);
+}
@@ -0,0 +1,73 @@
+// Related
+#include "ControllerStats.h"
+// System / External
+#include <Arduino.h>
+#include <string.h>
+// Selfmade
+// Project
+#include "../logger/logging.h"
+
+#ifdef CONTROLLER_PROFILING
+
+ControllerStats::ControllerStats() { reset(); }
+
+uint8_t ControllerStats::durationToBucket(uint32_t durationUs) {
+    if (durationUs < 2) return 0;
+    uint8_t bucket = 31 - __builtin_clz(durationUs);
+    return bucket < CONTROLLER_STATS_BUCKETS ? bucket : CONTROLLER_STATS_BUCKETS - 1;
+}
+
+void ControllerStats::start(uint32_t nowUs) {
+    _currentStartUs = nowUs;
+    if (_stats.calls > 0) {
+        uint32_t intervalUs = nowUs - _lastStartUs;  // unsigned arithmetic handles the micros()-overflow
+        if (intervalUs > _stats.intervalMaxUs) _stats.intervalMaxUs = intervalUs;
+        _stats.intervalSumUs += intervalUs;
+        _stats.intervalHistogram[durationToBucket(intervalUs)]++;
+    }
+    _lastStartUs = nowUs;
+}
+
+void ControllerStats::stop(uint32_t nowUs) {
+    uint32_t executionUs = nowUs - _currentStartUs;
+    _stats.calls++;
+    if (executionUs > _stats.executionMaxUs) _stats.executionMaxUs = executionUs;
+    _stats.executionSumUs += executionUs;
+    _stats.executionHistogram[durationToBucket(executionUs)]++;
+    if (_budgetUs > 0 && executionUs > _budgetUs) _stats.overruns++;
+}
+
+void ControllerStats::reset() { memset(&_stats, 0, sizeof(_stats)); }
+
+void ControllerStats::print() {
+    logPrint(INFO, INFO, "{stats: {calls: %u, overruns: %u, budgetUs: %u, execution: {meanUs: %.1f, maxUs: %u, hist: [", _stats.calls,
+             _stats.overruns, _budgetUs, getExecutionMeanUs(), _stats.executionMaxUs);
+    for (uint8_t i = 0; i < CONTROLLER_STATS_BUCKETS; ++i) {
+        logPrint(INFO, INFO, "%u%s", _stats.executionHistogram[i], (i == CONTROLLER_STATS_BUCKETS - 1 ? "" : ","));
+    }
+    logPrint(INFO, INFO, "]}, interval: {meanUs: %.1f, maxUs: %u, hist: [", getIntervalMeanUs(), _stats.intervalMaxUs);
+    for (uint8_t i = 0; i < CONTROLLER_STATS_BUCKETS; ++i) {
+        logPrint(INFO, INFO, "%u%s", _stats.intervalHistogram[i], (i == CONTROLLER_STATS_BUCKETS - 1 ? "" : ","));
+    }
+    logPrint(INFO, INFO, "]}}}\n");
+}
+
+controllerStats_s ControllerStats::getStats() { return _stats; }
+
+float ControllerStats::getExecutionMeanUs() {
+    if (_stats.calls == 0) return 0;
+    return (float)_stats.executionSumUs / _stats.calls;
+}
+
+float ControllerStats::getIntervalMeanUs() {
+    if (_stats.calls < 2) return 0;
+    return (float)_stats.intervalSumUs / (_stats.calls - 1);
+}
+
+void ControllerStats::setBudget(uint32_t budgetUs) { _budgetUs = budgetUs; }
+
+ControllerStatsScope::ControllerStatsScope(ControllerStats &stats) : _stats(stats) { _stats.start(micros()); }
+
+ControllerStatsScope::~ControllerStatsScope() { _stats.stop(micros()); }
+
+#endif
@@ -0,0 +1,113 @@
+#pragma once
+
+// Related
+// System / External
+#include <stdint.h>
+// Selfmade
+// Project
+#include "../utils/AllocationGuard.h"
+
+const uint8_t CONTROLLER_STATS_BUCKETS = 16;  // Histogram buckets, bucket i counts [2^i, 2^(i+1)) us, the last one everything above
+
+/**
+ * @brief Collected timing statistics of the handle()-calls of a controller
+ *
+ */
+struct controllerStats_s {
+    uint32_t calls;                                          // Number of measured handle()-calls
+    uint32_t overruns;                                       // Number of calls exceeding the execution budget
+    uint32_t executionMaxUs;                                 // Longest execution time in us
+    uint64_t executionSumUs;                                 // Sum of all execution times in us, used for the mean value
+    uint32_t intervalMaxUs;                                  // Longest time between the start of two consecutive calls in us
+    uint64_t intervalSumUs;                                  // Sum of all intervals in us, used for the mean value
+    uint32_t executionHistogram[CONTROLLER_STATS_BUCKETS];  // Log-scaled histogram of execution times
+    uint32_t intervalHistogram[CONTROLLER_STATS_BUCKETS];   // Log-scaled histogram of call intervals
+};
+
+/**
+ * @brief Fixed-size timing statistics for the handle()-loop of a controller, only compiled in when CONTROLLER_PROFILING is defined
+ *
+ */
+class ControllerStats {
+   private:
+    controllerStats_s _stats;    // Collected statistics
+    uint32_t _budgetUs = 0;      // Maximum execution time before a call counts as overrun, 0 = no overrun detection
+    uint32_t _lastStartUs = 0;   // micros() at the start of the previous call
+    uint32_t _currentStartUs = 0;  // micros() at the start of the running call
+
+    /**
+     * @brief Find the histogram bucket of a duration
+     *
+     * @param durationUs duration in us
+     * @return uint8_t index of the log-scaled bucket
+     */
+    static uint8_t durationToBucket(uint32_t durationUs);
+
+   public:
+    ControllerStats();
+
+    /**
+     * @brief Mark the start of a handle()-call and record the interval since the previous call
+     *
+     * @param nowUs current micros()
+     */
+    void start(uint32_t nowUs);
+
+    /**
+     * @brief Mark the end of a handle()-call and record its execution time
+     *
+     * @param nowUs current micros()
+     */
+    void stop(uint32_t nowUs);
+
+    /**
+     * @brief Clear all collected statistics, the budget is kept
+     *
+     */
+    void reset();
+
+    /**
+     * @brief Print the collected statistics via logPrint
+     *
+     */
+    void print();
+
+    // Getter-method
+    controllerStats_s getStats();
+
+    // Getter-method, mean execution time in us
+    float getExecutionMeanUs();
+
+    // Getter-method, mean interval between calls in us
+    float getIntervalMeanUs();
+
+    /**
+     * @brief Set the maximum execution time of handle() before it counts as overrun
+     *
+     * @param budgetUs budget in us, 0 disables overrun detection
+     */
+    void setBudget(uint32_t budgetUs);
+};
+
+/**
+ * @brief Measures the lifetime of its scope as one handle()-call, use via PROFILE_HANDLE()
+ *
+ */
+class ControllerStatsScope {
+   private:
+    ControllerStats &_stats;  // Statistics to be updated
+
+   public:
+    ControllerStatsScope(ControllerStats &stats);
+    ~ControllerStatsScope();
+};
+
+// Place at the beginning of handle() to measure it and guard against allocations, compiles to nothing unless CONTROLLER_PROFILING or
+// ALLOCATION_GUARD is defined
+#ifdef CONTROLLER_PROFILING
+#define PROFILE_HANDLE() \
+    GUARD_HANDLE();      \
+    ControllerStatsScope _profileScope(_stats)
+#else
+#define PROFILE_HANDLE() GUARD_HANDLE()
+#endif
@@ -0,0 +1,23 @@
+#pragma once
+
+// Related
+// System / External
+#include <stdint.h>
+// Selfmade
+// Project
+#include "dcmotor/DcMotor.h"
+#include "heater/HeatController.h"
+#include "stepper/Stepper.h"
+
+/**
+ * @brief Controllers of a machine, addressed by their index in the arrays. Shared by everything that drives the machine from outside,
+ * e.g. programs or command interfaces, so all of them agree on the numbering
+ */
+struct machineControllers_s {
+    Stepper **steppers;        // Stepper axes, may be NULL if stepperCount is 0
+    uint8_t stepperCount;      // Number of entries in steppers
+    HeatController **heaters;  // Heat controllers, may be NULL if heaterCount is 0
+    uint8_t heaterCount;       // Number of entries in heaters
+    DcMotor **motors;          // DC motors, may be NULL if motorCount is 0
+    uint8_t motorCount;        // Number of entries in motors
+};
@@ -54,6 +54,7 @@ void DcMotor::brake() {
 float DcMotor::getCurrentSpeed() { return _currentSpeedRpm; }
 
 void DcMotor::handle() {
+    PROFILE_HANDLE();
     if (_braking && _currentMode == LEFT && _lastTicks > _ticks)
         off();
     else if (_braking && _currentMode == RIGHT && _lastTicks < _ticks)
@@ -66,11 +67,15 @@ void DcMotor::handle() {
 
         char mode[10];
         modeToString(_currentMode, mode);
-        logPrint(LOG_LEVEL, INFO, "dcMotor: {id: '%s', rpm: %.2f, position: %i, mode: %s}\n", _config.motorId, _currentSpeedRpm, _ticks,
+        logPrint(_logging, INFO, "dcMotor: {id: '%s', rpm: %.2f, position: %i, mode: %s}\n", _config.motorId, _currentSpeedRpm, _ticks,
                  mode);
     }
 }
 
+void IRAM_ATTR DcMotor::onEncoderInterrupt(void* motor) { ((DcMotor*)motor)->handleInterrupt(); }
+
+void DcMotor::init() { init(NULL); }
+
 void DcMotor::init(void (*interrupt)()) {
     Serial.begin(115200);
     pinMode(_config.pins.rightTurn, OUTPUT);
@@ -78,5 +83,12 @@ void DcMotor::init(void (*interrupt)()) {
     pinMode(_config.pins.encoderA, INPUT_PULLUP);
     pinMode(_config.pins.encoderB, INPUT_PULLUP);
 
-    attachInterrupt(digitalPinToInterrupt(_config.pins.encoderA), interrupt, FALLING);
+    if (interrupt == NULL) {
+        attachInterruptArg(digitalPinToInterrupt(_config.pins.encoderA), onEncoderInterrupt, this, FALLING);
+    } else {
+        attachInterrupt(digitalPinToInterrupt(_config.pins.encoderA), interrupt, FALLING);
+    }
+    _initialised = true;
 }
+
+bool DcMotor::isReady() { return _initialised; }
@@ -2,8 +2,6 @@
 #include "../../logger/logging.h"
 #include "../BaseController.h"
 
-enum mode_e { LEFT, RIGHT, OFF };
-
 /**
  * @brief Stepper hardware config that can not be changed
  *
@@ -19,11 +17,11 @@ struct motorConfiguration_s {
     } pins;
 };
 
-// TODO: inherit from BaseController although we have no ready() and different init() method
-class DcMotor {
+class DcMotor : public BaseController {
    private:
+    enum mode_e { LEFT, RIGHT, OFF };  // Class scoped, so it does not collide with stepperMode_e when both are included
+
     const uint16_t MEASURE_INTERVAL_MS = 10;  // interval at which current speed is recalculated
-    const loggingLevel_e LOG_LEVEL = INFO;    // class internal logging level
 
     // volatile variables can be written in ISR and main loop without beeing optimized away by compiler
     // int32 allows to run at full speed in one direction for 16 days straight
@@ -34,6 +32,14 @@ class DcMotor {
     unsigned long _lastMillis = 0;
     float _currentSpeedRpm = 0;
     motorConfiguration_s _config;
+    bool _initialised = false;  // Flag whether pins and interrupt have been set up
+
+    /**
+     * @brief Interrupt service routine of encoder A, forwards to the motor instance
+     *
+     * @param motor instance the interrupt belongs to
+     */
+    static void onEncoderInterrupt(void* motor);
 
     /**
      * @brief Convert current mode to string for logging
@@ -52,13 +58,26 @@ class DcMotor {
     void handle();
 
     /**
-     * @brief initialize motor pins and interrupts like arduino setup function
+     * @brief initialize motor pins and interrupts like arduino setup function, the encoder interrupt is bound to this instance
+     *
+     */
+    void init();
+
+    /**
+     * @brief initialize motor pins and interrupts with an own forwarding function, kept for existing sketches
      *
      * @param interrupt forwarding function of handleInterrupt() of current instance
-     * needed because otherwise there is not possibility for the interrupt to know on which class instance the method should be called
      */
     void init(void (*interrupt)());
 
+    /**
+     * @brief Check whether motor was initialised
+     *
+     * @return true pins and interrupt are set up
+     * @return false init() was not called yet
+     */
+    bool isReady();
+
     /**
      * @brief Increment interrupt counter on interrupt immediately, no heavy lifting here
      *
@@ -33,6 +33,14 @@ HeatController::HeatController(heaterControllerParameters_s config) {
 
 void HeatController::setTargetTemperature(float temperature) { _config.targetTemp = temperature > 350 ? 350 : temperature; }
 
+float HeatController::getCurrentTemperature() { return _currentTemperature; }
+
+float HeatController::getTargetTemperature() { return _config.targetTemp; }
+
+float HeatController::getPidValue() { return _pidValue; }
+
+bool HeatController::isHeating() { return _heatingState; }
+
 void HeatController::start() {
     if (!isReady()) return;
     _controllerState = ACTIVE;
@@ -93,6 +101,7 @@ void HeatController::activateHeater(bool active, bool updateStates) {
 }
 
 void HeatController::handle() {
+    PROFILE_HANDLE();
     if (!isReady() || _controllerState != ACTIVE) return;
     uint64_t now = millis();
 
@@ -100,6 +109,7 @@ void HeatController::handle() {
     if (_timestampSensorPrepare >= _timestampSensorRead && timeDifference(_timestampSensorPrepare, now) >= 1) {
         // Measure temperature and redo calculations
         float currentTemperature = readSensor();
+        _currentTemperature = currentTemperature;
         calculatePid(currentTemperature, now, _timestampSensorRead);
         _timestampSensorRead = now;  // safe readtime AFTER, since the algorithm needs the old value to calculate the difference
     }
@@ -2,6 +2,7 @@
 
 // Related
 // System / External
+#include <math.h>
 // Selfmade
 // Project
 #include "../../logger/logging.h"
@@ -43,6 +44,7 @@ class HeatController : public BaseController {
     uint64_t _timestampSensorPrepare;      // millis()-timestamp since last preparation of temperature measurement
     uint64_t _timestampSensorRead;         // millis()-timestamp since last temperature measurement
     uint64_t _timestampHeatingChange = 0;  // millis()-timestamp of last change(activation / deactivation) of the heating module
+    float _currentTemperature = NAN;       // Last measured temperature in degree celsius, NAN if not measured (yet)
 
     // Variables of the pid-algorithm
     float _pidPreviousError = 0;  // Parameter of the pid-algorithm
@@ -121,6 +123,22 @@ class HeatController : public BaseController {
      */
     void setTargetTemperature(float temperature);
 
+    /**
+     * @brief Getter-method for the last measured temperature, only measured while the controller is active
+     *
+     * @return float temperature in degree celsius, NAN if not measured yet or if the thermocouple is disconnected
+     */
+    float getCurrentTemperature();
+
+    // Getter-method, temperature to be maintained in degree celsius
+    float getTargetTemperature();
+
+    // Getter-method, heating time per activation cycle in ms as calculated by the PID-algorithm
+    float getPidValue();
+
+    // Getter-method, true while the heating element is switched on
+    bool isHeating();
+
     /**
      * @brief (De-)Activate the heating module
      *
@@ -0,0 +1,77 @@
+#pragma once
+
+// Related
+// System / External
+#include <stdint.h>
+// Selfmade
+// Project
+#include "../../validator/McValidatorEsp32.h"
+#include "Stepper.h"
+#include "StepperCycle.h"
+#include "StepperUnits.h"
+
+/**
+ * @brief Stepper whose configuration is fixed at compile time
+ *
+ * Config is a type providing the configuration through a constexpr function, so the pin setup is checked by the compiler and the
+ * conversion factors are known before the controller runs:
+ *     struct FerrariConfig {
+ *         static constexpr stepperConfiguration_s configuration() { return {.stepperId = "ferrari", ...}; }
+ *     };
+ *     ConfiguredStepper<FerrariConfig> ferrari = ConfiguredStepper<FerrariConfig>(&engine);
+ *
+ * Behaves exactly like a Stepper constructed with the same configuration. handle() runs the same cycle with ConfiguredUnitFactors, so
+ * the rpm and mm conversions of the status, the ramp generator and the queued motion use the factors as constants. The commands given
+ * between the cycles convert with the factors of the instance. Each configuration adds its own copy of the cycle to the firmware
+ *
+ * @tparam Config type with a static constexpr stepperConfiguration_s configuration()
+ */
+template <class Config>
+class ConfiguredStepper : public Stepper {
+   private:
+    typedef StepperUnits<ConfiguredUnitFactors<Config>> ConfiguredStepperUnits;  // Conversion with the factors as constants
+
+    static constexpr stepperConfiguration_s CONFIG = Config::configuration();
+
+    /**
+     * @brief Check whether a value is a power of two
+     *
+     * @param value value to be checked
+     * @return true value is 1, 2, 4, ...
+     * @return false value is 0 or no power of two
+     */
+    static constexpr bool isPowerOfTwo(uint16_t value) { return value != 0 && (value & (value - 1)) == 0; }
+
+    static_assert(isEsp32DigitalPin(CONFIG.pins.en) && isEsp32DigitalPin(CONFIG.pins.dir) && isEsp32DigitalPin(CONFIG.pins.step) &&
+                      isEsp32DigitalPin(CONFIG.pins.cs),
+                  "Stepper pins have to be digital pins");
+    static_assert(CONFIG.pins.diag == 0 || isEsp32DigitalPin(CONFIG.pins.diag), "DIAG pin has to be a digital pin or 0");
+    static_assert(CONFIG.pins.dir != CONFIG.pins.step && CONFIG.pins.dir != CONFIG.pins.cs && CONFIG.pins.step != CONFIG.pins.cs &&
+                      CONFIG.pins.en != CONFIG.pins.dir && CONFIG.pins.en != CONFIG.pins.step && CONFIG.pins.en != CONFIG.pins.cs,
+                  "Stepper pins have to be distinct");
+    static_assert(isPowerOfTwo(CONFIG.microstepsPerStep) && CONFIG.microstepsPerStep <= 256, "Microsteps have to be 1, 2, 4, ..., 256");
+    static_assert(CONFIG.stall >= -64 && CONFIG.stall <= 63, "Stall value has to be within -64...63");
+    static_assert(ConfiguredUnitFactors<Config>::MICROSTEPS_PER_ROTATION >= 1, "Steps per rotation have to be positive");
+
+   public:
+    /**
+     * @brief Constructor
+     *
+     * @param engine engine generating the step signals
+     */
+    ConfiguredStepper(FastAccelStepperEngine *engine) : Stepper(CONFIG, engine) {}
+
+    /**
+     * @brief Initialise controller, the pins were already checked by the compiler
+     */
+    void init() { configure(); }
+
+    /**
+     * @brief Manages states and transitions like Stepper::handle(), with the conversion factors as constants
+     *
+     */
+    void handle() { handleCycle(ConfiguredStepperUnits()); }
+};
+
+template <class Config>
+constexpr stepperConfiguration_s ConfiguredStepper<Config>::CONFIG;
@@ -0,0 +1,31 @@
+// Related
+#include "HomingGroup.h"
+// System / External
+#include <stdint.h>
+// Selfmade
+// Project
+
+bool HomingGroup::add(Stepper *stepper) {
+    if (stepper == NULL || _stepperCount >= HOMING_GROUP_MAX_STEPPERS) return false;
+    _steppers[_stepperCount++] = stepper;
+    return true;
+}
+
+void HomingGroup::start() {
+    for (uint8_t i = 0; i < _stepperCount; ++i) {
+        _steppers[i]->moveHome(_steppers[i]->getHoming().getSpeed());
+    }
+    _started = true;
+}
+
+bool HomingGroup::isHomed() { return _started && getHomedCount() == _stepperCount; }
+
+bool HomingGroup::isHoming() { return _started && getHomedCount() < _stepperCount; }
+
+uint8_t HomingGroup::getHomedCount() {
+    uint8_t homed = 0;
+    for (uint8_t i = 0; i < _stepperCount; ++i) {
+        if (_steppers[i]->isHomed()) homed++;
+    }
+    return homed;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+// Related
+// System / External
+#include <stdint.h>
+// Selfmade
+// Project
+#include "Stepper.h"
+
+const uint8_t HOMING_GROUP_MAX_STEPPERS = 8;  // Maximum number of steppers in one group
+
+/**
+ * @brief Homes several independent axes at the same time, each with its own homing configuration
+ *
+ * The steppers keep being handled by their own handle()-calls, the group only starts the homing and tracks its progress.
+ */
+class HomingGroup {
+   private:
+    Stepper *_steppers[HOMING_GROUP_MAX_STEPPERS];  // Axes of the group
+    uint8_t _stepperCount = 0;                      // Number of axes in the group
+    bool _started = false;                          // Flag whether homing was started
+
+   public:
+    /**
+     * @brief Add a stepper to the group
+     *
+     * @param stepper stepper to be added
+     * @return true added
+     * @return false group full
+     */
+    bool add(Stepper *stepper);
+
+    /**
+     * @brief Start homing all steppers of the group in parallel, using the homing configuration of each stepper
+     *
+     */
+    void start();
+
+    /**
+     * @brief Check whether all steppers of the group are homed
+     *
+     * @return true every axis knows its position
+     * @return false homing was not started or at least one axis is still homing
+     */
+    bool isHomed();
+
+    /**
+     * @brief Check whether the group is currently homing
+     *
+     * @return true homing was started and at least one axis is not homed yet
+     * @return false idle or done
+     */
+    bool isHoming();
+
+    // Getter-method, number of already homed axes
+    uint8_t getHomedCount();
+};
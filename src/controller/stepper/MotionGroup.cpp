@@ -0,0 +1,67 @@
+// Related
+#include "MotionGroup.h"
+// System / External
+#include <stdint.h>
+// Selfmade
+// Project
+#include "../../motion/MotionProfile.h"
+
+bool MotionGroup::add(Stepper *stepper) {
+    if (stepper == NULL || _stepperCount >= MOTION_GROUP_MAX_STEPPERS) return false;
+    _steppers[_stepperCount++] = stepper;
+    return true;
+}
+
+bool MotionGroup::moveTo(const float *positionsMm, float rpm) {
+    int32_t distances[MOTION_GROUP_MAX_STEPPERS];
+    float maxDistance = 0;
+    for (uint8_t i = 0; i < _stepperCount; ++i) {
+        Stepper *stepper = _steppers[i];
+        if (!stepper->isIdle() || !stepper->isHomed()) return false;
+        distances[i] = mmToPosition(positionsMm[i], stepper->getMicrostepsPerRotation(), stepper->getMmPerRotation()) -
+                       stepper->getCurrentSteps();
+        maxDistance = max(maxDistance, (float)abs(distances[i]));
+    }
+    if (maxDistance == 0) return true;
+
+    // Plan the ramp of the longest move, limited so that no axis exceeds its limits once scaled to its distance
+    float speed = 0;
+    float accel = 0;
+    float jerk = 0;
+    bool jerkLimited = true;
+    bool first = true;
+    for (uint8_t i = 0; i < _stepperCount; ++i) {
+        if (distances[i] == 0) continue;
+        Stepper *stepper = _steppers[i];
+        float scale = maxDistance / abs(distances[i]);
+        float axisSpeed = abs(rpm) * stepper->getMicrostepsPerRotation() / 60 * scale;
+        float axisAccel = stepper->getAcceleration() * scale;
+        float axisJerk = stepper->getMotion().getJerk() * scale;
+        speed = first ? axisSpeed : min(speed, axisSpeed);
+        accel = first ? axisAccel : min(accel, axisAccel);
+        jerk = first ? axisJerk : min(jerk, axisJerk);
+        jerkLimited = jerkLimited && stepper->getMotion().getJerk() > 0;
+        first = false;
+    }
+    motionProfile_s lead;
+    planSCurveProfile(lead, maxDistance, speed, accel, jerkLimited ? jerk : 0);
+
+    // Fill all queues first and start them right after each other, so all axes begin within a few microseconds
+    for (uint8_t i = 0; i < _stepperCount; ++i) {
+        if (distances[i] == 0) continue;
+        motionProfile_s profile = lead;
+        scaleProfile(profile, abs(distances[i]) / maxDistance);
+        _steppers[i]->prepareGroupMove(profile, distances[i] > 0, positionsMm[i]);
+    }
+    for (uint8_t i = 0; i < _stepperCount; ++i) {
+        if (distances[i] != 0) _steppers[i]->getMotion().startGroupMove();
+    }
+    return true;
+}
+
+bool MotionGroup::isIdle() {
+    for (uint8_t i = 0; i < _stepperCount; ++i) {
+        if (!_steppers[i]->isIdle()) return false;
+    }
+    return true;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+// Related
+// System / External
+#include <stdint.h>
+// Selfmade
+// Project
+#include "Stepper.h"
+
+const uint8_t MOTION_GROUP_MAX_STEPPERS = 8;  // Maximum number of steppers in one group
+
+/**
+ * @brief Moves several axes to their targets on a straight line: all axes start in the same moment, follow the same ramp scaled to
+ * their distance and arrive together
+ *
+ * The common ramp is limited by the speed, acceleration and jerk of every axis, so no axis exceeds its own limits. The moves run via
+ * the command queue of each stepper, which keep being handled by their own handle()-calls and switch to STANDBY on arrival.
+ */
+class MotionGroup {
+   private:
+    Stepper *_steppers[MOTION_GROUP_MAX_STEPPERS];  // Axes of the group
+    uint8_t _stepperCount = 0;                      // Number of axes in the group
+
+   public:
+    /**
+     * @brief Add a stepper to the group
+     *
+     * @param stepper stepper to be added
+     * @return true added
+     * @return false group full
+     */
+    bool add(Stepper *stepper);
+
+    /**
+     * @brief Start moving all axes to their targets
+     *
+     * @param positionsMm target position in mm of every axis, in the order they were added
+     * @param rpm highest speed of every axis in rotations per minute
+     * @return true moves started
+     * @return false an axis is not homed or still busy, nothing was started
+     */
+    bool moveTo(const float *positionsMm, float rpm);
+
+    /**
+     * @brief Check whether all axes stand still
+     *
+     * @return true all axes arrived or idle
+     * @return false at least one axis still moving
+     */
+    bool isIdle();
+};
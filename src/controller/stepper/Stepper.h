@@ -7,67 +7,64 @@
 // Selfmade
 // Project
 #include "../BaseController.h"
+#include "StepperDiag.h"
+#include "StepperGearing.h"
+#include "StepperHoming.h"
+#include "StepperMotion.h"
+#include "StepperStream.h"
 #include "StepperTest.h"
+#include "StepperTrace.h"
+#include "StepperTuning.h"
+#include "StepperTypes.h"
+#include "StepperUnits.h"
+#include "TmcBusScheduler.h"
+#include "TmcDriver.h"
 
 using TMC2130_n::DRV_STATUS_t;
 
-/**
- * @brief stepper movement instructions, movements that can be scheduled
- *
- */
-struct stepperRecipe_s {
-    stepperMode_e mode;  // Operation mode
-    float rpm;           // Speed in rotations per minute
-    uint8_t load;        // Motorload in %, 0 = no load, 100 = full load
-    int32_t position1;   // Start position
-    int32_t position2;   // End position
-};
-
-/**
- * @brief Status of stepper
- *
- */
-struct stepperStatus_s {
-    float rpm;                       // Steper Rotations per minute
-    uint8_t load;                    // Stepper load in %, 0 = no load, 100 = full load
-    int32_t position;                // stepper position
-    bool errorOverheating;           // Warning Stepper Driver overheated
-    bool errorShutdownHeat;          // Stepper shut down due to overheated driver
-    bool errorShutdownShortCircuit;  // Stepper shut down due to short circuit
-    bool errorOpenLoad;              // Stepper driver detected open load
-};
-
 class Stepper : public BaseController {
    private:
     unsigned long _lastAdjustTime = 0;  // millis() of last time the speed was adjusted with adjustSpeedByLoad()
 
     // Drivers
-    TMC2130Stepper *_driver;
+    TmcDriver _driver;  // Stored inline, configured by init()
+    TmcBusScheduler *_busScheduler = NULL;  // Optional scheduler sharing the SPI bus with other drivers
     FastAccelStepperEngine *_engine = NULL;
     FastAccelStepper *_stepper = NULL;
 
-    // Hardcoded configuration
-    const uint16_t DEFAULT_ACCELERATION = 10000;  // Default stepper acceleration
-    const float DEFAULT_HOMING_SPEED_RPM = 60;    // Default homing speed in rotations per minute
-    const uint8_t HOMING_BUMPS_NEEDED = 2;        // Number of consecutive bumps (100% load) needed to be sure that we have found the home
-                                                  // position and not just measured a glitched load value
+    // Hardcoded configuration, shared by all instances
+    static constexpr uint16_t DEFAULT_ACCELERATION = 10000;  // Default stepper acceleration
 
     // Soft configuration
-    uint16_t _acceleration = DEFAULT_ACCELERATION;     // Motor acceleration
-    stepperConfiguration_s _config;                    // Stepper configuration
-    uint32_t _microstepsPerRotation;                   // Count of step signals to be sent for one rotation
-    float _homingSpeedRpm = DEFAULT_HOMING_SPEED_RPM;  // Speed for homing in rotations per minute, low values can lead to glitchy
-                                                       // load-measurement and thus wrong homing
+    uint16_t _acceleration = DEFAULT_ACCELERATION;  // Motor acceleration
+    stepperConfiguration_s _config;                 // Stepper configuration
+    RuntimeStepperUnits _units;                     // Conversion between rpm/mm and the step generator
+    StepperHoming _homing;                          // Homing procedure, see getHoming()
+    StepperTuning _tuning;                          // CoolStep and chopper modes, see getTuning()
+
+    // Electronic gearing of the FOLLOWING and WINDING modes
+    StepperGearing _gearing;  // Derives the speed from the master, see getGearing()
 
     // Status
-    bool _initialised = false;                // Flag whether controller has been initialised
-    uint8_t _homeConsecutiveBumpCounter = 0;  // Number of consecutive bumps (100% load) while at homing-speed. Needed to detect proper
-                                              // home-position opposed to glitched load values.
-    bool _homed = false;                      // Flag whether the driver of the stepper has been homed yet
-    stepperStatus_s _stepperStatus;           // Current status of stepper
+    bool _initialised = false;       // Flag whether controller has been initialised
+    bool _homed = false;             // Flag whether the driver of the stepper has been homed yet
+    stepperStatus_s _stepperStatus;  // Current status of stepper
+    DRV_STATUS_t _drvStatus{0};      // Driver status register as read by the last updateStatus()
+
+    // Interrupt-driven stall detection via DIAG pin
+    StepperDiag _diag;  // Cuts the power stage on a stall, latches it for handle()
+
+    // Queued motion, used while oscillating, along paths and for jerk-limited positioning
+    StepperMotion _motion;  // Plans the moves and feeds the command queue of FastAccelStepper, see getMotion()
+
+    // Diagnostics
+#ifdef STEPPER_TRACE_ENABLED
+    StepperTrace _trace;  // Recorder of the motion history for post-mortem analysis
+#endif
+    StepperStream _stream;  // High-rate acquisition of the stall signal
 
     // Recipes aka commands aka operation modes
-    const stepperRecipe_s _defaultRecipe = {.mode = OFF, .rpm = 0, .load = 0, .position1 = 0, .position2 = 0};
+    static constexpr stepperRecipe_s _defaultRecipe = {.mode = OFF, .rpm = 0, .load = 0, .position1 = 0, .position2 = 0};
     stepperRecipe_s _currentRecipe = _defaultRecipe;  // current operation mode
     stepperRecipe_s _targetRecipe = _defaultRecipe;   // target operation mode
     bool _newCommand = false;                         // Flag whether a new command is waiting in _targetRecipe
@@ -96,6 +93,22 @@ class Stepper : public BaseController {
      */
     bool isStartSpeedReached();
 
+    /**
+     * @brief Checks whether the homing speed has been reached in the direction of the end stop
+     *
+     * @return true approaching the end stop at speed
+     * @return false too slow or still reversing
+     */
+    bool isApproachingHome();
+
+    /**
+     * @brief Advance the current recipe, part of handle()
+     *
+     * @param units unit conversion of this stepper
+     */
+    template <class Units>
+    void handleRecipe(const Units &units);
+
     /**
      * @brief Check wether target mode needs homing
      *
@@ -107,27 +120,86 @@ class Stepper : public BaseController {
      */
     bool checkNeedsHome(stepperMode_e targetMode, stepperMode_e currentMode);
 
+    /**
+     * @brief Advance the homing procedure through its phases and set the stepper homed at the end, part of handle()
+     *
+     */
+    void handleHoming();
+
+    /**
+     * @brief Advance the path, switches to STANDBY after the last waypoint, part of handle()
+     *
+     * @param units unit conversion of this stepper
+     */
+    template <class Units>
+    void handlePath(const Units &units);
+
+    /**
+     * @brief Pass the speed derived by the gearing to the ramp generator, part of handle() while following or winding
+     *
+     * @param units unit conversion of this stepper
+     * @param winding true = WINDING mode, false = FOLLOWING mode
+     */
+    template <class Units>
+    void handleGearing(const Units &units, bool winding);
+
+    /**
+     * @brief Stop the ramp generator and the queue after the DIAG interrupt and re-enable the power stage, part of handle()
+     *
+     */
+    void handleDiagStop();
+
+    /**
+     * @brief Process a stall latched by the DIAG interrupt outside of homing, part of handle()
+     *
+     */
+    void handleDiagStall();
+
+    /**
+     * @brief Get the driver status, read via SPI unless a bus scheduler already provides it
+     *
+     * @return uint32_t raw DRV_STATUS
+     */
+    uint32_t fetchDrvStatus();
+
     /**
      * @brief Update _current struct with current rpm, load, position
      *
+     * @param units unit conversion of this stepper
      */
-    void updateStatus();
+    template <class Units>
+    void updateStatus(const Units &units);
 
     /**
      * @brief Make the motor run at a defined speed
      *
+     * @param units unit conversion of this stepper
      * @param speedRpm speed in rotations per minute. If 0 the motor will be powered but not moving. Positive / negative values determine
      * the direction
-     * @param forceMoveStop true=forefully stop current movement before applying new speed, false=fluent transition into new speed
+     * @param forceMoveStop true=forefully stop current movement before applying new speed, false=fluent transition into new speed,
+     * reversing and stopping through a deceleration ramp
+     */
+    template <class Units>
+    void applySpeed(const Units &units, float speedRpm, bool forceMoveStop = true);
+
+    /**
+     * @brief Make the ramp generator move to a position, retargets a running move without stopping
+     *
+     * @param units unit conversion of this stepper
+     * @param speedRpm speed in rotations per minute
+     * @param position target position in mm absolut
      */
-    void applySpeed(float speedRpm, bool forceMoveStop = true);
+    template <class Units>
+    void applyPosition(const Units &units, float speedRpm, int32_t position);
 
     /**
-     * @brief Start executing a recipe
+     * @brief Start executing a recipe, blending from the current motion. Only OFF stops by force
      *
+     * @param units unit conversion of this stepper
      * @param recipe recipe to be executed
      */
-    void startRecipe(stepperRecipe_s recipe);
+    template <class Units>
+    void startRecipe(const Units &units, stepperRecipe_s recipe);
 
     /**
      * @brief Stop the stepper immediatly but remember position (emergency stop)
@@ -138,14 +210,33 @@ class Stepper : public BaseController {
     /**
      * @brief Update the motor speed according to the current load
      *
+     * @param units unit conversion of this stepper
+     */
+    template <class Units>
+    void adjustSpeedByLoad(const Units &units);
+
+   protected:
+    /**
+     * @brief Set up the driver and the step generator, part of init() once the pins are known to be valid
+     *
+     */
+    void configure();
+
+    /**
+     * @brief The handle()-cycle, see StepperCycle.h. Called with the units of the instance by Stepper and with units known at compile
+     * time by ConfiguredStepper
+     *
+     * @tparam Units StepperUnits with runtime or compile-time factors
+     * @param units unit conversion of this stepper
      */
-    void adjustSpeedByLoad();
+    template <class Units>
+    void handleCycle(const Units &units);
 
    public:
-    Stepper(stepperConfiguration_s &config, FastAccelStepperEngine *engine);
+    Stepper(const stepperConfiguration_s &config, FastAccelStepperEngine *engine);
 
     /**
-     * @brief Get the current raw stall value from the driver
+     * @brief Get the current raw stall value from the driver, the read is charged to the next cycle of a bus scheduler
      *
      * @return uint16_t raw load 0...1023
      */
@@ -156,6 +247,13 @@ class Stepper : public BaseController {
      */
     void init();
 
+    /**
+     * @brief Let a bus scheduler handle all SPI traffic of the driver instead of handle(), must be called before init()
+     *
+     * @param scheduler scheduler shared by all drivers on the same bus
+     */
+    void setBusScheduler(TmcBusScheduler *scheduler);
+
     /**
      * @brief Disable motor drivers, sets stepper in free-spin
      *
@@ -185,9 +283,90 @@ class Stepper : public BaseController {
     void moveRotateWithLoadAdjust(float startSpeed, uint8_t desiredLoad);
 
     /**
-     * @brief Start moving stepper with rpm until load reaches 100%
+     * @brief Slave the speed of this stepper to another one (electronic gearing). Speed changes of the master are carried over in the
+     * same cycle, a load-based trim on top of the ratio corrects small errors
      *
-     * @param rpm target stepper speed in rotationsPerMinute
+     * @param master stepper to follow, its handle() should be called before the one of the follower
+     * @param ratio rotations of this stepper per rotation of the master, negative values change direction
+     * @param desiredLoad target load in % for the trim, 0 = no trim
+     * @param source follow the measured speed or position of the master
+     */
+    void moveFollow(Stepper *master, float ratio, uint8_t desiredLoad = 0, followSource_e source = FOLLOW_SPEED);
+
+    // Getter-method
+    float getMmPerRotation();
+
+    /**
+     * @brief Level-wind onto a spool: the traverse position is tied to the accumulated spool rotations by the pitch and goes back and
+     * forth between two positions. Works at any line speed since it follows the spool, needs homing
+     *
+     * @param spool stepper of the spool, its handle() should be called before the one of the traverse
+     * @param pitchMm traverse per spool rotation in mm, usually the diameter of the wound material
+     * @param startPos start position in mm
+     * @param endPos end position in mm
+     */
+    void moveWind(Stepper *spool, float pitchMm, int32_t startPos, int32_t endPos);
+
+    /**
+     * @brief Get the electronic gearing of the FOLLOWING and WINDING modes, e.g. to change the ratio or pitch while running or to
+     * enable the diameter estimation. The estimated diameter is also available in getStatus()
+     *
+     * @return StepperGearing& gearing of this stepper
+     */
+    StepperGearing &getGearing();
+
+    /**
+     * @brief Load a planned move into the queue without starting it, see MotionGroup. The stepper switches to POSITIONING right away
+     * and to STANDBY after arrival, StepperMotion::startGroupMove() starts the move
+     *
+     * @param profile planned move in steps
+     * @param forward direction, true = position counts up
+     * @param targetMm target position in mm, for status only
+     * @return true move loaded
+     * @return false not initialised
+     */
+    bool prepareGroupMove(const motionProfile_s &profile, bool forward, float targetMm);
+
+    /**
+     * @brief Check whether the stepper stands still without a command waiting
+     *
+     * @return true idle
+     * @return false moving or about to move
+     */
+    bool isIdle();
+
+    /**
+     * @brief Check whether a command was given that did not start yet, e.g. because the stepper still homes or decelerates
+     *
+     * @return true the current mode is about to change
+     * @return false the current mode reflects the last command
+     */
+    bool hasPendingCommand();
+
+    // Getter-method, position in steps as counted by the step generator
+    int32_t getCurrentSteps();
+
+    // Getter-method
+    uint32_t getMicrostepsPerRotation();
+
+    /**
+     * @brief Get the current speed as reported by the step generator
+     *
+     * @return float speed in rotations per minute, the sign is the one used by moveRotate()
+     */
+    float getCurrentRpm();
+
+    /**
+     * @brief Get the current position in rotations as reported by the step generator
+     *
+     * @return float rotations since the last position reset, the sign is the one used by moveRotate()
+     */
+    float getCurrentRotations();
+
+    /**
+     * @brief Start moving stepper with rpm until load reaches 100%, then back off and re-approach as set via setHomingConfig()
+     *
+     * @param rpm speed of the first approach in rotationsPerMinute
      * negative values change direction
      */
     void moveHome(float rpm);
@@ -201,7 +380,19 @@ class Stepper : public BaseController {
     void movePosition(float rpm, int32_t position);
 
     /**
-     * @brief Start moving stepper between two positions
+     * @brief Append a waypoint to the path, starts moving along the path if not doing so yet. Waypoints are passed without stopping,
+     * the speed at each of them is planned ahead so the stepper can still stop at the last one. Reversals are passed at standstill
+     *
+     * @param positionMm target position in mm absolut
+     * @param rpm highest speed on the way to the waypoint in rotations per minute
+     * @return true waypoint added
+     * @return false too many waypoints ahead, try again later
+     */
+    bool addWaypoint(float positionMm, float rpm);
+
+    /**
+     * @brief Start moving stepper between two positions. The strokes are queued ahead, so the reversals happen at the positions without
+     * waiting for handle()
      *
      * @param rpm target stepper speed in rotationsPerMinute negative values
      * change direction
@@ -212,7 +403,7 @@ class Stepper : public BaseController {
     void moveOscillate(float rpm, int32_t startPos, int32_t endPos, bool directionForward = true);
 
     /**
-     * @brief Manages states and transitions, repeatedly called
+     * @brief Manages states and transitions, repeatedly called. Changed driver registers are sent in one batch at the end
      *
      */
     void handle();
@@ -223,7 +414,7 @@ class Stepper : public BaseController {
      *
      * @param verbous true=all details, false=short details
      */
-    void printStatus(bool verbous);
+    void printStatus(bool verbous = false);
 
     /**
      * @brief Check whether controller was initialised and is in a valid state
@@ -239,15 +430,21 @@ class Stepper : public BaseController {
     // Getter-method
     stepperMode_e getCurrentMode();
 
-    // Getter-method
-    float getHomingSpeed();
+    /**
+     * @brief Stop the motor within microseconds when StallGuard reports a stall at speed, requires the DIAG pin to be configured.
+     * The stepper then switches to standby, sets errorStall and needs to be homed again
+     *
+     * @param active true=stop on stall, false=only use the DIAG pin for homing
+     */
+    void setStallProtection(bool active);
 
     /**
-     * @brief Sets the homing speed. Invalid (<= 0) values are corrected to the default(60 rpm)
+     * @brief Check whether the stepper knows its position
      *
-     * @param newSpeedRpm new speed in rotations per minute
+     * @return true homed
+     * @return false homing needed before positioning
      */
-    void setHomingSpeed(float newSpeedRpm);
+    bool isHomed();
 
     /**
      * @brief Change start- and end-positions of current move-command without interrupting it
@@ -273,4 +470,57 @@ class Stepper : public BaseController {
 
     // Getter-method
     uint16_t getAcceleration();
+
+    /**
+     * @brief Access the driver wrapper, e.g. for its SPI statistics
+     *
+     * @return TmcDriver* driver of this stepper, never NULL. SPI communication only starts with init()
+     */
+    TmcDriver *getDriver();
+
+    /**
+     * @brief Get the homing procedure, e.g. to set its speeds or the backoff distance
+     *
+     * @return StepperHoming& homing procedure of this stepper
+     */
+    StepperHoming &getHoming();
+
+    /**
+     * @brief Get the speed dependent driver features, e.g. to configure CoolStep or StealthChop
+     *
+     * @return StepperTuning& CoolStep and chopper configuration of this stepper
+     */
+    StepperTuning &getTuning();
+
+    /**
+     * @brief Get the queued motion, e.g. to set the jerk limit or the dwell of oscillations, or to count the finished strokes
+     *
+     * @return StepperMotion& queued motion of this stepper
+     */
+    StepperMotion &getMotion();
+
+#ifdef STEPPER_TRACE_ENABLED
+    /**
+     * @brief Access the trace recorder, e.g. to start or stop recording
+     *
+     * @return StepperTrace& trace recorder of this stepper
+     */
+    StepperTrace &getTrace();
+
+    /**
+     * @brief Write the recorded trace as binary dump to Serial, see tools/stepperTraceToCsv.cpp for decoding
+     *
+     * @return true dumped
+     * @return false Serial is busy with a frame, try again
+     */
+    bool dumpTrace();
+#endif
+
+    /**
+     * @brief Get the acquisition of stall, speed and position, streamed as binary frames via Serial (see StepperStream.h for the
+     * format). Samples are taken by a timer independent of the handle()-frequency, handle() sends the finished frames
+     *
+     * @return StepperStream& stream of this stepper, start() it after init()
+     */
+    StepperStream &getStream();
 };
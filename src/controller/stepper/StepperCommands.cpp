@@ -0,0 +1,215 @@
+// Related
+#include "Stepper.h"
+// System / External
+#include <Arduino.h>
+// Selfmade
+// Project
+#include "StepperCycle.h"
+
+// Synchronous methods
+void Stepper::moveOscillate(float rpm, int32_t startPos, int32_t endPos, bool directionForward) {
+    _targetRecipe = _defaultRecipe;
+    _targetRecipe.mode = directionForward ? OSCILLATING_FORWARD : OSCILLATING_BACKWARD;
+    _targetRecipe.rpm = rpm;
+    _targetRecipe.position1 = startPos;
+    _targetRecipe.position2 = endPos;
+    _newCommand = true;
+}
+
+bool Stepper::addWaypoint(float positionMm, float rpm) {
+    // Start a new path unless one is running or about to start
+    bool pathActive = (_currentRecipe.mode == PATH && !_newCommand) || (_newCommand && _targetRecipe.mode == PATH);
+    if (!pathActive) {
+        _targetRecipe = _defaultRecipe;
+        _targetRecipe.mode = PATH;
+        _newCommand = true;
+    }
+    return _motion.addWaypoint(_units.mmToSteps(positionMm), _units.rpmToStepsPerS(rpm), !pathActive);
+}
+
+void Stepper::movePosition(float rpm, int32_t position) {
+    _targetRecipe = _defaultRecipe;
+    _targetRecipe.mode = POSITIONING;
+    _targetRecipe.rpm = rpm;
+    _targetRecipe.position1 = position;
+    _newCommand = true;
+}
+
+void Stepper::moveRotate(float rpm) {
+    _targetRecipe = _defaultRecipe;
+    _targetRecipe.mode = ROTATING;
+    _targetRecipe.rpm = rpm;
+    _newCommand = true;
+}
+
+void Stepper::moveRotateWithLoadAdjust(float startSpeed, uint8_t desiredLoad) {
+    _targetRecipe = _defaultRecipe;
+    _targetRecipe.mode = ADJUSTING;
+    _targetRecipe.rpm = startSpeed;
+    _targetRecipe.load = desiredLoad;
+    _newCommand = true;
+}
+
+void Stepper::moveFollow(Stepper *master, float ratio, uint8_t desiredLoad, followSource_e source) {
+    _targetRecipe = _defaultRecipe;
+    _targetRecipe.mode = FOLLOWING;
+    _targetRecipe.load = desiredLoad;
+    _gearing.setFollowing(master, ratio, source);
+    _newCommand = true;
+}
+
+float Stepper::getMmPerRotation() { return _units.mmPerRotation(); }
+
+void Stepper::moveWind(Stepper *spool, float pitchMm, int32_t startPos, int32_t endPos) {
+    _targetRecipe = _defaultRecipe;
+    _targetRecipe.mode = WINDING;
+    _targetRecipe.position1 = startPos;
+    _targetRecipe.position2 = endPos;
+    _gearing.setWinding(spool, pitchMm);
+    _newCommand = true;
+}
+
+bool Stepper::prepareGroupMove(const motionProfile_s &profile, bool forward, float targetMm) {
+    if (!isReady()) return false;
+
+    _currentRecipe = _defaultRecipe;
+    _currentRecipe.mode = POSITIONING;
+    _currentRecipe.rpm = _units.stepsPerSToRpm(profile.vCruise);
+    _currentRecipe.position1 = targetMm;
+    _driver.toff(1);
+    _motion.prepareGroupMove(profile, forward);
+    return true;
+}
+
+bool Stepper::isIdle() { return isReady() && !_newCommand && !isMoving(); }
+
+bool Stepper::hasPendingCommand() { return _newCommand; }
+
+int32_t Stepper::getCurrentSteps() { return _stepper->getCurrentPosition(); }
+
+uint32_t Stepper::getMicrostepsPerRotation() { return _units.microstepsPerRotation(); }
+
+float Stepper::getCurrentRpm() {
+    // Positive speeds run backwards (see applySpeed())
+    return -_units.usToRpm(_stepper->getCurrentSpeedInUs());
+}
+
+float Stepper::getCurrentRotations() { return -(float)_stepper->getCurrentPosition() / _units.microstepsPerRotation(); }
+
+void Stepper::moveHome(float rpm) {
+    _targetRecipe = _defaultRecipe;
+    _targetRecipe.mode = HOMING;
+    _targetRecipe.rpm = rpm;
+    _newCommand = true;
+    _homed = false;  // Position is not trusted anymore until homing finished
+}
+
+void Stepper::switchModeStandby() {
+    _targetRecipe = _defaultRecipe;
+    _targetRecipe.mode = STANDBY;
+    _newCommand = true;
+}
+
+void Stepper::switchModeOff() {
+    _targetRecipe = _defaultRecipe;
+    _targetRecipe.mode = OFF;
+    _newCommand = true;
+}
+
+bool Stepper::isReady() { return _initialised; }
+
+stepperStatus_s Stepper::getStatus() { return _stepperStatus; }
+
+stepperMode_e Stepper::getCurrentMode() { return _currentRecipe.mode; }
+
+void Stepper::adjustMovePositions(int32_t startPos, int32_t endPos) {
+    _currentRecipe.position1 = startPos;
+    _currentRecipe.position2 = endPos;
+
+    switch (_currentRecipe.mode) {
+        case ROTATING:
+        case ADJUSTING:
+        case HOMING:
+        case OFF:
+        case STANDBY:
+        case FOLLOWING:
+        case PATH:  // Add waypoints instead
+            break;
+        case WINDING:
+            _gearing.adjustWindingPositions(startPos, endPos);
+            break;
+        case POSITIONING:
+            if (_motion.isActive()) {
+                // The running move is finished, then the new position is approached
+                _motion.moveTo(_units.mmToSteps(_currentRecipe.position1), _units.rpmToStepsPerS(_currentRecipe.rpm), _acceleration);
+                break;
+            }
+            // Retarget, reversing through a deceleration ramp if needed
+            applyPosition(_units, _currentRecipe.rpm, _currentRecipe.position1);
+            break;
+        case OSCILLATING_FORWARD:
+        case OSCILLATING_BACKWARD:
+            // The running stroke is finished, the following ones are planned again with the new positions
+            _motion.clearPending();
+            break;
+    }
+}
+
+void Stepper::adjustMoveSpeed(float rpm) {
+    _currentRecipe.rpm = rpm;
+
+    switch (_currentRecipe.mode) {
+        case ROTATING:
+        case ADJUSTING:
+        case HOMING:
+            applySpeed(_units, _currentRecipe.rpm, false);
+            break;
+        case POSITIONING:
+            if (_motion.isActive()) break;  // The speed is part of the planned profile
+            _stepper->setSpeedInUs(_units.rpmToUs(_currentRecipe.rpm));
+            _stepper->applySpeedAcceleration();
+            break;
+        case OSCILLATING_FORWARD:
+        case OSCILLATING_BACKWARD:
+            // The running stroke is finished, the following ones are planned again with the new speed
+            _motion.clearPending();
+            break;
+        case OFF:
+        case STANDBY:
+        case FOLLOWING:  // Speed is given by the master, see StepperGearing::adjustFollowRatio()
+        case WINDING:    // Speed is given by the spool, see StepperGearing::adjustWindingPitch()
+        case PATH:       // Speed is set per waypoint
+            break;
+    }
+}
+
+void Stepper::adjustAcceleration(uint16_t newAcceleration) {
+    _acceleration = newAcceleration;
+    _stepper->setAcceleration(_acceleration);
+}
+
+uint16_t Stepper::getAcceleration() { return _acceleration; }
+
+TmcDriver *Stepper::getDriver() { return &_driver; }
+
+StepperGearing &Stepper::getGearing() { return _gearing; }
+
+StepperMotion &Stepper::getMotion() { return _motion; }
+
+void Stepper::setBusScheduler(TmcBusScheduler *scheduler) { _busScheduler = scheduler; }
+
+#ifdef STEPPER_TRACE_ENABLED
+StepperTrace &Stepper::getTrace() { return _trace; }
+
+bool Stepper::dumpTrace() { return _trace.dump(_config.stepperId); }
+#endif
+
+StepperStream &Stepper::getStream() { return _stream; }
+
+StepperHoming &Stepper::getHoming() { return _homing; }
+
+bool Stepper::isHomed() { return _homed; }
+
+void Stepper::setStallProtection(bool active) { _diag.setStallProtection(active); }
+
+StepperTuning &Stepper::getTuning() { return _tuning; }
@@ -0,0 +1,360 @@
+#pragma once
+
+// Related
+#include "Stepper.h"
+// System / External
+#include <FastAccelStepper.h>
+#include <TMCStepper.h>
+// Selfmade
+// Project
+
+// The handle()-cycle of Stepper, templated on the unit conversion so ConfiguredStepper folds its factors. Included by the translation
+// units instantiating it: Stepper.cpp, StepperCommands.cpp and each ConfiguredStepper
+
+template <class Units>
+void Stepper::updateStatus(const Units &units) {
+    // Read the status register only once per cycle, all flags and the stall value are taken from it
+    _drvStatus.sr = fetchDrvStatus();
+    _stepperStatus.errorOverheating = _drvStatus.otpw;
+    _stepperStatus.errorOpenLoad = (_drvStatus.ola || _drvStatus.olb);
+    _stepperStatus.errorShutdownHeat = _drvStatus.ot;
+    _stepperStatus.errorShutdownShortCircuit = (_drvStatus.s2ga || _drvStatus.s2gb);
+    _stepperStatus.currentScale = _drvStatus.cs_actual;
+    _stepperStatus.diameter = _gearing.getDiameter();
+
+    int32_t speedUs = _stepper->getCurrentSpeedInUs();
+    _stepperStatus.rpm = units.usToRpm(speedUs);
+    // Before the first status read the stall value is 0, which would read as full load
+    _stepperStatus.load = _driver.hasStatus() ? stallToLoadPercent(abs(speedUs), _drvStatus.sg_result, speeds, minLoad, maxLoad, 40) : 0;
+    _stepperStatus.position = units.stepsToMm(_stepper->getCurrentPosition());
+}
+
+template <class Units>
+void Stepper::applySpeed(const Units &units, float speedRpm, bool forceMoveStop) {
+    if (forceMoveStop) {
+        forceStop();
+        _motion.clear();
+        _driver.toff(1);
+    } else if (speedRpm == 0) {
+        _stepper->stopMove();  // Decelerate to standstill
+    }
+    if (speedRpm != 0) {
+        _stepper->setSpeedInUs(units.rpmToUs(speedRpm));
+        _stepper->applySpeedAcceleration();
+
+        if (speedRpm < 0) {
+            _stepper->runForward();
+        } else {
+            _stepper->runBackward();
+        }
+    }
+}
+
+template <class Units>
+void Stepper::applyPosition(const Units &units, float speedRpm, int32_t position) {
+    _stepper->setSpeedInUs(units.rpmToUs(speedRpm));
+    _stepper->applySpeedAcceleration();
+    _stepper->moveTo(units.mmToSteps(position));
+}
+
+template <class Units>
+void Stepper::startRecipe(const Units &units, stepperRecipe_s recipe) {
+    _stepperStatus.errorStall = false;
+    _diag.clearStall();
+
+    // Queued modes append to the running move, the ramp generator blends from the current speed. Only OFF stops by force
+    _motion.startRecipe(recipe.mode);
+    if (recipe.mode != OFF) _driver.toff(1);
+
+    // Do mode specific stuff
+    switch (recipe.mode) {
+        case ROTATING:
+        case ADJUSTING:
+            applySpeed(units, recipe.rpm, false);
+            break;
+        case HOMING:
+            _homing.start();
+            applySpeed(units, recipe.rpm, false);
+            break;
+        case POSITIONING:
+            if (_motion.isActive()) {
+                _motion.moveTo(units.mmToSteps(recipe.position1), units.rpmToStepsPerS(recipe.rpm), _acceleration);
+                break;
+            }
+            applyPosition(units, recipe.rpm, recipe.position1);
+            break;
+        case OSCILLATING_FORWARD:
+        case OSCILLATING_BACKWARD:
+            _currentRecipe.mode = _motion.startOscillation(recipe.mode == OSCILLATING_FORWARD, units.mmToSteps(recipe.position1),
+                                                           units.mmToSteps(recipe.position2), units.rpmToStepsPerS(recipe.rpm),
+                                                           _acceleration);
+            break;
+        case FOLLOWING:
+            _gearing.engageFollowing();
+            handleGearing(units, false);
+            break;
+        case PATH:
+            handlePath(units);
+            break;
+        case WINDING:
+            _gearing.engageWinding(recipe.position1, recipe.position2);
+            handleGearing(units, true);
+            break;
+        case STANDBY:
+            applySpeed(units, 0, false);  // Decelerate to standstill
+            break;
+        case OFF:
+            applySpeed(units, 0);  // Stop any movement
+            _driver.toff(0);       // Power off the driver
+            _homed = false;
+            break;
+    }
+}
+
+template <class Units>
+void Stepper::handlePath(const Units &units) {
+    float speed = 0;  // Cruise speed of the last released segment, stays 0 if none was released
+    if (!_motion.handlePath(_acceleration, speed)) switchModeStandby();
+    if (speed > 0) _currentRecipe.rpm = units.stepsPerSToRpm(speed);
+}
+
+template <class Units>
+void Stepper::handleGearing(const Units &units, bool winding) {
+    // The load trim needs a real status, before the first read the load is 0
+    uint8_t targetLoad = _driver.hasStatus() ? _currentRecipe.load : 0;
+    float speedRpm;
+    bool derived = winding ? _gearing.computeWindingSpeed(speedRpm)
+                           : _gearing.computeFollowingSpeed(_stepperStatus.load, targetLoad, speedRpm);
+    if (!derived) return;
+
+    _currentRecipe.rpm = speedRpm;
+    if (_gearing.updateAppliedSpeed(speedRpm)) applySpeed(units, speedRpm, false);
+}
+
+template <class Units>
+void Stepper::adjustSpeedByLoad(const Units &units) {
+    // Prevent too frequent adjustment since stall-values can't be measured that often
+    /*
+    unsigned long now = millis();
+    if((_lastAdjustTime + 60) > now) return; // TODO: handle overflow
+    _lastAdjustTime = now;
+    */
+    /*
+    // TODO
+    // Calculate the necessary speed-adjustment using a pid-algorithm
+    float _pidPreviousError;
+    unsigned long previousTime;
+
+    const float PID_CONST_ERROR_RANGE = 3;
+    const float PID_CONST_P = 9.1; // Adjustable parameter of the PID-algorithm
+    const float PID_CONST_I = 0.3; // Adjustable parameter of the PID-algorithm
+    const float PID_CONST_D = 1.8; // Adjustable parameter of the PID-algorithm
+    float pidValueP = 0;
+    float pidValueI = 0;
+    float pidValueD = 0;
+    float elapsedTime = (float)(millis() - previousTime) / 1000; // Time since last read in s
+    float PID_error = _currentRecipe.load - _stepperStatus.load;
+
+    pidValueP = PID_CONST_P * PID_error;
+    if(-PID_CONST_ERROR_RANGE < PID_error || PID_error < PID_CONST_ERROR_RANGE){
+        pidValueI = pidValueI + (PID_CONST_I * PID_error);
+    }
+    pidValueD = PID_CONST_D * ((PID_error - _pidPreviousError) / elapsedTime);
+    float _pidValue = pidValueP + pidValueI + pidValueD;
+    */
+
+    // TODO: Actually use recipe-values (load-level, rpm)
+
+    DRV_STATUS_t drvStatus{0};
+    drvStatus.sr = fetchDrvStatus();
+    uint16_t currentStall = drvStatus.sg_result;
+    // uint32_t speedDirection = _stepper->getCurrentSpeedInUs() < 0 ? -1 : 1;
+    uint32_t currentSpeedUs = abs(_stepper->getCurrentSpeedInUs());  // Current speed in Us ticks
+    float currentSpeedRpm = units.usToRpm(currentSpeedUs);
+    uint32_t speedLimitLowUs = units.rpmToUs(abs(_currentRecipe.rpm));  // Slowest acceptable speed in Us ticks. Needed since
+                                                                        // load-measurement does not properly work for all speeds
+    uint32_t speedLimitHighUs =
+        units.rpmToUs(abs(_currentRecipe.rpm) + _currentRecipe.load);  // Fastest acceptable speed in Us ticks. Needed since
+                                                                       // load-measurement does not properly work for all speeds
+    uint32_t speedNewFasterUs = units.rpmToUs(currentSpeedRpm + 1);  // New speed in Us ticks when speeding up (smaller = faster)
+    speedNewFasterUs =
+        (speedNewFasterUs == currentSpeedUs
+             ? currentSpeedUs - 1
+             : speedNewFasterUs);  // Make sure there is at least some kind of change despite calculating back and forth between rpm and us
+    speedNewFasterUs = min(speedLimitLowUs, max(speedLimitHighUs, speedNewFasterUs));
+    uint32_t speedNewSlowerUs = units.rpmToUs(currentSpeedRpm - 1);  // New speed in Us ticks when slowing down (bigger = slower)
+    speedNewSlowerUs =
+        (speedNewSlowerUs == currentSpeedUs
+             ? currentSpeedUs + 1
+             : speedNewSlowerUs);  // Make sure there is at least some kind of change despite calculating back and forth between rpm and us
+    speedNewSlowerUs = min(speedLimitLowUs, max(speedLimitHighUs, speedNewSlowerUs));
+    // uint32_t speedNewFasterUs = min(speedLimitLowUs, max(speedLimitHighUs, currentSpeedUs * 0.95)); // New speed in Us ticks when
+    // speeding up (smaller = faster) uint32_t speedNewSlowerUs = min(speedLimitLowUs, max(speedLimitHighUs, currentSpeedUs *
+    // (currentStall==0 ? 2 : 1.2))); // New speed in Us ticks when slowing down (bigger = slower)
+    uint32_t speedNewUs = currentSpeedUs;
+
+    uint16_t stallLimitLow;   // Minimal stall value, if current stall is below, the motor will accelerate
+    uint16_t stallLimitHigh;  // Maximal stall value, if current stall is above, the motor will slow down
+    // Adjust default stall limits outside of optimal operation range
+    if (currentSpeedRpm < 8) {
+        stallLimitHigh = 700;
+        stallLimitLow = 650;
+    } else if (currentSpeedRpm < 10) {
+        stallLimitHigh = 650;
+        stallLimitLow = 600;
+    } else if (currentSpeedRpm < 12) {
+        stallLimitHigh = 600;
+        stallLimitLow = 550;
+    } else if (currentSpeedRpm < 15) {
+        stallLimitHigh = 550;
+        stallLimitLow = 500;
+    } else if (currentSpeedRpm < 20) {
+        stallLimitHigh = 500;
+        stallLimitLow = 450;
+    } else if (currentSpeedRpm < 25) {
+        stallLimitHigh = 450;
+        stallLimitLow = 400;
+    } else if (currentSpeedRpm < 30) {
+        stallLimitHigh = 450;
+        stallLimitLow = 400;
+    } else if (currentSpeedRpm < 35) {
+        stallLimitHigh = 400;
+        stallLimitLow = 350;
+    } else if (currentSpeedRpm < 40) {
+        stallLimitHigh = 350;
+        stallLimitLow = 300;
+    } else {
+        stallLimitHigh = 300;
+        stallLimitLow = 250;
+    }
+
+    if (currentStall < stallLimitLow || drvStatus.stallGuard)
+        speedNewUs = speedNewSlowerUs;  // Slow down when stalled or load too high(low stall value = high load)
+    if (currentStall > stallLimitHigh) speedNewUs = speedNewFasterUs;
+
+    /*
+     */
+    logPrint(
+        _logging, INFO,
+        //"\n{sNwUs: %d, sNwR: %.2f, stlNw: %d, do: '%c', sChangeU: %d}",
+        "\n%lu: {%.2f-(%c)->%.2f, %d < %d < %d, stalled: %d, slower: %.2f, faster: %.2f}", millis(),
+        // speedLimitLowUs,
+        units.usToRpm(currentSpeedUs),
+        ((speedNewUs == speedNewFasterUs) ? '+' : ((speedNewUs == speedNewSlowerUs) ? '-' : '=')),  // Speed up needed based on load values?
+        units.usToRpm(speedNewUs),
+        // speedLimitHighUs,
+        stallLimitLow,
+        currentStall,  // Raw stall value
+        stallLimitHigh, drvStatus.stallGuard, units.usToRpm(speedNewSlowerUs),
+        units.usToRpm(speedNewFasterUs)
+        //_stepperStatus.load, // Current load value
+        //_currentRecipe.load, // Target load value set by recipe
+    );  // TODO - debugD
+
+    // Apply speed change
+    if (currentSpeedUs != speedNewUs) {
+        _stepper->setSpeedInUs(speedNewUs);
+        _stepper->applySpeedAcceleration();
+    }
+    /*
+     */
+}
+
+template <class Units>
+void Stepper::handleRecipe(const Units &units) {
+    switch (_currentRecipe.mode) {
+        case HOMING:
+            handleHoming();
+            break;
+        case ADJUSTING:
+            if (_driver.hasStatus()) adjustSpeedByLoad(units);
+            break;
+        case POSITIONING:
+            // Wait for motor to stop moving, as it means we reached our destination
+            _motion.fill();
+            if (_motion.isActive() ? _motion.isIdle() : !isMoving()) {
+                switchModeStandby();
+            }
+            break;
+        case OSCILLATING_FORWARD:
+        case OSCILLATING_BACKWARD:
+            _currentRecipe.mode = _motion.handleOscillation(units.mmToSteps(_currentRecipe.position1),
+                                                            units.mmToSteps(_currentRecipe.position2),
+                                                            units.rpmToStepsPerS(_currentRecipe.rpm), _acceleration);
+            break;
+        case FOLLOWING:
+            handleGearing(units, false);
+            break;
+        case WINDING:
+            handleGearing(units, true);
+            break;
+        case PATH:
+            handlePath(units);
+            break;
+        case ROTATING:  // Keep on rolling, nothing to do here
+        case STANDBY:   // Nothing to do here, too
+        case OFF:       // Literally nothing to do here
+        default:        // Should never happen
+            break;
+    };
+}
+
+template <class Units>
+void Stepper::handleCycle(const Units &units) {
+    PROFILE_HANDLE();
+    if (!isReady()) return;
+    handleDiagStop();
+
+    // Switch recipe on new command, unless we are still homing. OFF has priority for safety reasons though
+    bool transitioning = false;
+    if (_newCommand && (_targetRecipe.mode == OFF || _currentRecipe.mode != HOMING)) {
+        bool needsHome = checkNeedsHome(_targetRecipe.mode, _currentRecipe.mode);
+        transitioning = !_motion.isTransitionReady(needsHome ? HOMING : _targetRecipe.mode, _acceleration);
+
+        // Determine next command
+        if (transitioning) {
+            // Wait for the motor to stop smoothly, the next command is checked again on the next cycle
+        } else if (needsHome) {
+            // Initiate homing instead of next command
+            _currentRecipe = _defaultRecipe;
+            _currentRecipe.mode = HOMING;
+            _currentRecipe.rpm = _homing.getSpeed();
+            _newCommand = true;
+        } else {
+            _currentRecipe = _targetRecipe;
+            _targetRecipe = _defaultRecipe;
+            _newCommand = false;
+        }
+
+        if (!transitioning) startRecipe(units, _currentRecipe);
+    }
+
+    handleDiagStall();
+
+    // Handle the current recipe, that was already started at some point in the past. While transitioning only the stop is fed
+    if (transitioning) {
+        _motion.fill();
+    } else {
+        handleRecipe(units);
+    }
+
+    // Stats and logging, a bus scheduler reads the status every cycle while it is needed for load measurement
+    bool followTrim = _currentRecipe.mode == FOLLOWING && _currentRecipe.load > 0;
+    _driver.setPollUrgent(_currentRecipe.mode == HOMING || _currentRecipe.mode == ADJUSTING || followTrim);
+    updateStatus(units);
+
+    // StallGuard is unreliable while accelerating or at low speed, the DIAG interrupt may only stop the motor at stable speed
+    bool homingApproach = _currentRecipe.mode == HOMING && !_homing.isBackingOff() && isApproachingHome();
+    _diag.arm(homingApproach, isStartSpeedReached() && isMoving());
+#ifdef STEPPER_TRACE_ENABLED
+    if (_trace.isRecording()) {
+        _trace.recordState(_stepper->getCurrentSpeedInUs(), _stepper->getCurrentPosition(), _drvStatus.sr, _currentRecipe.mode,
+                           _stepperStatus.load);
+    }
+#endif
+    _stream.transmit();
+
+    // Send all register changes of this cycle at once, unless a bus scheduler takes care of it
+    if (!_driver.isScheduled()) _driver.flush();
+    if (isLogRelevant(_logging, INFO)) printStatus();
+}
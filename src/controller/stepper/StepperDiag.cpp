@@ -0,0 +1,46 @@
+// Related
+#include "StepperDiag.h"
+// System / External
+#include <Arduino.h>
+// Selfmade
+// Project
+
+void StepperDiag::init(TmcDriver *driver, uint8_t pinDiag, uint8_t pinEn) {
+    _pinDiag = pinDiag;
+    _pinEn = pinEn;
+    driver->diag1_stall(true);
+    driver->diag1_pushpull(true);
+    pinMode(_pinDiag, INPUT);
+    attachInterruptArg(digitalPinToInterrupt(_pinDiag), onInterrupt, this, RISING);
+}
+
+void IRAM_ATTR StepperDiag::onInterrupt(void *diag) { ((StepperDiag *)diag)->handleInterrupt(); }
+
+void IRAM_ATTR StepperDiag::handleInterrupt() {
+    if (!_armed) return;
+    _armed = false;
+
+    // FastAccelStepper may not be called from interrupt context, so only the power stage is cut here (EN of the TMC2130 is active
+    // low). The ramp generator is stopped on the next handle()-call of the stepper
+    digitalWrite(_pinEn, HIGH);
+    _driverDisabled = true;
+    _stallLatched = true;
+}
+
+void StepperDiag::arm(bool homingApproach, bool runningAtSpeed) {
+    if (_pinDiag == 0) return;
+    _armed = !_stallLatched && (homingApproach || (_stallProtection && runningAtSpeed));
+}
+
+bool StepperDiag::isDriverDisabled() { return _driverDisabled; }
+
+void StepperDiag::enableDriver() {
+    digitalWrite(_pinEn, LOW);
+    _driverDisabled = false;
+}
+
+bool StepperDiag::isStallLatched() { return _stallLatched; }
+
+void StepperDiag::clearStall() { _stallLatched = false; }
+
+void StepperDiag::setStallProtection(bool active) { _stallProtection = active; }
@@ -0,0 +1,80 @@
+#pragma once
+
+// Related
+// System / External
+#include <stdint.h>
+// Selfmade
+// Project
+#include "TmcDriver.h"
+
+/**
+ * @brief Interrupt-driven stall detection via the DIAG1 pin of the TMC2130. The interrupt only cuts the power stage via EN and latches
+ * the stall, the stepper stops its ramp generator and processes the stall on its next handle()-call
+ *
+ */
+class StepperDiag {
+   private:
+    uint8_t _pinDiag = 0;                   // DIAG1 pin of the driver, 0 = not connected
+    uint8_t _pinEn = 0;                     // EN pin of the driver, active low
+    bool _stallProtection = false;          // Flag whether a stall at speed stops the motor outside of homing
+    volatile bool _armed = false;           // Flag whether the interrupt may stop the motor, only set while at stable speed
+    volatile bool _stallLatched = false;    // Flag whether the interrupt stopped the motor, processed by handle()
+    volatile bool _driverDisabled = false;  // Flag whether the interrupt cut the power stage via EN, re-enabled by handle()
+
+    /**
+     * @brief Interrupt service routine of the DIAG pin, forwards to the instance
+     *
+     * @param diag instance the interrupt belongs to
+     */
+    static void onInterrupt(void *diag);
+
+    /**
+     * @brief Cut the power stage via the EN pin and latch the stall, called from interrupt context. Steppers sharing the EN pin are cut
+     * as well until the next handle()-call of this stepper, their ramp generators keep running and may lose steps meanwhile
+     *
+     */
+    void handleInterrupt();
+
+   public:
+    /**
+     * @brief Route StallGuard to DIAG1 as push-pull active high and attach the interrupt
+     *
+     * @param driver driver of the stepper
+     * @param pinDiag pin DIAG1 is connected to, must be a valid digital pin
+     * @param pinEn EN pin of the driver
+     */
+    void init(TmcDriver *driver, uint8_t pinDiag, uint8_t pinEn);
+
+    /**
+     * @brief Decide whether the interrupt may stop the motor, StallGuard is unreliable while accelerating or at low speed
+     *
+     * @param homingApproach true = approaching the end stop at homing speed
+     * @param runningAtSpeed true = moving at the speed of the current recipe
+     */
+    void arm(bool homingApproach, bool runningAtSpeed);
+
+    // Getter-method, flag whether the interrupt cut the power stage and the ramp generator still has to be stopped
+    bool isDriverDisabled();
+
+    /**
+     * @brief Re-enable the power stage after the ramp generator was stopped
+     *
+     */
+    void enableDriver();
+
+    // Getter-method, flag whether a stall was latched by the interrupt and not processed yet
+    bool isStallLatched();
+
+    /**
+     * @brief Mark the latched stall as processed
+     *
+     */
+    void clearStall();
+
+    /**
+     * @brief Stop the motor within microseconds when StallGuard reports a stall at speed, requires the DIAG pin to be configured
+     *
+     * @param active true=stop on stall, false=only use the DIAG pin for homing
+     */
+    void setStallProtection(bool active);
+};
@@ -0,0 +1,150 @@
+// Related
+#include "StepperGearing.h"
+// System / External
+#include <Arduino.h>
+// Selfmade
+// Project
+#include "../../motion/Traverse.h"
+#include "Stepper.h"
+#include "StepperTest.h"
+
+constexpr float StepperGearing::POSITION_GAIN;
+constexpr float StepperGearing::WINDING_MAX_CORRECTION_RPM;
+constexpr float StepperGearing::TRIM_STEP_RPM;
+constexpr float StepperGearing::APPLY_THRESHOLD_RPM;
+constexpr float StepperGearing::DEFAULT_TRIM_LIMIT_RPM;
+
+StepperGearing::StepperGearing(Stepper *stepper) : _stepper(stepper) {}
+
+void StepperGearing::setFollowing(Stepper *master, float ratio, followSource_e source) {
+    _master = master;
+    _followRatio = ratio;
+    _followSource = source;
+}
+
+void StepperGearing::setWinding(Stepper *spool, float pitchMm) {
+    _master = spool;
+    _windingPitchMm = abs(pitchMm);
+}
+
+void StepperGearing::resetFollowOrigin() {
+    _followOrigin = _stepper->getCurrentRotations();
+    _followMasterOrigin = _master != NULL ? _master->getCurrentRotations() : 0;
+}
+
+void StepperGearing::engageFollowing() {
+    resetFollowOrigin();
+    _trimRpm = 0;
+    _appliedRpm = 0;
+    _diameterEstimator.clearReference();
+}
+
+void StepperGearing::resetWindingOrigin() {
+    float position = positionToMm(_stepper->getCurrentSteps(), _stepper->getMicrostepsPerRotation(), _stepper->getMmPerRotation());
+    _windingOrigin = _master != NULL ? _master->getCurrentRotations() : 0;
+    _windingTravelOffset = traverseTravelAt(position, _windingStart, _windingEnd, _windingTowardsEnd);
+}
+
+void StepperGearing::engageWinding(float startMm, float endMm) {
+    _windingStart = startMm;
+    _windingEnd = endMm;
+    _windingTowardsEnd = true;
+    _appliedRpm = 0;
+    resetWindingOrigin();
+}
+
+void StepperGearing::adjustWindingPositions(float startMm, float endMm) {
+    _windingStart = startMm;
+    _windingEnd = endMm;
+    resetWindingOrigin();  // Continue from the current position within the new endpoints
+}
+
+bool StepperGearing::computeFollowingSpeed(uint8_t load, uint8_t targetLoad, float &speedRpm) {
+    if (_master == NULL || !_master->isReady()) return false;
+
+    // Ratio from the winding diameter, the measured diameter already contains the effect of the trim
+    if (_diameterEstimation) {
+        float mmPerRotation = _master->getMmPerRotation();
+        if (_diameterEstimator.update(_master->getCurrentRotations() * mmPerRotation, _stepper->getCurrentRotations())) {
+            _trimRpm *= 1 - _diameterEstimator.getSmoothing();
+            if (_followSource == FOLLOW_POSITION) resetFollowOrigin();
+        }
+        _estimatedFollowRatio = _diameterEstimator.getRatio(mmPerRotation);
+    }
+    float ratio = getFollowRatio();
+
+    // Feedforward from the master, following the position additionally corrects the accumulated error
+    float rpm = _master->getCurrentRpm() * ratio;
+    if (_followSource == FOLLOW_POSITION) {
+        float targetRotations = _followOrigin + (_master->getCurrentRotations() - _followMasterOrigin) * ratio;
+        rpm += (targetRotations - _stepper->getCurrentRotations()) * POSITION_GAIN;
+    }
+
+    // Trim on top of the ratio, too much load means too fast
+    if (targetLoad > 0 && rpm != 0) {
+        if (load > targetLoad) _trimRpm -= TRIM_STEP_RPM;
+        if (load < targetLoad) _trimRpm += TRIM_STEP_RPM;
+        _trimRpm = max(-_trimLimitRpm, min(_trimRpm, _trimLimitRpm));
+        rpm += rpm > 0 ? _trimRpm : -_trimRpm;
+    }
+
+    speedRpm = rpm;
+    return true;
+}
+
+bool StepperGearing::computeWindingSpeed(float &speedRpm) {
+    if (_master == NULL || !_master->isReady()) return false;
+
+    // The spool rotations determine the traverse position, folded back and forth between the endpoints
+    float travel = _windingTravelOffset + abs(_master->getCurrentRotations() - _windingOrigin) * _windingPitchMm;
+    float target = traversePosition(travel, _windingStart, _windingEnd);
+    int8_t direction = traverseDirection(travel, _windingStart, _windingEnd);
+    if (direction != 0) _windingTowardsEnd = (direction > 0) == (_windingEnd > _windingStart);
+
+    // Feedforward of the traverse speed plus correction of the position error, counting up is positive here
+    float mmPerRotation = _stepper->getMmPerRotation();
+    float rpm = direction * abs(_master->getCurrentRpm()) * _windingPitchMm / mmPerRotation;
+    float position = positionToMm(_stepper->getCurrentSteps(), _stepper->getMicrostepsPerRotation(), mmPerRotation);
+    float correction = (target - position) / mmPerRotation * POSITION_GAIN;
+    rpm += max(-WINDING_MAX_CORRECTION_RPM, min(correction, WINDING_MAX_CORRECTION_RPM));
+
+    // Positive speeds run backwards (see Stepper::applySpeed())
+    speedRpm = -rpm;
+    return true;
+}
+
+bool StepperGearing::updateAppliedSpeed(float speedRpm) {
+    if (abs(speedRpm - _appliedRpm) < APPLY_THRESHOLD_RPM) return false;
+    _appliedRpm = speedRpm;
+    return true;
+}
+
+void StepperGearing::adjustFollowRatio(float ratio) {
+    if (_stepper->getCurrentMode() == FOLLOWING) resetFollowOrigin();  // Keep the positions geared from here on
+    _followRatio = ratio;
+}
+
+float StepperGearing::getFollowRatio() { return _diameterEstimation ? (_followRatio < 0 ? -1 : 1) * _estimatedFollowRatio : _followRatio; }
+
+void StepperGearing::enableDiameterEstimation(float coreDiameterMm, float maxDiameterMm) {
+    if (_stepper->getCurrentMode() == FOLLOWING) resetFollowOrigin();  // The ratio changes, keep the positions geared from here on
+    _diameterEstimator.reset(coreDiameterMm, maxDiameterMm);
+    if (_master != NULL) _estimatedFollowRatio = _diameterEstimator.getRatio(_master->getMmPerRotation());
+    _diameterEstimation = true;
+}
+
+void StepperGearing::disableDiameterEstimation() {
+    if (_stepper->getCurrentMode() == FOLLOWING) resetFollowOrigin();  // The ratio changes, keep the positions geared from here on
+    _diameterEstimation = false;
+}
+
+float StepperGearing::getDiameter() { return _diameterEstimation ? _diameterEstimator.getDiameter() : 0; }
+
+void StepperGearing::setFollowTrimLimit(float limitRpm) { _trimLimitRpm = abs(limitRpm); }
+
+void StepperGearing::adjustWindingPitch(float pitchMm) {
+    if (_stepper->getCurrentMode() == WINDING) resetWindingOrigin();  // Keep the current position from here on
+    _windingPitchMm = abs(pitchMm);
+}
+
+float StepperGearing::getWindingPitch() { return _windingPitchMm; }
@@ -0,0 +1,200 @@
+#pragma once
+
+// Related
+// System / External
+#include <stddef.h>
+#include <stdint.h>
+// Selfmade
+// Project
+#include "../../motion/SpoolDiameterEstimator.h"
+
+class Stepper;
+
+/**
+ * @brief Signal of the master a follower is geared to
+ *
+ */
+enum followSource_e {
+    FOLLOW_SPEED,    // Follow the measured speed, position errors e.g. from trimming are not corrected
+    FOLLOW_POSITION  // Follow the position, the speed is corrected to keep the geared position
+};
+
+/**
+ * @brief Electronic gearing of a stepper to a master, used by the FOLLOWING and WINDING modes. Following turns the stepper with a ratio
+ * of the master, level winding traverses it back and forth in sync with a spool as master. The gearing derives the speed, the stepper
+ * applies it
+ *
+ */
+class StepperGearing {
+   private:
+    static constexpr float POSITION_GAIN = 60;               // Speed correction per rotation of position error while following or
+                                                             // winding, in rpm
+    static constexpr float WINDING_MAX_CORRECTION_RPM = 30;  // Limit of the position correction while winding, e.g. when engaging
+                                                             // off the endpoints
+    static constexpr float TRIM_STEP_RPM = 0.1;              // Change of the load trim per handle()-call while following, in rpm
+    static constexpr float APPLY_THRESHOLD_RPM = 0.01;       // Smallest change of the geared speed passed to the ramp generator
+    static constexpr float DEFAULT_TRIM_LIMIT_RPM = 5;       // Default limit of the load trim while following, in rpm
+
+    Stepper *_stepper;        // Geared stepper, the instance this gearing belongs to
+    Stepper *_master = NULL;  // Stepper followed in FOLLOWING mode, spool in WINDING mode
+    float _appliedRpm = 0;    // Speed last passed to the ramp generator
+
+    // Following
+    float _followRatio = 1;                        // Rotations of the stepper per rotation of the master
+    followSource_e _followSource = FOLLOW_SPEED;   // Signal of the master that is followed
+    float _trimLimitRpm = DEFAULT_TRIM_LIMIT_RPM;  // Largest speed change by the load trim in rpm
+    float _trimRpm = 0;                            // Current speed change by the load trim in rpm
+    float _followOrigin = 0;                       // Own rotations when the gearing was engaged
+    float _followMasterOrigin = 0;                 // Rotations of the master when the gearing was engaged
+    SpoolDiameterEstimator _diameterEstimator;     // Winding diameter of the stepper as spool, fed by the master line length
+    bool _diameterEstimation = false;              // Flag whether the follow ratio is derived from the winding diameter
+    float _estimatedFollowRatio = 1;               // Follow ratio from the winding diameter, the sign comes from _followRatio
+
+    // Level winding, the master is the spool
+    float _windingPitchMm = 0;       // Traverse per spool rotation in mm
+    float _windingOrigin = 0;        // Spool rotations when the traverse was engaged
+    float _windingTravelOffset = 0;  // Travelled distance of the traverse when it was engaged in mm, see traversePosition()
+    bool _windingTowardsEnd = true;  // Direction of the traverse in the last cycle, true = towards position2
+    float _windingStart = 0;         // Endpoint the traverse starts from in mm
+    float _windingEnd = 0;           // Endpoint the traverse moves to first in mm
+
+    /**
+     * @brief Engage the following at the current positions of master and stepper
+     *
+     */
+    void resetFollowOrigin();
+
+    /**
+     * @brief Engage the traverse at the current positions of spool and traverse, keeping the current direction
+     *
+     */
+    void resetWindingOrigin();
+
+   public:
+    /**
+     * @brief Construct a new gearing
+     *
+     * @param stepper geared stepper
+     */
+    StepperGearing(Stepper *stepper);
+
+    /**
+     * @brief Gear to a master for the FOLLOWING mode, takes effect with engageFollowing()
+     *
+     * @param master stepper to follow
+     * @param ratio rotations of the stepper per rotation of the master, negative values change direction
+     * @param source follow the measured speed or position of the master
+     */
+    void setFollowing(Stepper *master, float ratio, followSource_e source);
+
+    /**
+     * @brief Gear to a spool for the WINDING mode, takes effect with engageWinding()
+     *
+     * @param spool stepper driving the spool
+     * @param pitchMm traverse per spool rotation in mm
+     */
+    void setWinding(Stepper *spool, float pitchMm);
+
+    /**
+     * @brief Start following at the current positions, the load trim starts over
+     *
+     */
+    void engageFollowing();
+
+    /**
+     * @brief Start traversing from the current position towards the end position
+     *
+     * @param startMm position the traverse starts from in mm
+     * @param endMm position the traverse moves to first in mm
+     */
+    void engageWinding(float startMm, float endMm);
+
+    /**
+     * @brief Change the endpoints of the traverse, traversing continues from the current position
+     *
+     * @param startMm position the traverse starts from in mm
+     * @param endMm position the traverse moves to first in mm
+     */
+    void adjustWindingPositions(float startMm, float endMm);
+
+    /**
+     * @brief Derive the speed of the stepper while following: feedforward from the master with the current ratio, the correction of
+     * the geared position and the load trim on top. Advances the diameter estimation and the trim, so call once per handle()
+     *
+     * @param load current load of the stepper in %
+     * @param targetLoad load the trim aims for in %, 0 = no trim
+     * @param speedRpm memory location to write the speed to, in rpm as passed to Stepper::applySpeed()
+     * @return true speed derived
+     * @return false master not ready
+     */
+    bool computeFollowingSpeed(uint8_t load, uint8_t targetLoad, float &speedRpm);
+
+    /**
+     * @brief Derive the speed of the traverse while winding from the spool rotations
+     *
+     * @param speedRpm memory location to write the speed to, in rpm as passed to Stepper::applySpeed()
+     * @return true speed derived
+     * @return false spool not ready
+     */
+    bool computeWindingSpeed(float &speedRpm);
+
+    /**
+     * @brief Remember a derived speed as applied, unless it is close to the last applied one. Tiny changes caused by the speed
+     * measurement of the master are skipped that way
+     *
+     * @param speedRpm derived speed in rpm
+     * @return true speed remembered, pass it to the ramp generator
+     * @return false speed is close to the applied one
+     */
+    bool updateAppliedSpeed(float speedRpm);
+
+    /**
+     * @brief Change the ratio of the following without interrupting it, following the position continues from the current positions
+     *
+     * @param ratio rotations of the stepper per rotation of the master, negative values change direction
+     */
+    void adjustFollowRatio(float ratio);
+
+    // Getter-method, ratio in use, i.e. the estimated one while diameter estimation is enabled
+    float getFollowRatio();
+
+    /**
+     * @brief Derive the follow ratio from the winding diameter of the stepper as spool, estimated from the line length fed by the
+     * master per spool rotation. The ratio passed to setFollowing() only determines the direction then, the load trim corrects the
+     * remaining error
+     *
+     * @param coreDiameterMm diameter of the empty spool in mm, the estimation starts from here
+     * @param maxDiameterMm diameter of the full spool in mm
+     */
+    void enableDiameterEstimation(float coreDiameterMm, float maxDiameterMm);
+
+    /**
+     * @brief Go back to the fixed ratio set via setFollowing() or adjustFollowRatio()
+     *
+     */
+    void disableDiameterEstimation();
+
+    /**
+     * @brief Get the estimated winding diameter
+     *
+     * @return float diameter in mm, 0 if the diameter is not estimated
+     */
+    float getDiameter();
+
+    /**
+     * @brief Limit the speed change of the load trim while following
+     *
+     * @param limitRpm largest speed change in rpm
+     */
+    void setFollowTrimLimit(float limitRpm);
+
+    /**
+     * @brief Change the pitch of the winding without interrupting it, traversing continues from the current position
+     *
+     * @param pitchMm traverse per spool rotation in mm
+     */
+    void adjustWindingPitch(float pitchMm);
+
+    // Getter-method
+    float getWindingPitch();
+};
@@ -0,0 +1,93 @@
+// Related
+#include "StepperHoming.h"
+// System / External
+#include <Arduino.h>
+// Selfmade
+// Project
+#include "StepperTest.h"
+
+constexpr float StepperHoming::DEFAULT_SPEED_RPM;
+constexpr uint8_t StepperHoming::BUMPS_NEEDED;
+
+void StepperHoming::init(FastAccelStepper *stepper, uint32_t microstepsPerRotation, float mmPerRotation) {
+    _stepper = stepper;
+    _microstepsPerRotation = microstepsPerRotation;
+    _mmPerRotation = mmPerRotation;
+}
+
+void StepperHoming::start() {
+    _phase = HOMING_APPROACH;
+    _bumpCounter = 0;
+}
+
+bool StepperHoming::isBumpConfirmed(bool diagStall, bool fullLoad) {
+    // Motor was already stopped by the DIAG interrupt
+    if (diagStall) {
+        _bumpCounter = 0;
+        return true;
+    }
+    if (!fullLoad) {
+        _bumpCounter = 0;
+        return false;
+    }
+    _bumpCounter++;
+    return _bumpCounter > BUMPS_NEEDED;
+}
+
+bool StepperHoming::handle(bool diagStall, bool fullLoad, float &rpm) {
+    float direction = rpm < 0 ? -1 : 1;
+
+    switch (_phase) {
+        case HOMING_APPROACH:
+            if (!isBumpConfirmed(diagStall, fullLoad)) return false;
+            if (_config.backoffMm <= 0) break;
+
+            // Back off against the approach direction, positive speeds run backwards (see Stepper::applySpeed())
+            _stepper->forceStopAndNewPosition(0);
+            _bumpCounter = 0;
+            _phase = HOMING_BACKOFF;
+            _stepper->setSpeedInUs(speedRpmToUs(rpm, _microstepsPerRotation));
+            _stepper->applySpeedAcceleration();
+            _stepper->moveTo(mmToPosition(direction * _config.backoffMm, _microstepsPerRotation, _mmPerRotation));
+            return false;
+        case HOMING_BACKOFF:
+            if (_stepper->isRampGeneratorActive()) return false;
+
+            // Re-approach from standstill, positive speeds run backwards (see Stepper::applySpeed())
+            _phase = HOMING_REAPPROACH;
+            rpm = direction * abs(_config.slowRpm);
+            _stepper->setSpeedInUs(speedRpmToUs(rpm, _microstepsPerRotation));
+            _stepper->applySpeedAcceleration();
+            if (rpm < 0) {
+                _stepper->runForward();
+            } else {
+                _stepper->runBackward();
+            }
+            return false;
+        case HOMING_REAPPROACH:
+            if (!isBumpConfirmed(diagStall, fullLoad)) return false;
+            break;
+        default:  // Should never happen
+            return false;
+    }
+
+    // End stop confirmed, set home
+    _stepper->forceStopAndNewPosition(mmToPosition(_config.offsetMm, _microstepsPerRotation, _mmPerRotation));
+    _bumpCounter = 0;
+    return true;
+}
+
+bool StepperHoming::isBackingOff() { return _phase == HOMING_BACKOFF; }
+
+float StepperHoming::getSpeed() { return _config.fastRpm; }
+
+void StepperHoming::setSpeed(float newSpeedRpm) { _config.fastRpm = (newSpeedRpm <= 0) ? DEFAULT_SPEED_RPM : newSpeedRpm; }
+
+stepperHomingConfig_s StepperHoming::getConfig() { return _config; }
+
+void StepperHoming::setConfig(stepperHomingConfig_s config) {
+    setSpeed(config.fastRpm);
+    _config.slowRpm = (config.slowRpm <= 0) ? DEFAULT_SPEED_RPM : config.slowRpm;
+    _config.backoffMm = (config.backoffMm < 0) ? 0 : config.backoffMm;
+    _config.offsetMm = config.offsetMm;
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+// Related
+// System / External
+#include <FastAccelStepper.h>
+#include <stddef.h>
+#include <stdint.h>
+// Selfmade
+// Project
+
+/**
+ * @brief Homing procedure: approach the end stop, back off and re-approach slowly for a precise home position
+ *
+ */
+struct stepperHomingConfig_s {
+    float fastRpm;    // Speed of the first approach in rotations per minute, the sign determines the direction
+    float slowRpm;    // Speed of the re-approach in rotations per minute, low values can lead to glitchy load-measurement
+    float backoffMm;  // Distance to back off after the first contact in mm, 0 = home on first contact without re-approach
+    float offsetMm;   // Position in mm assigned to the home position
+};
+
+/**
+ * @brief Phases of the homing procedure
+ *
+ */
+enum homingPhase_e { HOMING_APPROACH, HOMING_BACKOFF, HOMING_REAPPROACH };
+
+/**
+ * @brief Homing procedure of a stepper, run by the HOMING mode. The end stop is detected by the load or the DIAG interrupt, which the
+ * stepper evaluates and passes to handle()
+ *
+ */
+class StepperHoming {
+   private:
+    static constexpr float DEFAULT_SPEED_RPM = 60;  // Default homing speed in rotations per minute
+    static constexpr uint8_t BUMPS_NEEDED = 2;      // Number of consecutive bumps (100% load) needed to be sure that we have found the
+                                                    // home position and not just measured a glitched load value
+
+    FastAccelStepper *_stepper = NULL;
+    uint32_t _microstepsPerRotation = 1;  // Count of step signals to be sent for one rotation
+    float _mmPerRotation = 1;             // Distance travelled per rotation in mm
+
+    stepperHomingConfig_s _config = {.fastRpm = DEFAULT_SPEED_RPM,
+                                     .slowRpm = DEFAULT_SPEED_RPM,
+                                     .backoffMm = 0,
+                                     .offsetMm = 0};  // Homing procedure, single approach by default
+    homingPhase_e _phase = HOMING_APPROACH;           // Current phase
+    uint8_t _bumpCounter = 0;                         // Number of consecutive bumps (100% load) while at homing-speed. Needed to detect
+                                                      // proper home-position opposed to glitched load values.
+
+    /**
+     * @brief Check whether the end stop was hit, requires BUMPS_NEEDED consecutive calls with full load at homing speed
+     *
+     * @param diagStall true = the DIAG interrupt detected a stall and already stopped the motor
+     * @param fullLoad true = approaching the end stop at homing speed with full load
+     * @return true end stop hit
+     * @return false still approaching
+     */
+    bool isBumpConfirmed(bool diagStall, bool fullLoad);
+
+   public:
+    /**
+     * @brief Attach to a stepper, must be called before start()
+     *
+     * @param stepper stepper to be homed
+     * @param microstepsPerRotation count of step signals for one rotation
+     * @param mmPerRotation distance travelled per rotation in mm
+     */
+    void init(FastAccelStepper *stepper, uint32_t microstepsPerRotation, float mmPerRotation);
+
+    /**
+     * @brief Start over with the first approach, the stepper already runs at the approach speed
+     *
+     */
+    void start();
+
+    /**
+     * @brief Advance the procedure through its phases, to be called every handle() while homing
+     *
+     * @param diagStall true = the DIAG interrupt detected a stall and already stopped the motor
+     * @param fullLoad true = approaching the end stop at homing speed with full load
+     * @param rpm speed of the current approach in rotations per minute, set to the re-approach speed when backing off finished
+     * @return true end stop confirmed, the position is set to the home offset
+     * @return false still homing
+     */
+    bool handle(bool diagStall, bool fullLoad, float &rpm);
+
+    /**
+     * @brief Check whether the stepper backs off from the end stop, it moves away from it meanwhile
+     *
+     * @return true backing off
+     * @return false approaching or not homing
+     */
+    bool isBackingOff();
+
+    // Getter-method, speed of the first approach
+    float getSpeed();
+
+    /**
+     * @brief Sets the homing speed of the first approach. Invalid (<= 0) values are corrected to the default(60 rpm)
+     *
+     * @param newSpeedRpm new speed in rotations per minute
+     */
+    void setSpeed(float newSpeedRpm);
+
+    // Getter-method
+    stepperHomingConfig_s getConfig();
+
+    /**
+     * @brief Sets the homing procedure. Invalid (<= 0) speeds are corrected to the default(60 rpm), negative distances to 0
+     *
+     * @param config new homing procedure
+     */
+    void setConfig(stepperHomingConfig_s config);
+};
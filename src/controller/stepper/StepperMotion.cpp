@@ -0,0 +1,146 @@
+// Related
+#include "StepperMotion.h"
+// System / External
+#include <Arduino.h>
+// Selfmade
+// Project
+
+constexpr uint8_t StepperMotion::OSCILLATION_STROKES_AHEAD;
+constexpr uint16_t StepperMotion::PATH_QUEUED_MS;
+
+void StepperMotion::init(FastAccelStepper *stepper) {
+    _stepper = stepper;
+    _queue.init(_stepper);
+}
+
+bool StepperMotion::isQueuedMode(stepperMode_e mode) {
+    switch (mode) {
+        case OSCILLATING_FORWARD:
+        case OSCILLATING_BACKWARD:
+        case PATH:
+            return true;
+        case POSITIONING:
+            return _jerk > 0;
+        default:
+            return false;
+    }
+}
+
+bool StepperMotion::isTransitionReady(stepperMode_e nextMode, uint16_t acceleration) {
+    if (nextMode == OFF) return true;  // Stops by force anyway
+
+    // Queued modes continue from the end of the running move, the ramp generator can only take over at standstill
+    if (_active) {
+        if (isQueuedMode(nextMode) || _queue.isIdle()) return true;
+        _queue.stopMove(acceleration);
+        return false;
+    }
+    if (isQueuedMode(nextMode) && _stepper->isRunning()) {
+        _stepper->stopMove();
+        return false;
+    }
+    return true;
+}
+
+void StepperMotion::startRecipe(stepperMode_e mode) {
+    bool wasActive = _active;
+    _active = isQueuedMode(mode);
+    if (_active) {
+        if (wasActive) {
+            _queue.clearPending();
+        } else {
+            _queue.clear();
+        }
+    }
+    _recipeMovesOrigin = _queue.getCompletedMoves();
+}
+
+void StepperMotion::clear(bool deactivate) {
+    _queue.clear();
+    if (deactivate) _active = false;
+}
+
+void StepperMotion::clearPending() { _queue.clearPending(); }
+
+void StepperMotion::fill() {
+    if (_active) _queue.fill();
+}
+
+bool StepperMotion::queueMoveTo(int32_t target, float speed, uint16_t acceleration, uint32_t dwellUs) {
+    int32_t distance = target - _queue.getEndPosition();
+    if (distance == 0) return false;
+
+    motionProfile_s profile;
+    planSCurveProfile(profile, abs(distance), abs(speed), acceleration, _jerk);
+    return _queue.addMove(profile, distance > 0, dwellUs);
+}
+
+void StepperMotion::moveTo(int32_t target, float speed, uint16_t acceleration) {
+    _queue.clearPending();
+    queueMoveTo(target, speed, acceleration);
+    fill();
+}
+
+stepperMode_e StepperMotion::startOscillation(bool forward, int32_t steps1, int32_t steps2, float speed, uint16_t acceleration) {
+    int32_t target = forward ? steps1 : steps2;
+    int32_t other = forward ? steps2 : steps1;
+    if (!queueMoveTo(target, speed, acceleration, _oscillationDwellUs)) {
+        queueMoveTo(other, speed, acceleration, _oscillationDwellUs);  // Already at the first position
+    }
+    return handleOscillation(steps1, steps2, speed, acceleration);
+}
+
+stepperMode_e StepperMotion::handleOscillation(int32_t steps1, int32_t steps2, float speed, uint16_t acceleration) {
+    // Reverse at the position opposite to the direction of the last queued stroke
+    while (_queue.getPendingMoves() < OSCILLATION_STROKES_AHEAD) {
+        int32_t target = _queue.isEndForward() ? min(steps1, steps2) : max(steps1, steps2);
+        if (!queueMoveTo(target, speed, acceleration, _oscillationDwellUs)) break;
+    }
+    _queue.fill();
+
+    return (_queue.isActiveForward() == (steps1 > steps2)) ? OSCILLATING_FORWARD : OSCILLATING_BACKWARD;
+}
+
+bool StepperMotion::addWaypoint(int32_t target, float speed, bool newPath) {
+    if (newPath) _planner.reset();
+    return _planner.add(target, abs(speed));
+}
+
+bool StepperMotion::handlePath(uint16_t acceleration, float &speed) {
+    // Release segments until the queued motion outlasts a few handle()-calls, later ones stay in the planner so waypoints added
+    // meanwhile are still considered by the look-ahead. Converting right away frees the slots for more short segments
+    motionProfile_s profile;
+    bool forward;
+    while (_queue.getQueuedUs() < PATH_QUEUED_MS * 1000 && _queue.getFreeMoves() > 0 &&
+           _planner.pop(_queue.getEndPosition(), acceleration, profile, forward)) {
+        _queue.addMove(profile, forward);
+        _queue.fill();
+        speed = profile.vCruise;
+    }
+    _queue.fill();
+
+    return _planner.getCount() > 0 || !_queue.isIdle();
+}
+
+void StepperMotion::prepareGroupMove(const motionProfile_s &profile, bool forward) {
+    _active = true;
+    _queue.clear();
+    _queue.addMove(profile, forward);
+    _queue.fill(false);
+}
+
+void StepperMotion::startGroupMove() { _queue.start(); }
+
+bool StepperMotion::isActive() { return _active; }
+
+bool StepperMotion::isIdle() { return _queue.isIdle(); }
+
+uint32_t StepperMotion::getRecipeMoves() { return _active ? _queue.getCompletedMoves() - _recipeMovesOrigin : 0; }
+
+uint16_t StepperMotion::getOscillationDwell() { return _oscillationDwellUs / 1000; }
+
+void StepperMotion::setOscillationDwell(uint16_t dwellMs) { _oscillationDwellUs = (uint32_t)dwellMs * 1000; }
+
+void StepperMotion::adjustJerk(uint32_t newJerk) { _jerk = newJerk; }
+
+uint32_t StepperMotion::getJerk() { return _jerk; }
@@ -0,0 +1,212 @@
+#pragma once
+
+// Related
+// System / External
+#include <FastAccelStepper.h>
+#include <stdint.h>
+// Selfmade
+// Project
+#include "../../motion/MotionProfile.h"
+#include "../../motion/SegmentPlanner.h"
+#include "StepperQueue.h"
+#include "StepperTest.h"
+
+/**
+ * @brief Queued motion of a stepper: jerk-limited positioning, oscillation with reversals planned ahead and paths through waypoints.
+ * Moves are planned from the end of the queued ones and fed to the command queue of FastAccelStepper, the ramp generator is not
+ * used meanwhile. Positions are given in steps and speeds in steps/s, Stepper converts them from the units of its recipes
+ *
+ */
+class StepperMotion {
+   private:
+    static constexpr uint8_t OSCILLATION_STROKES_AHEAD = 2;  // Number of oscillation strokes planned ahead, so the next reversal is
+                                                             // always queued
+    static constexpr uint16_t PATH_QUEUED_MS = 50;           // Motion kept queued along a path, several handle()-periods so short
+                                                             // segments do not run dry between two calls
+
+    FastAccelStepper *_stepper = NULL;
+
+    StepperQueue _queue;              // Feeds planned moves into the command queue of FastAccelStepper
+    SegmentPlanner _planner;          // Waypoints of the PATH mode, released to the queue with look-ahead
+    bool _active = false;             // Flag whether the current recipe is driven by the queue instead of the ramp generator
+    uint32_t _recipeMovesOrigin = 0;  // Completed queue moves when the current recipe started, see getRecipeMoves()
+
+    // Soft configuration
+    uint32_t _jerk = 0;                // Change of acceleration in steps/s³, 0 = constant acceleration
+    uint32_t _oscillationDwellUs = 0;  // Pause at each reversal while oscillating in us
+
+    /**
+     * @brief Plan a rest-to-rest move from the end of the queued moves to a target and append it
+     *
+     * @param target position in steps
+     * @param speed highest speed in steps/s, the sign is ignored
+     * @param acceleration acceleration in steps/s²
+     * @param dwellUs pause after the move in us
+     * @return true move queued
+     * @return false already at the target or no space left
+     */
+    bool queueMoveTo(int32_t target, float speed, uint16_t acceleration, uint32_t dwellUs = 0);
+
+   public:
+    /**
+     * @brief Attach to a stepper, must be called before any other method
+     *
+     * @param stepper stepper to feed
+     */
+    void init(FastAccelStepper *stepper);
+
+    /**
+     * @brief Check whether a mode is driven by the queue, which is needed for oscillation, paths and S-curve profiles
+     *
+     * @param mode mode to check
+     * @return true queue
+     * @return false ramp generator of FastAccelStepper
+     */
+    bool isQueuedMode(stepperMode_e mode);
+
+    /**
+     * @brief Check whether the next mode can be started without a forced stop. If not, a smooth stop is initiated: queued moves and
+     * the ramp generator can not blend into each other and hand over at standstill
+     *
+     * @param nextMode mode to be started
+     * @param acceleration deceleration of the stop in steps/s²
+     * @return true next mode can be started right away
+     * @return false wait for the motor to stop
+     */
+    bool isTransitionReady(stepperMode_e nextMode, uint16_t acceleration);
+
+    /**
+     * @brief Take over the motion for a new recipe if its mode is queued. Queued modes continue from the end of the running move
+     *
+     * @param mode mode of the new recipe
+     */
+    void startRecipe(stepperMode_e mode);
+
+    /**
+     * @brief Drop all moves, e.g. after a forced stop. Commands already in the queue of FastAccelStepper are not touched
+     *
+     * @param deactivate true = hand the motion back to the ramp generator
+     */
+    void clear(bool deactivate = false);
+
+    /**
+     * @brief Drop the moves that have not started yet, e.g. to plan them again with new positions or speed
+     *
+     */
+    void clearPending();
+
+    /**
+     * @brief Feed the queue of FastAccelStepper, to be called every handle() while active
+     *
+     */
+    void fill();
+
+    /**
+     * @brief Approach a position with a jerk-limited move, replacing moves that have not started yet. A running move is finished
+     * first, so this also retargets
+     *
+     * @param target target position in steps
+     * @param speed highest speed in steps/s, the sign is ignored
+     * @param acceleration acceleration in steps/s²
+     */
+    void moveTo(int32_t target, float speed, uint16_t acceleration);
+
+    /**
+     * @brief Start oscillating from the end of the queued moves
+     *
+     * @param forward true = start by moving to position1, false = start by moving to position2
+     * @param steps1 first endpoint in steps
+     * @param steps2 second endpoint in steps
+     * @param speed highest speed in steps/s, the sign is ignored
+     * @param acceleration acceleration in steps/s²
+     * @return stepperMode_e OSCILLATING_FORWARD or OSCILLATING_BACKWARD, see handleOscillation()
+     */
+    stepperMode_e startOscillation(bool forward, int32_t steps1, int32_t steps2, float speed, uint16_t acceleration);
+
+    /**
+     * @brief Keep OSCILLATION_STROKES_AHEAD strokes queued and feed them to FastAccelStepper
+     *
+     * @param steps1 first endpoint in steps
+     * @param steps2 second endpoint in steps
+     * @param speed highest speed in steps/s, the sign is ignored
+     * @param acceleration acceleration in steps/s²
+     * @return stepperMode_e OSCILLATING_FORWARD or OSCILLATING_BACKWARD, reflecting the stroke currently fed to the queue
+     */
+    stepperMode_e handleOscillation(int32_t steps1, int32_t steps2, float speed, uint16_t acceleration);
+
+    /**
+     * @brief Append a waypoint to the path
+     *
+     * @param target target position in steps
+     * @param speed highest speed on the way to it in steps/s, the sign is ignored
+     * @param newPath true = drop the waypoints of the previous path first
+     * @return true waypoint added
+     * @return false look-ahead buffer full, try again later
+     */
+    bool addWaypoint(int32_t target, float speed, bool newPath);
+
+    /**
+     * @brief Release planned path segments to the queue until PATH_QUEUED_MS are queued
+     *
+     * @param acceleration acceleration in steps/s²
+     * @param speed memory location to write the cruise speed of the last released segment in steps/s to, untouched if none was
+     * released
+     * @return true path still running
+     * @return false last waypoint reached
+     */
+    bool handlePath(uint16_t acceleration, float &speed);
+
+    /**
+     * @brief Load a planned move without starting it, see MotionGroup
+     *
+     * @param profile planned move in steps
+     * @param forward direction, true = position counts up
+     */
+    void prepareGroupMove(const motionProfile_s &profile, bool forward);
+
+    /**
+     * @brief Start the move loaded by prepareGroupMove()
+     *
+     */
+    void startGroupMove();
+
+    // Getter-method, flag whether the current recipe is driven by the queue
+    bool isActive();
+
+    /**
+     * @brief Check whether all queued moves have been executed
+     *
+     * @return true no moves left and the stepper is not running
+     * @return false still moving
+     */
+    bool isIdle();
+
+    /**
+     * @brief Get the number of queued moves finished since the current recipe started, e.g. the strokes of an oscillation. The approach
+     * to the first position counts as a stroke as well
+     *
+     * @return uint32_t finished moves, 0 if the current recipe is not driven by the queue
+     */
+    uint32_t getRecipeMoves();
+
+    // Getter-method
+    uint16_t getOscillationDwell();
+
+    /**
+     * @brief Set the pause at each reversal while oscillating, applies from the next queued stroke on
+     *
+     * @param dwellMs pause in ms, 0 = reverse right away
+     */
+    void setOscillationDwell(uint16_t dwellMs);
+
+    /**
+     * @brief Set the jerk limit of positioning and oscillation moves (S-curve speed profile), applies from the next move on. Smooth
+     * acceleration excites less resonances and allows higher speeds on the same mechanics
+     *
+     * @param newJerk change of acceleration in steps/s³, 0 = constant acceleration
+     */
+    void adjustJerk(uint32_t newJerk);
+
+    // Getter-method
+    uint32_t getJerk();
+};
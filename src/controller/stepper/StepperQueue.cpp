@@ -0,0 +1,223 @@
+// Related
+#include "StepperQueue.h"
+// System / External
+#include <FastAccelStepper.h>
+#include <math.h>
+// Selfmade
+// Project
+#include "../../logger/logging.h"
+
+void StepperQueue::init(FastAccelStepper *stepper) {
+    _stepper = stepper;
+    clear();
+}
+
+bool StepperQueue::addMove(const motionProfile_s &profile, bool forward, uint32_t dwellUs) {
+    if (_count >= STEPPER_QUEUE_MOVES) return false;
+
+    stepperQueueMove_s &move = _moves[(_head + _count) % STEPPER_QUEUE_MOVES];
+    move.profile = profile;
+    move.forward = forward;
+    move.dwellUs = dwellUs;
+    _count++;
+
+    int32_t steps = lroundf(profile.distance);
+    _endPosition += forward ? steps : -steps;
+    _endForward = forward;
+    return true;
+}
+
+void StepperQueue::clear() {
+    _count = 0;
+    _completedMoves = 0;
+    _rejectedCommands = 0;
+    _moveTime = 0;
+    _moveTicks = 0;
+    _moveSteps = 0;
+    _moveDwelled = false;
+    _pendingTicks = 0;
+    _pendingSteps = 0;
+    if (_stepper != NULL) _endPosition = _stepper->getCurrentPosition();
+}
+
+uint8_t StepperQueue::clearPending() {
+    bool started = _moveSteps > 0 || _moveDwelled || _pendingTicks > 0;
+    uint8_t keep = (started && _count > 0) ? 1 : 0;
+    uint8_t dropped = _count - keep;
+
+    // Take the dropped moves back out of the end position
+    for (uint8_t i = keep; i < _count; ++i) {
+        stepperQueueMove_s &move = _moves[(_head + i) % STEPPER_QUEUE_MOVES];
+        int32_t steps = lroundf(move.profile.distance);
+        _endPosition -= move.forward ? steps : -steps;
+    }
+    if (keep > 0) _endForward = _moves[_head].forward;
+    _count = keep;
+    return dropped;
+}
+
+void StepperQueue::start() {
+    if (_stepper == NULL || _stepper->isRunning()) return;
+    _stepper->addQueueEntry(NULL, true);
+}
+
+void StepperQueue::stopMove(float accel) {
+    clearPending();
+    if (_count == 0) return;
+
+    stepperQueueMove_s &move = _moves[_head];
+    uint32_t remaining = lroundf(move.profile.distance) - _moveSteps;
+    float speed = profileVelocityAt(move.profile, _moveTime);
+    uint32_t stopSteps = ceilf(speed * speed / (2 * accel));
+    if (stopSteps >= remaining) return;
+
+    // Continue from the speed at the end of the commands sent so far
+    int32_t skipped = remaining - stopSteps;
+    _endPosition -= move.forward ? skipped : -skipped;
+    planTrapezoidProfile(move.profile, stopSteps, speed, speed, 0, accel);
+    move.dwellUs = 0;
+    _moveTime = 0;
+    _moveTicks = 0;
+    _moveSteps = 0;
+    _moveDwelled = false;
+}
+
+void StepperQueue::finishMove() {
+    _head = (_head + 1) % STEPPER_QUEUE_MOVES;
+    _count--;
+    _completedMoves++;
+    _moveTime = 0;
+    _moveTicks = 0;
+    _moveSteps = 0;
+    _moveDwelled = false;
+}
+
+uint32_t StepperQueue::ticksUntil(float time) {
+    float ticks = time * TICKS_PER_S;
+    return ticks > _moveTicks ? (uint32_t)(ticks - _moveTicks) : 0;
+}
+
+bool StepperQueue::planCommand() {
+    while (_count > 0) {
+        stepperQueueMove_s &move = _moves[_head];
+        uint32_t totalSteps = lroundf(move.profile.distance);
+
+        if (_moveSteps < totalSteps) {
+            // Aim for commands of COMMAND_TIME_S, the last one takes all remaining steps so it does not get too short
+            uint32_t remaining = totalSteps - _moveSteps;
+            uint32_t steps = lroundf(profileVelocityAt(move.profile, _moveTime) * COMMAND_TIME_S);
+            steps = max((uint32_t)1, min(steps, (uint32_t)MAX_COMMAND_STEPS));
+            if (remaining < 2 * steps) steps = min(remaining, (uint32_t)MAX_COMMAND_STEPS);
+
+            // Steps are spaced evenly within a command, the rounding error is carried over to the next one
+            float endTime = profileTimeAtPosition(move.profile, _moveSteps + steps);
+            uint32_t ticks = ticksUntil(endTime);
+            if (steps > 1 && ticks / steps > MAX_COMMAND_TICKS) {
+                steps = 1;
+                endTime = profileTimeAtPosition(move.profile, _moveSteps + 1);
+                ticks = ticksUntil(endTime);
+            }
+            ticks = max(ticks / steps, MIN_STEP_TICKS);
+
+            // A single fast step, e.g. at the start or end of a short blended move, is shorter than FastAccelStepper accepts. Take more
+            // steps into the command, if the move has no more the steps are stretched and the next command makes up for it
+            if (ticks * steps < MIN_TICKS) {
+                uint32_t needed = min((MIN_TICKS + ticks - 1) / ticks, min(remaining, (uint32_t)MAX_COMMAND_STEPS));
+                if (needed > steps) {
+                    steps = needed;
+                    endTime = profileTimeAtPosition(move.profile, _moveSteps + steps);
+                    ticks = max(ticksUntil(endTime) / steps, MIN_STEP_TICKS);
+                }
+                ticks = max(ticks, (MIN_TICKS + steps - 1) / steps);
+            }
+
+            _pendingSteps = steps;
+            _pendingTicks = ticks;
+            _moveSteps += steps;
+            _moveTicks += ticks * steps;
+            _moveTime = endTime;
+            return true;
+        }
+
+        if (!_moveDwelled) {
+            _moveDwelled = true;
+            if (move.dwellUs > 0) {
+                _pendingSteps = 0;
+                _pendingTicks = max(move.dwellUs * (uint32_t)(TICKS_PER_S / 1000000), MIN_TICKS);  // Shorter pauses are refused
+                return true;
+            }
+        }
+
+        finishMove();
+    }
+    return false;
+}
+
+uint8_t StepperQueue::fill(bool start) {
+    if (_stepper == NULL) return 0;
+
+    uint8_t added = 0;
+    while (!_stepper->isQueueFull()) {
+        if (_pendingTicks == 0 && !planCommand()) break;
+
+        // Periods too long for a single command are preceded by pauses
+        bool split = _pendingTicks > MAX_COMMAND_TICKS;
+        stepper_command_s command;
+        command.ticks = split ? PAUSE_CHUNK_TICKS : _pendingTicks;
+        command.steps = split ? 0 : _pendingSteps;
+        command.count_up = _count > 0 ? _moves[_head].forward : _endForward;
+        int8_t result = _stepper->addQueueEntry(&command, start);
+        if (result > AQE_OK) break;  // Queue full or step generator busy, retried on the next call
+
+        if (result < AQE_OK) {
+            // Refused for good, drop the command so the moves behind it are not blocked
+            logPrint(ERROR, ERROR, "{queue: {event: 'rejected', code: %d, ticks: %u, steps: %u}}\n", result, _pendingTicks, _pendingSteps);
+            int32_t dropped = _pendingSteps;
+            _endPosition -= command.count_up ? dropped : -dropped;
+            _rejectedCommands++;
+            _pendingTicks = 0;
+            _pendingSteps = 0;
+            continue;
+        }
+
+        if (split) {
+            _pendingTicks -= PAUSE_CHUNK_TICKS;
+        } else {
+            _pendingTicks = 0;
+            _pendingSteps = 0;
+        }
+        added++;
+    }
+    return added;
+}
+
+bool StepperQueue::isIdle() { return _count == 0 && _pendingTicks == 0 && (_stepper == NULL || !_stepper->isRunning()); }
+
+uint32_t StepperQueue::getQueuedUs() {
+    if (_stepper == NULL) return 0;
+
+    // The planned command is already covered by the progress of the first move
+    float ticks = _stepper->ticksInQueue();
+    ticks += _pendingSteps > 0 ? (float)_pendingTicks * _pendingSteps : _pendingTicks;
+    for (uint8_t i = 0; i < _count; ++i) {
+        const stepperQueueMove_s &move = _moves[(_head + i) % STEPPER_QUEUE_MOVES];
+        bool first = i == 0;
+        ticks += fmaxf(profileDuration(move.profile) - (first ? _moveTime : 0), 0) * TICKS_PER_S;
+        if (!first || !_moveDwelled) ticks += move.dwellUs * (TICKS_PER_S / 1000000);
+    }
+    return ticks / (TICKS_PER_S / 1000000);
+}
+
+uint8_t StepperQueue::getPendingMoves() { return _count; }
+
+uint8_t StepperQueue::getFreeMoves() { return STEPPER_QUEUE_MOVES - _count; }
+
+int32_t StepperQueue::getEndPosition() { return _endPosition; }
+
+bool StepperQueue::isActiveForward() { return _count > 0 ? _moves[_head].forward : _endForward; }
+
+bool StepperQueue::isEndForward() { return _endForward; }
+
+uint32_t StepperQueue::getCompletedMoves() { return _completedMoves; }
+
+uint32_t StepperQueue::getRejectedCommands() { return _rejectedCommands; }
@@ -0,0 +1,177 @@
+#pragma once
+
+// Related
+// System / External
+#include <FastAccelStepper.h>
+#include <stdint.h>
+// Selfmade
+// Project
+#include "../../motion/MotionProfile.h"
+
+#ifndef STEPPER_QUEUE_MOVES
+#define STEPPER_QUEUE_MOVES 4  // Number of moves that can be planned ahead
+#endif
+
+/**
+ * @brief Move waiting to be converted into queue commands
+ *
+ */
+struct stepperQueueMove_s {
+    motionProfile_s profile;  // Speed over time of the move
+    bool forward;             // Direction, true = position counts up
+    uint32_t dwellUs;         // Pause after the move in us
+};
+
+/**
+ * @brief Feeds planned moves into the command queue of FastAccelStepper. The moves are sampled into commands of a few ms, which are
+ * executed by the step generator in hardware. Reversals and dwells therefore happen at exact positions and times, independent of how
+ * often fill() is called as long as the queue does not run dry (about 60 ms ahead). Must not be mixed with the ramp generator (moveTo(),
+ * runForward(), ...), stop the stepper and clear() before switching
+ *
+ */
+class StepperQueue {
+   private:
+    const float COMMAND_TIME_S = 0.002;        // Targeted duration of a single queue command in s
+    const uint32_t MAX_COMMAND_TICKS = 65535;  // Longest step period or pause of a single queue command
+    const uint16_t PAUSE_CHUNK_TICKS = 32768;  // Pause used to split up periods longer than MAX_COMMAND_TICKS
+    const uint8_t MAX_COMMAND_STEPS = 255;     // Most steps in a single queue command
+    const uint32_t MIN_STEP_TICKS = 320;       // Shortest step period (50 kHz), guards against rounding errors
+    const uint32_t MIN_TICKS = MIN_CMD_TICKS;  // Shortest command (steps * period, or pause) accepted by FastAccelStepper, 200 us
+
+    FastAccelStepper *_stepper = NULL;
+    stepperQueueMove_s _moves[STEPPER_QUEUE_MOVES];  // Ring buffer of moves, the first one is currently converted into commands
+    uint8_t _head = 0;                               // Index of the first move
+    uint8_t _count = 0;                              // Number of moves in the ring buffer
+    int32_t _endPosition = 0;                        // Position after all moves, in steps
+    bool _endForward = true;                         // Direction of the last move
+    uint32_t _completedMoves = 0;                    // Number of moves fully converted into commands since clear()
+    uint32_t _rejectedCommands = 0;                  // Number of commands FastAccelStepper refused since clear(), dropped
+
+    // Progress of the first move
+    float _moveTime = 0;         // Time of the move covered by commands in s
+    uint32_t _moveTicks = 0;     // Time of the move covered by commands in ticks, limits moves to 268 s
+    uint32_t _moveSteps = 0;     // Steps of the move covered by commands
+    bool _moveDwelled = false;   // Flag whether the dwell after the move has been planned
+    uint32_t _pendingTicks = 0;  // Step period of the planned command, or the length of a pause if there are no steps
+    uint8_t _pendingSteps = 0;   // Steps of the planned command, 0 = pause
+
+    /**
+     * @brief Plan the next command of the first move into _pendingTicks and _pendingSteps, finished moves are removed
+     *
+     * @return true command planned
+     * @return false no moves left
+     */
+    bool planCommand();
+
+    /**
+     * @brief Get the ticks between the end of the last command and a point in time of the first move
+     *
+     * @param time time since start of the move in s
+     * @return uint32_t ticks, 0 if the time is already covered
+     */
+    uint32_t ticksUntil(float time);
+
+    /**
+     * @brief Remove the first move and reset the progress
+     *
+     */
+    void finishMove();
+
+   public:
+    /**
+     * @brief Attach to a stepper, must be called before any other method
+     *
+     * @param stepper stepper to feed
+     */
+    void init(FastAccelStepper *stepper);
+
+    /**
+     * @brief Append a move after all others
+     *
+     * @param profile speed over time, the distance is rounded to full steps
+     * @param forward direction, true = position counts up
+     * @param dwellUs pause after the move in us
+     * @return true move added
+     * @return false no space left
+     */
+    bool addMove(const motionProfile_s &profile, bool forward, uint32_t dwellUs = 0);
+
+    /**
+     * @brief Drop all moves and start over from the current position. Commands already in the queue of FastAccelStepper are not touched,
+     * stop the stepper first
+     *
+     */
+    void clear();
+
+    /**
+     * @brief Drop all moves that have not started yet, the first move is finished if it already sent commands
+     *
+     * @return uint8_t number of dropped moves
+     */
+    uint8_t clearPending();
+
+    /**
+     * @brief Start the step generator on commands added via fill(false), e.g. to start several steppers at the same time
+     *
+     */
+    void start();
+
+    /**
+     * @brief Decelerate to standstill as fast as possible: drop all moves that have not started yet and replace the rest of the first
+     * move by a deceleration ramp, unless it ends earlier anyway. Commands already in the queue of FastAccelStepper are executed first
+     *
+     * @param accel deceleration in steps/s²
+     */
+    void stopMove(float accel);
+
+    /**
+     * @brief Convert moves into commands until the queue of FastAccelStepper is full, to be called repeatedly. Commands refused with
+     * an error are logged and dropped, their steps are taken out of the end position
+     *
+     * @param start true = start the step generator right away, false = only fill the queue
+     * @return uint8_t number of commands added
+     */
+    uint8_t fill(bool start = true);
+
+    /**
+     * @brief Check whether all moves have been executed
+     *
+     * @return true no moves left and the stepper is not running
+     * @return false still moving
+     */
+    bool isIdle();
+
+    /**
+     * @brief Get how long the stepper keeps moving without further moves: commands in the queue of FastAccelStepper plus the moves
+     * and dwells not converted yet
+     *
+     * @return uint32_t time in us
+     */
+    uint32_t getQueuedUs();
+
+    // Getter-method
+    uint8_t getPendingMoves();
+
+    // Getter-method
+    uint8_t getFreeMoves();
+
+    // Getter-method
+    int32_t getEndPosition();
+
+    /**
+     * @brief Get the direction of the move currently converted into commands
+     *
+     * @return true position counts up, or counted up in the last move if there are no moves left
+     * @return false position counts down
+     */
+    bool isActiveForward();
+
+    // Getter-method
+    bool isEndForward();
+
+    // Getter-method
+    uint32_t getCompletedMoves();
+
+    // Getter-method
+    uint32_t getRejectedCommands();
+};
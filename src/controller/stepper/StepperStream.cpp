@@ -0,0 +1,141 @@
+// Related
+#include "StepperStream.h"
+// System / External
+#include <Arduino.h>
+// Selfmade
+// Project
+#include "../../utils/SerialClaim.h"
+#include "../../utils/Utils.h"
+
+void StepperStream::attach(FastAccelStepper *stepper, TmcDriver *driver, TmcBusScheduler *scheduler, uint8_t microstepsPerStep) {
+    _stepper = stepper;
+    _driver = driver;
+    _busScheduler = scheduler;
+    _microstepsPerStep = microstepsPerStep;
+}
+
+bool StepperStream::start(uint8_t channel, stepperStreamMode_e mode, uint32_t periodUs) {
+    if (_stepper == NULL) return false;
+    if (_timer == NULL) {
+        esp_timer_create_args_t timerArgs = {};
+        timerArgs.callback = onTimer;
+        timerArgs.arg = this;
+        timerArgs.dispatch_method = ESP_TIMER_TASK;
+        timerArgs.name = "stepperStream";
+        if (esp_timer_create(&timerArgs, &_timer) != ESP_OK) {
+            _timer = NULL;
+            return false;
+        }
+    }
+    esp_timer_stop(_timer);  // Restart with the new period if already streaming
+
+    _mode = mode;
+    _periodUs = max(periodUs, STEPPER_STREAM_MIN_PERIOD_US);
+    for (uint8_t i = 0; i < 2; ++i) {
+        _frames[i].sync = STEPPER_STREAM_SYNC;
+        _frames[i].channel = channel;
+    }
+    _frames[_fillFrame].sampleCount = 0;
+    _dropped = 0;
+    _active = true;
+    esp_timer_start_periodic(_timer, _periodUs);
+    return true;
+}
+
+void StepperStream::stop() {
+    if (_timer != NULL) esp_timer_stop(_timer);
+    portENTER_CRITICAL(&_mux);
+    if (_active) {
+        _active = false;
+        if (_frames[_fillFrame].sampleCount > 0) swapFrames();
+    }
+    portEXIT_CRITICAL(&_mux);
+}
+
+bool StepperStream::isSampleDue(int32_t fullStep) {
+    if (!_active) return false;
+
+    // The fixed rate is kept by the timer calling this once per period
+    if (_mode == STREAM_FULL_STEP) {
+        if (fullStep == _lastFullStep) return false;
+        _lastFullStep = fullStep;
+    }
+    return true;
+}
+
+void StepperStream::addSample(const stepperStreamSample_s &sample) {
+    portENTER_CRITICAL(&_mux);
+    stepperStreamFrame_s &frame = _frames[_fillFrame];
+    if (frame.sampleCount >= STEPPER_STREAM_BLOCK_LENGTH) {
+        // Both frames full, the sample is lost
+        if (_dropped < UINT16_MAX) _dropped++;
+    } else {
+        frame.samples[frame.sampleCount++] = sample;
+        if (frame.sampleCount == STEPPER_STREAM_BLOCK_LENGTH) swapFrames();
+    }
+    portEXIT_CRITICAL(&_mux);
+}
+
+void StepperStream::onTimer(void *stream) { ((StepperStream *)stream)->takeSample(); }
+
+void StepperStream::takeSample() {
+    int32_t position = _stepper->getCurrentPosition();
+    if (!isSampleDue(position / (int32_t)_microstepsPerStep)) return;
+
+    TMC2130_n::DRV_STATUS_t drvStatus{0};
+    drvStatus.sr = _driver->isScheduled() ? _busScheduler->read(_driver) : _driver->sampleDrvStatus();
+
+    stepperStreamSample_s sample;
+    sample.timeUs = micros();
+    sample.speedUs = _stepper->getCurrentSpeedInUs();
+    sample.position = position;
+    sample.stall = drvStatus.sg_result;
+    addSample(sample);
+}
+
+void StepperStream::swapFrames() {
+    if (_sendPending) return;  // Other frame is still being sent, keep filling until it is free
+
+    stepperStreamFrame_s &frame = _frames[_fillFrame];
+    frame.sequence = _sequence++;
+    frame.dropped = _dropped;
+    _dropped = 0;
+
+    // The checksum directly follows the last valid sample, so frames are sent without unused sample slots
+    uint16_t length = offsetof(stepperStreamFrame_s, samples) + frame.sampleCount * sizeof(stepperStreamSample_s);
+    uint16_t crc = crc16Ccitt((uint8_t *)&frame, length);
+    memcpy((uint8_t *)&frame + length, &crc, sizeof(crc));
+
+    _sendPending = true;
+    _sendCursor = 0;
+    _fillFrame ^= 1;
+    _frames[_fillFrame].sampleCount = 0;
+}
+
+void StepperStream::transmit() {
+    // Frame that filled up while the other one was still sent, or remaining samples after stopping
+    portENTER_CRITICAL(&_mux);
+    uint8_t fillCount = _frames[_fillFrame].sampleCount;
+    if (!_sendPending && (fillCount == STEPPER_STREAM_BLOCK_LENGTH || (!_active && fillCount > 0))) swapFrames();
+    portEXIT_CRITICAL(&_mux);
+    if (!_sendPending) return;
+
+    // The sampling task only touches the frame being filled, so the pending frame is sent outside of the critical section
+
+    stepperStreamFrame_s &frame = _frames[_fillFrame ^ 1];
+    uint16_t length = offsetof(stepperStreamFrame_s, samples) + frame.sampleCount * sizeof(stepperStreamSample_s) + sizeof(frame.crc);
+    if (!claimSerial(this)) return;
+    int available = Serial.availableForWrite();
+    if (available <= 0) return;
+
+    uint16_t chunk = min((uint16_t)available, (uint16_t)(length - _sendCursor));
+    _sendCursor += Serial.write((uint8_t *)&frame + _sendCursor, chunk);
+    if (_sendCursor >= length) {
+        _sendPending = false;
+        releaseSerial(this);
+    }
+}
+
+bool StepperStream::isActive() { return _active; }
+
+uint32_t StepperStream::getPeriodUs() { return _periodUs; }
@@ -0,0 +1,161 @@
+#pragma once
+
+// Related
+// System / External
+#include <Arduino.h>
+#include <FastAccelStepper.h>
+#include <esp_timer.h>
+#include <stdint.h>
+// Selfmade
+// Project
+#include "TmcBusScheduler.h"
+#include "TmcDriver.h"
+
+#ifndef STEPPER_STREAM_BLOCK_LENGTH
+#define STEPPER_STREAM_BLOCK_LENGTH 32  // Samples per transmitted frame, can be overwritten via build flag
+#endif
+
+const uint16_t STEPPER_STREAM_SYNC = 0x5AA5;        // Marks the start of a frame, sent as 0xA5 0x5A
+const uint32_t STEPPER_STREAM_MIN_PERIOD_US = 100;  // Shortest sampling period, a status read takes about 20 us of SPI traffic
+
+/**
+ * @brief Events a sample is taken on
+ *
+ */
+enum stepperStreamMode_e {
+    STREAM_FIXED_RATE,  // Sample in a fixed interval
+    STREAM_FULL_STEP    // Sample once per full step, matching the update rate of the stall value. The position is checked every period
+};
+
+/**
+ * @brief Single sample of the stall signal
+ *
+ */
+struct __attribute__((packed)) stepperStreamSample_s {
+    uint32_t timeUs;   // micros() at time of sampling
+    int32_t speedUs;   // Current speed in us between steps, negative values for backwards movement
+    int32_t position;  // Position in steps
+    uint16_t stall;    // Raw stall value 0...1023
+};
+
+/**
+ * @brief Binary frame as sent over Serial: header, samples and a CRC-16/CCITT over header and samples
+ *
+ */
+struct __attribute__((packed)) stepperStreamFrame_s {
+    uint16_t sync;                                               // Always STEPPER_STREAM_SYNC
+    uint8_t channel;                                             // Channel id given when starting the stream
+    uint8_t sampleCount;                                         // Number of valid samples
+    uint16_t sequence;                                           // Frame counter, gaps indicate lost frames
+    uint16_t dropped;                                            // Samples dropped since the previous frame as both buffers were full
+    stepperStreamSample_s samples[STEPPER_STREAM_BLOCK_LENGTH];  // Samples, only sampleCount are sent
+    uint16_t crc;                                                // Checksum, sent directly after the last valid sample
+};
+
+/**
+ * @brief Double-buffered acquisition of stall samples, one frame is filled while the other one is sent without blocking
+ *
+ * Samples are taken by a timer task, frames are sent from the loop. Both meet at the frame swap, which is protected by a critical
+ * section.
+ */
+class StepperStream {
+   private:
+    // Sampled stepper
+    FastAccelStepper *_stepper = NULL;      // Step generator, provides position and speed
+    TmcDriver *_driver = NULL;              // Driver the stall value is read from
+    TmcBusScheduler *_busScheduler = NULL;  // Optional scheduler the reads are charged to
+    uint8_t _microstepsPerStep = 1;         // Microsteps per full step
+    esp_timer_handle_t _timer = NULL;       // Periodic timer taking the samples, created by the first start()
+
+    stepperStreamFrame_s _frames[2] = {};              // Frame being filled and frame being sent
+    uint8_t _fillFrame = 0;                            // Index of the frame being filled
+    volatile bool _sendPending = false;                // Flag whether the other frame waits to be sent
+    uint16_t _sendCursor = 0;                          // Bytes of the pending frame already sent
+    portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;  // Protects the frame swap between the sampling task and the loop
+
+    // Configuration
+    volatile bool _active = false;                  // Flag whether samples are taken
+    stepperStreamMode_e _mode = STREAM_FIXED_RATE;  // Events a sample is taken on
+    uint32_t _periodUs = 1000;                      // Sampling interval, in full step mode the interval the position is checked in
+
+    // Status
+    int32_t _lastFullStep = 0;  // Full step of the last sample in full step mode
+    uint16_t _sequence = 0;     // Sequence number of the next frame
+    uint16_t _dropped = 0;      // Samples dropped since the last frame
+
+    /**
+     * @brief Finish the frame being filled and switch to the other one, if it was already sent. Call within the critical section
+     *
+     */
+    void swapFrames();
+
+    /**
+     * @brief Check whether a new sample should be taken, called once per sampling period
+     *
+     * @param fullStep current position in full steps
+     * @return true sample due
+     * @return false no sample needed
+     */
+    bool isSampleDue(int32_t fullStep);
+
+    /**
+     * @brief Store a sample, the frame is queued for sending once full
+     *
+     * @param sample sample to be stored
+     */
+    void addSample(const stepperStreamSample_s &sample);
+
+    /**
+     * @brief Timer callback, forwards to the stream instance
+     *
+     * @param stream instance the timer belongs to
+     */
+    static void onTimer(void *stream);
+
+    /**
+     * @brief Take a sample if one is due, runs in the timer task. The status is read via the bus scheduler if there is one
+     *
+     */
+    void takeSample();
+
+   public:
+    /**
+     * @brief Connect to the stepper to be sampled, done by Stepper::init()
+     *
+     * @param stepper step generator of the stepper
+     * @param driver driver of the stepper
+     * @param scheduler bus scheduler of the driver, NULL if the driver is not scheduled
+     * @param microstepsPerStep microsteps per full step
+     */
+    void attach(FastAccelStepper *stepper, TmcDriver *driver, TmcBusScheduler *scheduler, uint8_t microstepsPerStep);
+
+    /**
+     * @brief Start taking samples, a running stream is restarted with the new settings
+     *
+     * @param channel id to be put in every frame, e.g. to tell steppers apart
+     * @param mode events a sample is taken on
+     * @param periodUs sampling interval, at least STEPPER_STREAM_MIN_PERIOD_US
+     * @return true sampling started
+     * @return false not attached to a stepper yet or no timer available
+     */
+    bool start(uint8_t channel, stepperStreamMode_e mode, uint32_t periodUs = 1000);
+
+    /**
+     * @brief Stop taking samples, already taken samples are still sent
+     *
+     */
+    void stop();
+
+    /**
+     * @brief Send as much of a pending frame as the Serial transmit buffer takes without blocking, called by Stepper::handle(). Serial
+     * stays claimed until the frame is complete, see claimSerial()
+     *
+     */
+    void transmit();
+
+    // Getter-method
+    bool isActive();
+
+    // Getter-method
+    uint32_t getPeriodUs();
+};
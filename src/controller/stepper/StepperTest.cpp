@@ -31,7 +31,8 @@ uint16_t indexOfClosestNumberInSortedArray(const uint16_t number, const uint16_t
 }
 
 void modeToString(const stepperMode_e mode, char *out) {
-    const char *states[8] = {"ROTATING", "ADJUSTING", "HOMING", "POSITIONING", "OSCILLATING_FOR", "OSCILLATING_BACK", "STANDBY", "OFF"};
+    const char *states[11] = {"ROTATING",         "ADJUSTING", "HOMING", "POSITIONING", "OSCILLATING_FOR", "OSCILLATING_BACK",
+                              "STANDBY",          "OFF",       "FOLLOWING", "WINDING",  "PATH"};
     strcpy(out, states[mode]);
 }
 
@@ -41,20 +42,6 @@ uint16_t putNumberInRange(const uint16_t number, const uint16_t lower, const uin
     return number;
 }
 
-float speedUsToRpm(const int32_t speedUs, const uint32_t stepsPerRotation) {
-    // 1 minute has 60 million microseconds
-    // .0 for percise float calculation
-    if (speedUs == 0 || stepsPerRotation == 0) return 0;
-    return 60000000.0 / speedUs / stepsPerRotation;
-}
-
-uint32_t speedRpmToUs(float rpm, const uint32_t stepsPerRotation) {
-    // 1 minute has 60 million microseconds
-    if (rpm == 0 || stepsPerRotation == 0) return 0;
-    if (rpm < 0) rpm = rpm * -1;
-    return 60000000 / rpm / stepsPerRotation;
-}
-
 uint8_t stallToLoadPercent(const uint16_t speedUs, const uint16_t stall, const uint16_t *speeds, const uint16_t *minLoad,
                            const uint16_t *maxLoad, uint8_t length) {
     // maxLoad values are always lower than minLoad values
@@ -65,12 +52,11 @@ uint8_t stallToLoadPercent(const uint16_t speedUs, const uint16_t stall, const u
     return round((min - normedStall) * 100 / (min - max));
 };
 
-float positionToMm(int32_t position, const uint32_t stepsPerRotation, const float mmPerRotation) {
-    if (mmPerRotation == 0) return 0;
-    return position * mmPerRotation / stepsPerRotation;
-}
-
-int32_t mmToPosition(float mm, const uint32_t stepsPerRotation, const float mmPerRotation) {
-    if (mmPerRotation == 0) return 0;
-    return mm * stepsPerRotation / mmPerRotation;
+uint32_t speedRpmToTstep(float rpm, const uint32_t stepsPerRotation, const uint16_t microstepsPerStep) {
+    if (rpm < 0) rpm = rpm * -1;
+    if (rpm == 0 || stepsPerRotation == 0 || microstepsPerStep == 0) return TMC_TSTEP_MAX;
+    // Frequency of 1/256 microsteps, the driver measures TSTEP normalised to 256 microsteps per step
+    float frequency256 = rpm * stepsPerRotation / 60.0 * 256 / microstepsPerStep;
+    float tstep = TMC_CLOCK_HZ / frequency256;
+    return tstep > TMC_TSTEP_MAX ? TMC_TSTEP_MAX : (uint32_t)tstep;
 }
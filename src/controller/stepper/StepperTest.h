@@ -24,14 +24,30 @@ struct stepperConfiguration_s {
         uint8_t dir;   // stepper direcion pin
         uint8_t step;  // stepper step pin (on/off causes step)
         uint8_t cs;    // stepper chip select pin
+        uint8_t diag;  // optional pin connected to DIAG1 of the driver for interrupt-driven stall detection, 0 = not connected
     } pins;
 };
 
+const uint32_t TMC_CLOCK_HZ = 12000000;  // Internal clock of the TMC2130, base of all velocity thresholds
+const uint32_t TMC_TSTEP_MAX = 0xFFFFF;  // Largest value of the 20 bit velocity threshold registers
+
 /**
  * @brief stepper operation modes, at every time only one mode possible
  *
  */
-enum stepperMode_e { ROTATING, ADJUSTING, HOMING, POSITIONING, OSCILLATING_FORWARD, OSCILLATING_BACKWARD, STANDBY, OFF };
+enum stepperMode_e {
+    ROTATING,
+    ADJUSTING,
+    HOMING,
+    POSITIONING,
+    OSCILLATING_FORWARD,
+    OSCILLATING_BACKWARD,
+    STANDBY,
+    OFF,
+    FOLLOWING,
+    WINDING,
+    PATH
+};
 
 // Manually calibrated lookup table with sorted stall values when no load
 // applied (lower value means higher load)
@@ -83,7 +99,12 @@ uint16_t putNumberInRange(const uint16_t number, const uint16_t lower, const uin
  * @param stepsPerRotation step count within one rotation
  * @return float rotations per minute
  */
-float speedUsToRpm(const int32_t speedUs, const uint32_t stepsPerRotation);
+inline float speedUsToRpm(const int32_t speedUs, const uint32_t stepsPerRotation) {
+    // 1 minute has 60 million microseconds
+    // .0 for percise float calculation
+    if (speedUs == 0 || stepsPerRotation == 0) return 0;
+    return 60000000.0 / speedUs / stepsPerRotation;
+}
 
 /**
  * @brief Convert rotations per minute in Us(microseconds) between two steps
@@ -92,7 +113,12 @@ float speedUsToRpm(const int32_t speedUs, const uint32_t stepsPerRotation);
  * @param stepsPerRotation step count needed for full rotation
  * @return uint32_t time between two steps in Us(microseconds)
  */
-uint32_t speedRpmToUs(float rpm, const uint32_t stepsPerRotation);
+inline uint32_t speedRpmToUs(float rpm, const uint32_t stepsPerRotation) {
+    // 1 minute has 60 million microseconds
+    if (rpm == 0 || stepsPerRotation == 0) return 0;
+    if (rpm < 0) rpm = rpm * -1;
+    return 60000000 / rpm / stepsPerRotation;
+}
 
 /**
  * @brief Convert raw stall to load in %
@@ -116,7 +142,10 @@ uint8_t stallToLoadPercent(const uint16_t speedUs, const uint16_t stall, const u
  * @param mmPerRotation mm stepper moves per rotation
  * @return float position in mm
  */
-float positionToMm(int32_t position, const uint32_t stepsPerRotation, const float mmPerRotation);
+inline float positionToMm(int32_t position, const uint32_t stepsPerRotation, const float mmPerRotation) {
+    if (mmPerRotation == 0) return 0;
+    return position * mmPerRotation / stepsPerRotation;
+}
 
 /**
  * @brief Convert position in mm to ticks understandable by FastAccelStepper
@@ -126,4 +155,18 @@ float positionToMm(int32_t position, const uint32_t stepsPerRotation, const floa
  * @param mmPerRotation mm stepper moves per rotation
  * @return int32_t position in ticks understandable by FastAccelStepper
  */
-int32_t mmToPosition(float mm, const uint32_t stepsPerRotation, const float mmPerRotation);
+inline int32_t mmToPosition(float mm, const uint32_t stepsPerRotation, const float mmPerRotation) {
+    if (mmPerRotation == 0) return 0;
+    return mm * stepsPerRotation / mmPerRotation;
+}
+
+/**
+ * @brief Convert rotations per minute into the TSTEP-based unit of the TMC velocity thresholds (TCOOLTHRS, TPWMTHRS, THIGH), i.e. the
+ * number of driver clock cycles between two 1/256 microsteps
+ *
+ * @param rpm rotations per minute, the sign is ignored
+ * @param stepsPerRotation step signal count for full rotation
+ * @param microstepsPerStep microstep resolution the step signals are sent in
+ * @return uint32_t threshold value, TMC_TSTEP_MAX for 0 rpm
+ */
+uint32_t speedRpmToTstep(float rpm, const uint32_t stepsPerRotation, const uint16_t microstepsPerStep);
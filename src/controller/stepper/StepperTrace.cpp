@@ -0,0 +1,106 @@
+// Related
+#include "StepperTrace.h"
+// System / External
+#include <Arduino.h>
+#include <TMCStepper.h>
+#include <string.h>
+// Selfmade
+// Project
+#include "../../utils/SerialClaim.h"
+
+#ifdef STEPPER_TRACE_ENABLED
+uint8_t StepperTrace::detectTrigger(const stepperTraceSample_s &sample) {
+    uint8_t cause = TRACE_TRIGGER_NONE;
+    if (sample.flags & TRACE_FLAG_STALLGUARD) cause |= TRACE_TRIGGER_STALL;
+    if (_lastMode != 0xFF && sample.mode != _lastMode) cause |= TRACE_TRIGGER_MODE_CHANGE;
+    if (sample.flags & (TRACE_FLAG_OVERHEATING | TRACE_FLAG_SHUTDOWN_HEAT | TRACE_FLAG_SHORT_CIRCUIT | TRACE_FLAG_OPEN_LOAD))
+        cause |= TRACE_TRIGGER_ERROR;
+    return cause & _triggerMask;
+}
+
+void StepperTrace::start(uint8_t triggerMask, bool freezeOnTrigger, uint16_t postTriggerSamples) {
+    _head = 0;
+    _count = 0;
+    _triggerMask = triggerMask;
+    _freezeOnTrigger = freezeOnTrigger;
+    _postTriggerSamples = postTriggerSamples < STEPPER_TRACE_LENGTH ? postTriggerSamples : STEPPER_TRACE_LENGTH - 1;
+    _triggered = false;
+    _frozen = false;
+    _triggerCause = TRACE_TRIGGER_NONE;
+    _samplesSinceTrigger = 0;
+    _lastMode = 0xFF;
+    _enabled = true;
+}
+
+void StepperTrace::stop() { _enabled = false; }
+
+void StepperTrace::record(stepperTraceSample_s &sample) {
+    if (!isRecording()) return;
+
+    if (_triggered) {
+        _samplesSinceTrigger++;
+    } else {
+        uint8_t cause = detectTrigger(sample);
+        if (cause != TRACE_TRIGGER_NONE) {
+            _triggered = true;
+            _triggerCause = cause;
+            sample.flags |= TRACE_FLAG_TRIGGER;
+        }
+    }
+    _lastMode = sample.mode;
+
+    _samples[_head] = sample;
+    _head = (_head + 1) % STEPPER_TRACE_LENGTH;
+    if (_count < STEPPER_TRACE_LENGTH) _count++;
+
+    if (_triggered && _freezeOnTrigger && _samplesSinceTrigger >= _postTriggerSamples) _frozen = true;
+}
+
+void StepperTrace::recordState(int32_t speedUs, int32_t position, uint32_t drvStatus, uint8_t mode, uint8_t load) {
+    TMC2130_n::DRV_STATUS_t status{0};
+    status.sr = drvStatus;
+
+    stepperTraceSample_s sample;
+    sample.timeUs = micros();
+    sample.speedUs = speedUs;
+    sample.position = position;
+    sample.stall = status.sg_result;
+    sample.mode = mode;
+    sample.load = load;
+    sample.flags = (status.stallGuard ? TRACE_FLAG_STALLGUARD : 0) | (status.otpw ? TRACE_FLAG_OVERHEATING : 0) |
+                   (status.ot ? TRACE_FLAG_SHUTDOWN_HEAT : 0) | ((status.s2ga || status.s2gb) ? TRACE_FLAG_SHORT_CIRCUIT : 0) |
+                   ((status.ola || status.olb) ? TRACE_FLAG_OPEN_LOAD : 0) | (status.stst ? TRACE_FLAG_STANDSTILL : 0);
+    record(sample);
+}
+
+bool StepperTrace::dump(const char *stepperId) {
+    if (!claimSerial(this)) return false;
+
+    stepperTraceHeader_s header;
+    memset(&header, 0, sizeof(header));
+    header.magic = STEPPER_TRACE_MAGIC;
+    header.version = STEPPER_TRACE_VERSION;
+    header.sampleSize = sizeof(stepperTraceSample_s);
+    header.sampleCount = _count;
+    header.triggerIndex = (_triggered && _samplesSinceTrigger < _count) ? _count - 1 - _samplesSinceTrigger : 0xFFFF;
+    header.triggerCause = _triggerCause;
+    strncpy(header.stepperId, stepperId, sizeof(header.stepperId) - 1);
+    Serial.write((uint8_t *)&header, sizeof(header));
+
+    // Oldest sample is at _head once the buffer wrapped around
+    uint16_t oldest = (_count < STEPPER_TRACE_LENGTH) ? 0 : _head;
+    uint16_t firstChunk = (_count < STEPPER_TRACE_LENGTH) ? _count : STEPPER_TRACE_LENGTH - _head;
+    Serial.write((uint8_t *)&_samples[oldest], firstChunk * sizeof(stepperTraceSample_s));
+    if (firstChunk < _count) Serial.write((uint8_t *)&_samples[0], (_count - firstChunk) * sizeof(stepperTraceSample_s));
+    releaseSerial(this);
+    return true;
+}
+
+bool StepperTrace::isRecording() { return _enabled && !_frozen; }
+
+bool StepperTrace::isFrozen() { return _frozen; }
+
+bool StepperTrace::isTriggered() { return _triggered; }
+
+uint16_t StepperTrace::getSampleCount() { return _count; }
+#endif
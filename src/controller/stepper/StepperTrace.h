@@ -0,0 +1,171 @@
+#pragma once
+
+// Related
+// System / External
+#include <stdint.h>
+// Selfmade
+// Project
+
+// The recorder is only compiled in if STEPPER_TRACE_LENGTH sets the samples kept per stepper (17 bytes each), e.g. via build flag
+// -DSTEPPER_TRACE_LENGTH=128. Undefined or 0 leaves it out, the dump format below stays available for the tools
+#if defined(STEPPER_TRACE_LENGTH) && STEPPER_TRACE_LENGTH != 0
+#define STEPPER_TRACE_ENABLED
+#endif
+
+const uint32_t STEPPER_TRACE_MAGIC = 0x43525451;  // "QTRC" in little endian, marks the start of a dump
+const uint8_t STEPPER_TRACE_VERSION = 1;          // Version of the dump format
+
+/**
+ * @brief Events that can trigger the trace, combinable as bitmask
+ *
+ */
+enum stepperTraceTrigger_e {
+    TRACE_TRIGGER_NONE = 0,         // Never trigger
+    TRACE_TRIGGER_STALL = 1,        // StallGuard flag of the driver is set
+    TRACE_TRIGGER_MODE_CHANGE = 2,  // Operation mode changed
+    TRACE_TRIGGER_ERROR = 4         // Any error flag of the driver is set
+};
+
+/**
+ * @brief Bits of the flag-field of a trace sample
+ *
+ */
+enum stepperTraceFlag_e {
+    TRACE_FLAG_STALLGUARD = 1,     // StallGuard flag of the driver
+    TRACE_FLAG_OVERHEATING = 2,    // Overheating pre-warning of the driver
+    TRACE_FLAG_SHUTDOWN_HEAT = 4,  // Driver shut down due to overheating
+    TRACE_FLAG_SHORT_CIRCUIT = 8,  // Driver shut down due to short circuit
+    TRACE_FLAG_OPEN_LOAD = 16,     // Open load detected
+    TRACE_FLAG_STANDSTILL = 32,    // Motor standstill
+    TRACE_FLAG_TRIGGER = 128       // Sample that triggered the trace
+};
+
+/**
+ * @brief Compact snapshot of a stepper taken on every handle()-call
+ *
+ */
+struct __attribute__((packed)) stepperTraceSample_s {
+    uint32_t timeUs;    // micros() at time of sampling
+    int32_t speedUs;    // Current speed in us between steps, negative values for backwards movement
+    int32_t position;   // Position in steps
+    uint16_t stall;     // Raw stall value 0...1023
+    uint8_t mode;       // Operation mode, see stepperMode_e
+    uint8_t load;       // Load in %
+    uint8_t flags;      // Driver flags, see stepperTraceFlag_e
+};
+
+/**
+ * @brief Header preceding the samples of a binary dump
+ *
+ */
+struct __attribute__((packed)) stepperTraceHeader_s {
+    uint32_t magic;         // Always STEPPER_TRACE_MAGIC
+    uint8_t version;        // Always STEPPER_TRACE_VERSION
+    uint8_t sampleSize;     // sizeof(stepperTraceSample_s)
+    uint16_t sampleCount;   // Number of samples following the header, oldest first
+    uint16_t triggerIndex;  // Index of the triggering sample within the dump, 0xFFFF if not triggered
+    uint8_t triggerCause;   // Event that triggered the trace, see stepperTraceTrigger_e
+    char stepperId[9];      // Stepper identifier, zero-terminated
+};
+
+#ifdef STEPPER_TRACE_ENABLED
+static_assert(STEPPER_TRACE_LENGTH > 0 && STEPPER_TRACE_LENGTH < 0xFFFF, "STEPPER_TRACE_LENGTH must fit the uint16_t indices");
+
+/**
+ * @brief Circular recorder of stepper samples, can freeze after a trigger event to keep the history for post-mortem analysis
+ *
+ */
+class StepperTrace {
+   private:
+    stepperTraceSample_s _samples[STEPPER_TRACE_LENGTH];  // Ring buffer of recorded samples
+    uint16_t _head = 0;                                    // Index the next sample is written to
+    uint16_t _count = 0;                                   // Number of valid samples in the buffer
+
+    // Configuration
+    bool _enabled = false;            // Flag whether samples are recorded
+    uint8_t _triggerMask = 0;         // Events that trigger the trace, see stepperTraceTrigger_e
+    bool _freezeOnTrigger = false;    // Flag whether recording stops after a trigger
+    uint16_t _postTriggerSamples = 0;  // Samples still recorded after the trigger before freezing
+
+    // Status
+    bool _triggered = false;            // Flag whether the trigger has fired since arming
+    bool _frozen = false;               // Flag whether recording was stopped by the trigger
+    uint8_t _triggerCause = 0;          // Event that fired the trigger
+    uint16_t _samplesSinceTrigger = 0;  // Samples recorded after the trigger
+    uint8_t _lastMode = 0xFF;           // Mode of the previous sample, used for mode change detection
+
+    /**
+     * @brief Determine the trigger events a sample causes
+     *
+     * @param sample sample to be checked
+     * @return uint8_t events that occured and are part of the trigger mask
+     */
+    uint8_t detectTrigger(const stepperTraceSample_s &sample);
+
+   public:
+    /**
+     * @brief Start recording and arm the trigger, clears all previous samples
+     *
+     * @param triggerMask events that trigger the trace, see stepperTraceTrigger_e
+     * @param freezeOnTrigger true=stop recording after the trigger, false=continue recording
+     * @param postTriggerSamples samples to be recorded after the trigger before freezing
+     */
+    void start(uint8_t triggerMask = TRACE_TRIGGER_NONE, bool freezeOnTrigger = false, uint16_t postTriggerSamples = 0);
+
+    /**
+     * @brief Stop recording, recorded samples are kept
+     *
+     */
+    void stop();
+
+    /**
+     * @brief Store a sample unless the recorder is stopped or frozen
+     *
+     * @param sample sample to be stored
+     */
+    void record(stepperTraceSample_s &sample);
+
+    /**
+     * @brief Store the current state of a stepper as sample, the time is taken from micros()
+     *
+     * @param speedUs current speed in us between steps as reported by the step generator
+     * @param position position in steps
+     * @param drvStatus raw DRV_STATUS of the driver, provides the stall value and flags
+     * @param mode operation mode, see stepperMode_e
+     * @param load load in %
+     */
+    void recordState(int32_t speedUs, int32_t position, uint32_t drvStatus, uint8_t mode, uint8_t load);
+
+    /**
+     * @brief Write all samples as binary dump (header followed by the samples, oldest first) to Serial. Blocks until everything is
+     * handed to Serial
+     *
+     * @param stepperId stepper identifier stored in the header
+     * @return true dumped
+     * @return false another writer is in the middle of a frame, see claimSerial()
+     */
+    bool dump(const char *stepperId);
+
+    /**
+     * @brief Check whether samples are being recorded
+     *
+     * @return true recording
+     * @return false stopped or frozen
+     */
+    bool isRecording();
+
+    /**
+     * @brief Check whether recording was stopped by the trigger
+     *
+     * @return true frozen, samples hold the history of the trigger event
+     * @return false still recording or stopped manually
+     */
+    bool isFrozen();
+
+    // Getter-method
+    bool isTriggered();
+
+    // Getter-method
+    uint16_t getSampleCount();
+};
+#endif
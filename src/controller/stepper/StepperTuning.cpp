@@ -0,0 +1,70 @@
+// Related
+#include "StepperTuning.h"
+// System / External
+#include <Arduino.h>
+// Selfmade
+// Project
+#include "StepperTest.h"
+
+void StepperTuning::init(TmcDriver *driver, uint32_t microstepsPerRotation, uint16_t microstepsPerStep) {
+    _driver = driver;
+    _microstepsPerRotation = microstepsPerRotation;
+    _microstepsPerStep = microstepsPerStep;
+    applyCoolStep();
+    applyChopper();
+    applyVelocityThresholds();
+}
+
+void StepperTuning::applyCoolStep() {
+    _driver->semin(_coolStepConfig.semin);
+    _driver->semax(_coolStepConfig.semax);
+    _driver->seup(_coolStepConfig.seup);
+    _driver->sedn(_coolStepConfig.sedn);
+    _driver->seimin(_coolStepConfig.seimin);
+}
+
+void StepperTuning::applyChopper() {
+    _driver->en_pwm_mode(_chopperConfig.stealthChopMaxRpm > 0);
+    _driver->pwm_autoscale(true);
+    _driver->vhighfs(_chopperConfig.fullStepMinRpm > 0);
+    _driver->vhighchm(_chopperConfig.fullStepMinRpm > 0);
+}
+
+void StepperTuning::applyVelocityThresholds() {
+    // Slower speeds mean higher TSTEP values: CoolStep is active for THIGH < TSTEP <= TCOOLTHRS, StealthChop for TSTEP >= TPWMTHRS and
+    // fullstep for TSTEP <= THIGH
+    _driver->TCOOLTHRS(speedRpmToTstep(_coolStepConfig.rpmMin, _microstepsPerRotation, _microstepsPerStep));
+    _driver->TPWMTHRS(_chopperConfig.stealthChopMaxRpm > 0
+                          ? speedRpmToTstep(_chopperConfig.stealthChopMaxRpm, _microstepsPerRotation, _microstepsPerStep)
+                          : 0);
+
+    float highRpm = _coolStepConfig.rpmMax;
+    if (_chopperConfig.fullStepMinRpm > 0 && (highRpm == 0 || _chopperConfig.fullStepMinRpm < highRpm))
+        highRpm = _chopperConfig.fullStepMinRpm;
+    _driver->THIGH(highRpm > 0 ? speedRpmToTstep(highRpm, _microstepsPerRotation, _microstepsPerStep) : 0);
+}
+
+stepperCoolStepConfig_s StepperTuning::getCoolStepConfig() { return _coolStepConfig; }
+
+void StepperTuning::setCoolStepConfig(stepperCoolStepConfig_s config) {
+    _coolStepConfig.semin = min(config.semin, (uint8_t)15);
+    _coolStepConfig.semax = min(config.semax, (uint8_t)15);
+    _coolStepConfig.seup = min(config.seup, (uint8_t)3);
+    _coolStepConfig.sedn = min(config.sedn, (uint8_t)3);
+    _coolStepConfig.seimin = config.seimin;
+    _coolStepConfig.rpmMin = abs(config.rpmMin);
+    _coolStepConfig.rpmMax = abs(config.rpmMax);
+    if (_driver == NULL) return;
+    applyCoolStep();
+    applyVelocityThresholds();
+}
+
+stepperChopperConfig_s StepperTuning::getChopperConfig() { return _chopperConfig; }
+
+void StepperTuning::setChopperConfig(stepperChopperConfig_s config) {
+    _chopperConfig.stealthChopMaxRpm = abs(config.stealthChopMaxRpm);
+    _chopperConfig.fullStepMinRpm = abs(config.fullStepMinRpm);
+    if (_driver == NULL) return;
+    applyChopper();
+    applyVelocityThresholds();
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+// Related
+// System / External
+#include <stddef.h>
+#include <stdint.h>
+// Selfmade
+// Project
+#include "TmcDriver.h"
+
+/**
+ * @brief CoolStep configuration, the driver lowers the motor current while the load is low. See the TMC2130 datasheet for details
+ *
+ */
+struct stepperCoolStepConfig_s {
+    uint8_t semin;  // [0..15] current is increased if the stall value drops below semin * 32, 0 = CoolStep disabled
+    uint8_t semax;  // [0..15] current is decreased if the stall value rises above (semin + semax + 1) * 32
+    uint8_t seup;   // [0..3] current increment per stall measurement: 1, 2, 4, 8 steps
+    uint8_t sedn;   // [0..3] stall measurements per current decrement: 32, 8, 2, 1
+    bool seimin;    // minimum current, false = 1/2 of the maximum current, true = 1/4 of the maximum current
+    float rpmMin;   // CoolStep and StallGuard are only active above this speed, 0 = active at any speed
+    float rpmMax;   // CoolStep is only active below this speed, 0 = no upper limit
+};
+
+/**
+ * @brief Chopper mode depending on speed: quiet StealthChop at low speed, SpreadCycle for torque and fullstep at high speed
+ *
+ */
+struct stepperChopperConfig_s {
+    float stealthChopMaxRpm;  // StealthChop below this speed, SpreadCycle above. StallGuard only works with SpreadCycle, so keep it below
+                              // the homing speed. 0 = SpreadCycle at any speed
+    float fullStepMinRpm;     // Fullstep with high velocity chopper above this speed, reduces losses at top speed. 0 = disabled
+};
+
+/**
+ * @brief Speed dependent features of the TMC2130: CoolStep and the chopper modes. The configurations are kept here and written to the
+ * driver whenever they change, the driver sends them with its next flush()
+ *
+ */
+class StepperTuning {
+   private:
+    TmcDriver *_driver = NULL;            // Driver the configuration is written to, set by init()
+    uint32_t _microstepsPerRotation = 1;  // Count of step signals to be sent for one rotation
+    uint16_t _microstepsPerStep = 1;      // Microstep resolution of the driver
+
+    stepperCoolStepConfig_s _coolStepConfig = {.semin = 0,
+                                               .semax = 1,
+                                               .seup = 0,
+                                               .sedn = 0,
+                                               .seimin = false,
+                                               .rpmMin = 0,
+                                               .rpmMax = 0};  // CoolStep configuration, disabled by default
+    stepperChopperConfig_s _chopperConfig = {.stealthChopMaxRpm = 0, .fullStepMinRpm = 0};  // Chopper modes, SpreadCycle only by default
+
+    /**
+     * @brief Write the CoolStep configuration to the driver
+     *
+     */
+    void applyCoolStep();
+
+    /**
+     * @brief Write the chopper modes to the driver
+     *
+     */
+    void applyChopper();
+
+    /**
+     * @brief Write the speed thresholds of CoolStep and the chopper modes to the driver. THIGH is shared by the upper CoolStep limit and
+     * the fullstep threshold, the lower of both speeds is used
+     *
+     */
+    void applyVelocityThresholds();
+
+   public:
+    /**
+     * @brief Attach to the driver and write the current configuration, called by Stepper::init()
+     *
+     * @param driver driver of the stepper, communication must be started already
+     * @param microstepsPerRotation count of step signals for one rotation
+     * @param microstepsPerStep microstep resolution of the driver
+     */
+    void init(TmcDriver *driver, uint32_t microstepsPerRotation, uint16_t microstepsPerStep);
+
+    // Getter-method
+    stepperCoolStepConfig_s getCoolStepConfig();
+
+    /**
+     * @brief Set and apply a new CoolStep configuration, out of range values are limited to their maximum
+     *
+     * @param config new CoolStep configuration
+     */
+    void setCoolStepConfig(stepperCoolStepConfig_s config);
+
+    // Getter-method
+    stepperChopperConfig_s getChopperConfig();
+
+    /**
+     * @brief Set and apply new speed thresholds for the chopper modes, should be changed while the motor stands still
+     *
+     * @param config new chopper configuration
+     */
+    void setChopperConfig(stepperChopperConfig_s config);
+};
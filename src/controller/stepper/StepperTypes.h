@@ -0,0 +1,37 @@
+#pragma once
+
+// Related
+// System / External
+#include <stdint.h>
+// Selfmade
+// Project
+#include "StepperTest.h"
+
+/**
+ * @brief stepper movement instructions, movements that can be scheduled
+ *
+ */
+struct stepperRecipe_s {
+    stepperMode_e mode;  // Operation mode
+    float rpm;           // Speed in rotations per minute
+    uint8_t load;        // Motorload in %, 0 = no load, 100 = full load
+    int32_t position1;   // Start position
+    int32_t position2;   // End position
+};
+
+/**
+ * @brief Status of stepper
+ *
+ */
+struct stepperStatus_s {
+    float rpm;                       // Steper Rotations per minute
+    uint8_t load;                    // Stepper load in %, 0 = no load, 100 = full load
+    int32_t position;                // stepper position
+    bool errorOverheating;           // Warning Stepper Driver overheated
+    bool errorShutdownHeat;          // Stepper shut down due to overheated driver
+    bool errorShutdownShortCircuit;  // Stepper shut down due to short circuit
+    bool errorOpenLoad;              // Stepper driver detected open load
+    uint8_t currentScale;            // Actual current scale 0...31 as set by CoolStep, 31 = maximum current
+    bool errorStall;                 // Stepper was stopped by a stall detected on the DIAG pin
+    float diameter;                  // Estimated winding diameter in mm while following with diameter estimation, 0 = not estimated
+};
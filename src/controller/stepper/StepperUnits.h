@@ -0,0 +1,118 @@
+#pragma once
+
+// Related
+// System / External
+#include <stdint.h>
+// Selfmade
+// Project
+#include "StepperTest.h"
+
+/**
+ * @brief Conversion factors of a stepper known at runtime, taken from its configuration
+ *
+ */
+class RuntimeUnitFactors {
+   private:
+    uint32_t _microstepsPerRotation;  // Count of step signals to be sent for one rotation
+    float _mmPerRotation;             // Distance travelled per rotation in mm
+
+   public:
+    RuntimeUnitFactors(const stepperConfiguration_s &config)
+        : _microstepsPerRotation(config.stepsPerRotation * config.microstepsPerStep * config.gearRatio),
+          _mmPerRotation(config.mmPerRotation) {}
+
+    // Getter-method
+    uint32_t microstepsPerRotation() const { return _microstepsPerRotation; }
+
+    // Getter-method
+    float mmPerRotation() const { return _mmPerRotation; }
+};
+
+/**
+ * @brief Conversion factors of a stepper known at compile time, see ConfiguredStepper
+ *
+ * @tparam Config type with a static constexpr stepperConfiguration_s configuration()
+ */
+template <class Config>
+class ConfiguredUnitFactors {
+   public:
+    static constexpr uint32_t MICROSTEPS_PER_ROTATION = Config::configuration().stepsPerRotation *
+                                                        Config::configuration().microstepsPerStep *
+                                                        Config::configuration().gearRatio;  // Count of step signals for one rotation
+    static constexpr float MM_PER_ROTATION = Config::configuration().mmPerRotation;         // Distance travelled per rotation in mm
+
+    // Getter-method
+    static constexpr uint32_t microstepsPerRotation() { return MICROSTEPS_PER_ROTATION; }
+
+    // Getter-method
+    static constexpr float mmPerRotation() { return MM_PER_ROTATION; }
+};
+
+template <class Config>
+constexpr uint32_t ConfiguredUnitFactors<Config>::MICROSTEPS_PER_ROTATION;
+
+template <class Config>
+constexpr float ConfiguredUnitFactors<Config>::MM_PER_ROTATION;
+
+/**
+ * @brief Conversion between the units of the recipes (rpm, mm) and the ones of the step generator (us between steps, steps). The
+ * handle()-cycle of Stepper is written against this class, so with ConfiguredUnitFactors the factors are immediates instead of loads
+ * from the instance. Both variants use the same functions of StepperTest.h and convert bit-identically
+ *
+ * @tparam Factors RuntimeUnitFactors or ConfiguredUnitFactors<Config>
+ */
+template <class Factors>
+class StepperUnits : public Factors {
+   public:
+    using Factors::Factors;
+
+    /**
+     * @brief Convert the time between two steps into a speed, see speedUsToRpm()
+     *
+     * @param speedUs time between two steps in us, signed by the direction
+     * @return float speed in rotations per minute
+     */
+    float usToRpm(int32_t speedUs) const { return speedUsToRpm(speedUs, this->microstepsPerRotation()); }
+
+    /**
+     * @brief Convert a speed into the time between two steps, see speedRpmToUs()
+     *
+     * @param rpm speed in rotations per minute, the direction is ignored
+     * @return uint32_t time between two steps in us
+     */
+    uint32_t rpmToUs(float rpm) const { return speedRpmToUs(rpm, this->microstepsPerRotation()); }
+
+    /**
+     * @brief Convert a speed into a step rate, e.g. for motion profiles
+     *
+     * @param rpm speed in rotations per minute
+     * @return float step rate in steps/s
+     */
+    float rpmToStepsPerS(float rpm) const { return rpm * this->microstepsPerRotation() / 60; }
+
+    /**
+     * @brief Convert a step rate into a speed
+     *
+     * @param stepsPerS step rate in steps/s
+     * @return float speed in rotations per minute
+     */
+    float stepsPerSToRpm(float stepsPerS) const { return stepsPerS * 60 / this->microstepsPerRotation(); }
+
+    /**
+     * @brief Convert a position in steps into mm, see positionToMm()
+     *
+     * @param steps position in steps
+     * @return float position in mm
+     */
+    float stepsToMm(int32_t steps) const { return positionToMm(steps, this->microstepsPerRotation(), this->mmPerRotation()); }
+
+    /**
+     * @brief Convert a position in mm into steps, see mmToPosition()
+     *
+     * @param mm position in mm
+     * @return int32_t position in steps
+     */
+    int32_t mmToSteps(float mm) const { return mmToPosition(mm, this->microstepsPerRotation(), this->mmPerRotation()); }
+};
+
+typedef StepperUnits<RuntimeUnitFactors> RuntimeStepperUnits;  // Units of a Stepper, factors read from the instance
@@ -0,0 +1,108 @@
+// Related
+#include "TmcBusScheduler.h"
+// System / External
+#include <stdint.h>
+// Selfmade
+// Project
+#include "../../logger/logging.h"
+#include "../../utils/AllocationGuard.h"
+
+TmcBusScheduler::TmcBusScheduler(uint8_t transactionsPerCycle, uint8_t pollInterval) {
+    _budget = transactionsPerCycle > 0 ? transactionsPerCycle : 1;
+    _pollInterval = pollInterval > 0 ? pollInterval : 1;
+}
+
+bool TmcBusScheduler::add(TmcDriver *driver) {
+    if (driver == NULL || _driverCount >= TMC_BUS_MAX_DRIVERS) return false;
+    driver->setScheduled(true);
+    _lastPollCycle[_driverCount] = 0;
+    _accountedTransactions[_driverCount] = driver->getTransactions();
+    _drivers[_driverCount++] = driver;
+    return true;
+}
+
+void TmcBusScheduler::handle() {
+    GUARD_HANDLE();
+    if (_driverCount == 0) return;
+    _stats.cycles++;
+
+    // Traffic the owners caused since the last cycle already used up part of the bus time
+    portENTER_CRITICAL(&_readMux);
+    uint32_t sampled = _sampledReads;
+    _sampledReads = 0;
+    portEXIT_CRITICAL(&_readMux);
+    uint32_t unscheduled = sampled;
+    for (uint8_t i = 0; i < _driverCount; ++i) unscheduled += _drivers[i]->getTransactions() - _accountedTransactions[i];
+    _stats.unscheduledTransactions += unscheduled;
+    uint8_t used = min(unscheduled, (uint32_t)_budget);
+
+    // Writes first, starting with a different driver every cycle so no driver starves
+    for (uint8_t i = 0; i < _driverCount && used < _budget; ++i) {
+        used += _drivers[(_writeCursor + i) % _driverCount]->flush(_budget - used);
+    }
+    _writeCursor = (_writeCursor + 1) % _driverCount;
+    for (uint8_t i = 0; i < _driverCount; ++i) {
+        if (!_drivers[i]->hasPendingWrites()) continue;
+        _stats.deferredWriteCycles++;
+        break;
+    }
+
+    // Urgent status reads
+    for (uint8_t i = 0; i < _driverCount; ++i) {
+        if (!_drivers[i]->isPollUrgent()) continue;
+        if (used >= _budget) {
+            _stats.deferredPolls++;
+            continue;
+        }
+        _drivers[i]->readDrvStatus();
+        _lastPollCycle[i] = _stats.cycles;
+        used++;
+    }
+
+    // Remaining drivers in turns, each one at least every _pollInterval cycles if the budget allows it
+    for (uint8_t i = 0; i < _driverCount; ++i) {
+        uint8_t index = (_pollCursor + i) % _driverCount;
+        bool polledRecently = _lastPollCycle[index] != 0 && _stats.cycles - _lastPollCycle[index] < _pollInterval;
+        if (_drivers[index]->isPollUrgent() || polledRecently) continue;
+        if (used >= _budget) {
+            _stats.deferredPolls++;
+            continue;
+        }
+        _drivers[index]->readDrvStatus();
+        _lastPollCycle[index] = _stats.cycles;
+        _pollCursor = (index + 1) % _driverCount;
+        used++;
+    }
+
+    // Everything sent since the last cycle, scheduled or not
+    uint32_t cycleTransactions = sampled;
+    for (uint8_t i = 0; i < _driverCount; ++i) {
+        uint32_t transactions = _drivers[i]->getTransactions();
+        cycleTransactions += transactions - _accountedTransactions[i];
+        _accountedTransactions[i] = transactions;
+    }
+    _stats.transactions += cycleTransactions;
+    if (cycleTransactions > _stats.maxTransactionsPerCycle) _stats.maxTransactionsPerCycle = min(cycleTransactions, (uint32_t)UINT8_MAX);
+}
+
+uint32_t TmcBusScheduler::read(TmcDriver *driver) {
+    uint32_t status = driver->sampleDrvStatus();
+    portENTER_CRITICAL(&_readMux);
+    _sampledReads++;
+    portEXIT_CRITICAL(&_readMux);
+    return status;
+}
+
+tmcBusStats_s TmcBusScheduler::getStats() { return _stats; }
+
+float TmcBusScheduler::getUtilisation() {
+    if (_stats.cycles == 0) return 0;
+    return (float)_stats.transactions / ((float)_stats.cycles * _budget);
+}
+
+void TmcBusScheduler::printStats() {
+    logPrint(INFO, INFO, "{bus: {drivers: %u, budget: %u, cycles: %u, transactions: %u, unscheduled: %u, utilisation: %.2f, "
+             "maxPerCycle: %u, deferredWriteCycles: %u, deferredPolls: %u}}\n",
+             _driverCount, _budget, _stats.cycles, _stats.transactions, _stats.unscheduledTransactions, getUtilisation(),
+             _stats.maxTransactionsPerCycle, _stats.deferredWriteCycles, _stats.deferredPolls);
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+// Related
+// System / External
+#include <Arduino.h>
+#include <stdint.h>
+// Selfmade
+// Project
+#include "TmcDriver.h"
+
+const uint8_t TMC_BUS_MAX_DRIVERS = 8;  // Maximum number of drivers sharing one bus
+
+/**
+ * @brief Usage statistics of the SPI bus
+ *
+ */
+struct tmcBusStats_s {
+    uint32_t cycles;                   // Number of handle()-calls
+    uint32_t transactions;             // Number of SPI transactions sent, including the unscheduled ones
+    uint32_t unscheduledTransactions;  // Number of transactions the owners sent on their own, e.g. current changes
+    uint32_t deferredWriteCycles;      // Number of cycles that ended with writes still pending
+    uint32_t deferredPolls;            // Number of status reads postponed due to the budget
+    uint8_t maxTransactionsPerCycle;   // Highest number of transactions within one cycle
+};
+
+/**
+ * @brief Shares one SPI bus between several TMC drivers with a fixed transaction budget per loop
+ *
+ * Every cycle pending register writes are sent first, then the status of urgent drivers (homing, load-adjusting) is read and the
+ * remaining budget is spent on reading the status of the other drivers in turns. The worst-case loop time thus no longer grows with the
+ * number of axes. Transactions the owners sent on their own since the last cycle (current and microstep changes, direct status reads)
+ * are charged against the budget of the next cycle.
+ */
+class TmcBusScheduler {
+   private:
+    TmcDriver *_drivers[TMC_BUS_MAX_DRIVERS];              // Registered drivers
+    uint32_t _lastPollCycle[TMC_BUS_MAX_DRIVERS];          // Cycle of the last status read per driver, 0 = never
+    uint32_t _accountedTransactions[TMC_BUS_MAX_DRIVERS];  // Transactions per driver already contained in the statistics
+    uint8_t _driverCount = 0;                              // Number of registered drivers
+    uint8_t _budget;                                       // Maximum number of SPI transactions per cycle
+    uint8_t _pollInterval;                                 // Cycles between status reads of non-urgent drivers
+    uint8_t _writeCursor = 0;                              // Driver the next write round starts with
+    uint8_t _pollCursor = 0;                               // Driver the next round of non-urgent reads starts with
+    tmcBusStats_s _stats = {0, 0, 0, 0, 0, 0};             // Usage statistics
+
+    // Reads from other tasks, see read()
+    portMUX_TYPE _readMux = portMUX_INITIALIZER_UNLOCKED;  // Protects _sampledReads
+    volatile uint32_t _sampledReads = 0;                   // Status reads since the last cycle
+
+   public:
+    /**
+     * @brief Constructor
+     *
+     * @param transactionsPerCycle maximum number of SPI transactions per handle()-call
+     * @param pollInterval handle()-calls between status reads of drivers that are not urgent
+     */
+    TmcBusScheduler(uint8_t transactionsPerCycle = 6, uint8_t pollInterval = 4);
+
+    /**
+     * @brief Register a driver, its owner stops talking to the bus on its own. Done by Stepper::init() if a scheduler was set
+     *
+     * @param driver driver to be registered
+     * @return true registered
+     * @return false bus full
+     */
+    bool add(TmcDriver *driver);
+
+    /**
+     * @brief Send pending writes and read driver states within the budget, call once per loop after the steppers were handled
+     *
+     */
+    void handle();
+
+    /**
+     * @brief Read the status of a registered driver outside of handle(), e.g. by the stream sampler at rates above the loop frequency.
+     * Safe to call from another task, the read is charged to the budget of the next cycle
+     *
+     * @param driver driver to be read
+     * @return uint32_t raw DRV_STATUS, see TMC2130_n::DRV_STATUS_t
+     */
+    uint32_t read(TmcDriver *driver);
+
+    // Getter-method
+    tmcBusStats_s getStats();
+
+    /**
+     * @brief Get the share of the budget used on average
+     *
+     * @return float used share of the transaction budget, 0...1
+     */
+    float getUtilisation();
+
+    /**
+     * @brief Print the bus statistics via logPrint
+     *
+     */
+    void printStats();
+};
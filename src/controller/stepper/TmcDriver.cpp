@@ -0,0 +1,181 @@
+// Related
+#include "TmcDriver.h"
+// System / External
+#include <TMCStepper.h>
+#include <stdint.h>
+// Selfmade
+// Project
+
+TmcDriver::TmcDriver(uint16_t pinCs) : _driver(pinCs) {}
+
+void TmcDriver::setField(tmcRegister_e reg, uint8_t shift, uint8_t width, uint32_t value) {
+    uint32_t mask = ((1UL << width) - 1) << shift;
+    _registers[reg].pending = (_registers[reg].pending & ~mask) | ((value << shift) & mask);
+    _writesRequested++;
+}
+
+void TmcDriver::syncRegisters() {
+    // Write-only registers are returned from the shadow copies of the underlying driver, the others are read
+    _registers[TMC_GCONF].written = _driver.GCONF();
+    _registers[TMC_IHOLD_IRUN].written = _driver.IHOLD_IRUN();
+    _registers[TMC_TPWMTHRS].written = _driver.TPWMTHRS();
+    _registers[TMC_TCOOLTHRS].written = _driver.TCOOLTHRS();
+    _registers[TMC_THIGH].written = _driver.THIGH();
+    _registers[TMC_CHOPCONF].written = _driver.CHOPCONF();
+    _registers[TMC_COOLCONF].written = _driver.COOLCONF();
+    _registers[TMC_PWMCONF].written = _driver.PWMCONF();
+    for (uint8_t i = 0; i < TMC_REGISTER_COUNT; ++i) _registers[i].pending = _registers[i].written;
+    _readsSent += 2;  // GCONF and CHOPCONF
+}
+
+void TmcDriver::begin() {
+    _driver.begin();
+    syncRegisters();
+}
+
+uint8_t TmcDriver::flush(uint8_t maxWrites) {
+    uint8_t sent = 0;
+    for (uint8_t i = 0; i < TMC_REGISTER_COUNT && sent < maxWrites; ++i) {
+        if (_registers[i].pending == _registers[i].written) continue;
+
+        uint32_t value = _registers[i].pending;
+        switch (i) {
+            case TMC_GCONF:
+                _driver.GCONF(value);
+                break;
+            case TMC_IHOLD_IRUN:
+                _driver.IHOLD_IRUN(value);
+                break;
+            case TMC_TPWMTHRS:
+                _driver.TPWMTHRS(value);
+                break;
+            case TMC_TCOOLTHRS:
+                _driver.TCOOLTHRS(value);
+                break;
+            case TMC_THIGH:
+                _driver.THIGH(value);
+                break;
+            case TMC_CHOPCONF:
+                _driver.CHOPCONF(value);
+                break;
+            case TMC_COOLCONF:
+                _driver.COOLCONF(value);
+                break;
+            case TMC_PWMCONF:
+                _driver.PWMCONF(value);
+                break;
+            default:  // Should never happen
+                break;
+        }
+        _registers[i].written = value;
+        _writesSent++;
+        sent++;
+    }
+    return sent;
+}
+
+bool TmcDriver::hasPendingWrites() {
+    for (uint8_t i = 0; i < TMC_REGISTER_COUNT; ++i) {
+        if (_registers[i].pending != _registers[i].written) return true;
+    }
+    return false;
+}
+
+uint32_t TmcDriver::readDrvStatus() {
+    _readsSent++;
+    _drvStatus = _driver.DRV_STATUS();
+    _statusValid = true;
+    return _drvStatus;
+}
+
+uint32_t TmcDriver::sampleDrvStatus() { return _driver.DRV_STATUS(); }
+
+uint32_t TmcDriver::getDrvStatus() { return _drvStatus; }
+
+bool TmcDriver::hasStatus() { return _statusValid; }
+
+bool TmcDriver::isScheduled() { return _scheduled; }
+
+void TmcDriver::setScheduled(bool scheduled) { _scheduled = scheduled; }
+
+bool TmcDriver::isPollUrgent() { return _pollUrgent; }
+
+void TmcDriver::setPollUrgent(bool urgent) { _pollUrgent = urgent; }
+
+void TmcDriver::rms_current(uint16_t currentMa) {
+    flush();
+    _driver.rms_current(currentMa);
+    _writesRequested += 2;
+    _writesSent += 2;  // IHOLD_IRUN and CHOPCONF
+    syncRegisters();
+}
+
+void TmcDriver::microsteps(uint16_t microsteps) {
+    flush();
+    _driver.microsteps(microsteps);
+    _writesRequested++;
+    _writesSent++;
+    syncRegisters();
+}
+
+void TmcDriver::toff(uint8_t value) { setField(TMC_CHOPCONF, 0, 4, value); }
+
+void TmcDriver::blank_time(uint8_t value) {
+    // Blank time in clock cycles, like the underlying driver other values are ignored
+    switch (value) {
+        case 16:
+            setField(TMC_CHOPCONF, 15, 2, 0);
+            break;
+        case 24:
+            setField(TMC_CHOPCONF, 15, 2, 1);
+            break;
+        case 36:
+            setField(TMC_CHOPCONF, 15, 2, 2);
+            break;
+        case 54:
+            setField(TMC_CHOPCONF, 15, 2, 3);
+            break;
+        default:
+            break;
+    }
+}
+
+void TmcDriver::vhighfs(bool value) { setField(TMC_CHOPCONF, 18, 1, value); }
+
+void TmcDriver::vhighchm(bool value) { setField(TMC_CHOPCONF, 19, 1, value); }
+
+void TmcDriver::semin(uint8_t value) { setField(TMC_COOLCONF, 0, 4, value); }
+
+void TmcDriver::seup(uint8_t value) { setField(TMC_COOLCONF, 5, 2, value); }
+
+void TmcDriver::semax(uint8_t value) { setField(TMC_COOLCONF, 8, 4, value); }
+
+void TmcDriver::sedn(uint8_t value) { setField(TMC_COOLCONF, 13, 2, value); }
+
+void TmcDriver::seimin(bool value) { setField(TMC_COOLCONF, 15, 1, value); }
+
+void TmcDriver::sgt(int8_t value) { setField(TMC_COOLCONF, 16, 7, (uint8_t)value); }
+
+void TmcDriver::sfilt(bool value) { setField(TMC_COOLCONF, 24, 1, value); }
+
+void TmcDriver::en_pwm_mode(bool value) { setField(TMC_GCONF, 2, 1, value); }
+
+void TmcDriver::diag1_stall(bool value) { setField(TMC_GCONF, 8, 1, value); }
+
+void TmcDriver::diag1_pushpull(bool value) { setField(TMC_GCONF, 13, 1, value); }
+
+void TmcDriver::pwm_autoscale(bool value) { setField(TMC_PWMCONF, 18, 1, value); }
+
+void TmcDriver::TPWMTHRS(uint32_t value) { setField(TMC_TPWMTHRS, 0, 20, value); }
+
+void TmcDriver::TCOOLTHRS(uint32_t value) { setField(TMC_TCOOLTHRS, 0, 20, value); }
+
+void TmcDriver::THIGH(uint32_t value) { setField(TMC_THIGH, 0, 20, value); }
+
+uint32_t TmcDriver::getWritesSent() { return _writesSent; }
+
+uint32_t TmcDriver::getWritesSkipped() { return _writesRequested > _writesSent ? _writesRequested - _writesSent : 0; }
+
+uint32_t TmcDriver::getReadsSent() { return _readsSent; }
+
+uint32_t TmcDriver::getTransactions() { return _writesSent + _readsSent; }
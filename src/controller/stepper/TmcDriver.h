@@ -0,0 +1,196 @@
+#pragma once
+
+// Related
+// System / External
+#include <TMCStepper.h>
+#include <stdint.h>
+// Selfmade
+// Project
+
+/**
+ * @brief Configuration registers of the TMC2130 that are mirrored by TmcDriver
+ *
+ */
+enum tmcRegister_e { TMC_GCONF, TMC_IHOLD_IRUN, TMC_TPWMTHRS, TMC_TCOOLTHRS, TMC_THIGH, TMC_CHOPCONF, TMC_COOLCONF, TMC_PWMCONF, TMC_REGISTER_COUNT };
+
+/**
+ * @brief Shadow copy of a configuration register
+ *
+ */
+struct tmcShadowRegister_s {
+    uint32_t written;  // Value last sent to the driver
+    uint32_t pending;  // Value to be sent on the next flush()
+};
+
+/**
+ * @brief Wrapper of the TMC2130 driver keeping shadow copies of the configuration registers
+ *
+ * Setters only change the shadow copies, flush() sends every register whose value actually changed in one batch. Redundant writes, for
+ * example toff(1) on every forced stop, thus cause no SPI traffic.
+ */
+class TmcDriver {
+   private:
+    TMC2130Stepper _driver;                                 // Underlying driver
+    tmcShadowRegister_s _registers[TMC_REGISTER_COUNT];  // Shadow copies of the configuration registers
+
+    // Status polling
+    uint32_t _drvStatus = 0;    // DRV_STATUS as read by the last readDrvStatus()
+    bool _statusValid = false;  // Flag whether _drvStatus was read at least once, 0 would read as full load
+    bool _scheduled = false;    // Flag whether a TmcBusScheduler sends writes and reads the status
+    bool _pollUrgent = false;   // Flag whether the status is needed every cycle, e.g. while homing
+
+    // Statistics
+    uint32_t _writesRequested = 0;  // Number of register changes requested via setters
+    uint32_t _writesSent = 0;       // Number of register writes actually sent
+    uint32_t _readsSent = 0;        // Number of register reads sent, status and synchronisation
+
+    /**
+     * @brief Change a bit field in the pending value of a shadow register
+     *
+     * @param reg register to be changed
+     * @param shift position of the lowest bit of the field
+     * @param width bit count of the field
+     * @param value new value of the field
+     */
+    void setField(tmcRegister_e reg, uint8_t shift, uint8_t width, uint32_t value);
+
+    /**
+     * @brief Take over the register values as known by the underlying driver, needed after using its own configuration methods
+     *
+     */
+    void syncRegisters();
+
+   public:
+    /**
+     * @brief Constructor
+     *
+     * @param pinCs chip select pin of the driver
+     */
+    TmcDriver(uint16_t pinCs);
+
+    /**
+     * @brief Initialise SPI communication and the shadow registers
+     *
+     */
+    void begin();
+
+    /**
+     * @brief Send all changed registers to the driver
+     *
+     * @param maxWrites maximum number of registers to be sent, the rest stays pending
+     * @return uint8_t number of registers sent
+     */
+    uint8_t flush(uint8_t maxWrites = TMC_REGISTER_COUNT);
+
+    /**
+     * @brief Check whether registers are waiting to be sent
+     *
+     * @return true flush() would send data
+     * @return false all registers are up to date
+     */
+    bool hasPendingWrites();
+
+    /**
+     * @brief Read the status register, always sent to the driver
+     *
+     * @return uint32_t raw DRV_STATUS, see TMC2130_n::DRV_STATUS_t
+     */
+    uint32_t readDrvStatus();
+
+    /**
+     * @brief Read the status register from another task, e.g. by the stream sampler. Neither the status of getDrvStatus() nor the
+     * statistics are touched, the caller accounts for the transaction (see TmcBusScheduler::read())
+     *
+     * @return uint32_t raw DRV_STATUS, see TMC2130_n::DRV_STATUS_t
+     */
+    uint32_t sampleDrvStatus();
+
+    /**
+     * @brief Get the status register as read by the last readDrvStatus() without SPI traffic
+     *
+     * @return uint32_t raw DRV_STATUS, see TMC2130_n::DRV_STATUS_t
+     */
+    uint32_t getDrvStatus();
+
+    /**
+     * @brief Check whether the status register was read at least once, before that getDrvStatus() returns 0
+     *
+     * @return true getDrvStatus() holds a real status
+     * @return false not read yet
+     */
+    bool hasStatus();
+
+    // Getter-method
+    bool isScheduled();
+
+    /**
+     * @brief Hand over writes and status reads to a bus scheduler, set by TmcBusScheduler::add()
+     *
+     * @param scheduled true=scheduler sends writes and reads the status, false=owner calls flush() and readDrvStatus() itself
+     */
+    void setScheduled(bool scheduled);
+
+    // Getter-method
+    bool isPollUrgent();
+
+    /**
+     * @brief Request the status to be read every cycle by the bus scheduler instead of in turns with the other drivers
+     *
+     * @param urgent true=read every cycle, false=read in turns
+     */
+    void setPollUrgent(bool urgent);
+
+    /**
+     * @brief Set the motor current, sent immediately since the underlying driver calculates several registers from it
+     *
+     * @param currentMa rms current in mA
+     */
+    void rms_current(uint16_t currentMa);
+
+    /**
+     * @brief Set the microstep resolution, sent immediately since the underlying driver calculates the register value
+     *
+     * @param microsteps microsteps per full step
+     */
+    void microsteps(uint16_t microsteps);
+
+    // CHOPCONF
+    void toff(uint8_t value);
+    void blank_time(uint8_t value);
+    void vhighfs(bool value);
+    void vhighchm(bool value);
+
+    // COOLCONF
+    void semin(uint8_t value);
+    void seup(uint8_t value);
+    void semax(uint8_t value);
+    void sedn(uint8_t value);
+    void seimin(bool value);
+    void sgt(int8_t value);
+    void sfilt(bool value);
+
+    // GCONF
+    void en_pwm_mode(bool value);
+    void diag1_stall(bool value);
+    void diag1_pushpull(bool value);
+
+    // PWMCONF
+    void pwm_autoscale(bool value);
+
+    // Velocity thresholds
+    void TPWMTHRS(uint32_t value);
+    void TCOOLTHRS(uint32_t value);
+    void THIGH(uint32_t value);
+
+    // Getter-method
+    uint32_t getWritesSent();
+
+    // Getter-method, number of requested register changes that needed no SPI transaction
+    uint32_t getWritesSkipped();
+
+    // Getter-method
+    uint32_t getReadsSent();
+
+    // Getter-method, all SPI transactions of this driver, including the ones sent outside of a bus scheduler
+    uint32_t getTransactions();
+};
@@ -4,11 +4,13 @@
 #include <Arduino.h>
 // Selfmade
 // Project
+#include "../utils/SerialClaim.h"
 
 bool isLogRelevant(loggingLevel_e currentLevel, loggingLevel_e messageLevel) { return currentLevel >= messageLevel; }
 
 void logPrint(loggingLevel_e currentLevel, loggingLevel_e messageLevel, const char* message, ...) {
     if (!isLogRelevant(currentLevel, messageLevel)) return;
+    if (isSerialClaimed()) return;  // Would end up in the middle of a binary frame
 
     // Set color according to messagelevel
     switch (messageLevel) {
@@ -28,31 +30,19 @@ void logPrint(loggingLevel_e currentLevel, loggingLevel_e messageLevel, const ch
             break;
     }
 
-    // Adjusted copypasta from Print.cpp
-    char loc_buf[64];
-    char* temp = loc_buf;
+    // Format on the stack, so logging never allocates. Longer messages are cut and marked with "..."
+    char buffer[LOG_BUFFER_LENGTH];
     va_list arg;
-    va_list copy;
     va_start(arg, message);
-    va_copy(copy, arg);
-    int len = vsnprintf(temp, sizeof(loc_buf), message, copy);
-    va_end(copy);
-    if (len < 0) {
-        va_end(arg);
-        return;
-    };
-    if (len >= sizeof(loc_buf)) {
-        temp = (char*)malloc(len + 1);
-        if (temp == NULL) {
-            va_end(arg);
-            return;
-        }
-        len = vsnprintf(temp, len + 1, message, arg);
-    }
+    int len = vsnprintf(buffer, sizeof(buffer), message, arg);
     va_end(arg);
-    len = Serial.write((uint8_t*)temp, len);
-    if (temp != loc_buf) {
-        free(temp);
+    if (len < 0) return;
+    if ((size_t)len >= sizeof(buffer)) {
+        size_t formatLength = strlen(message);
+        Serial.write((uint8_t*)buffer, sizeof(buffer) - 1);
+        Serial.print(formatLength > 0 && message[formatLength - 1] == '\n' ? "...\n" : "...");
+    } else {
+        Serial.write((uint8_t*)buffer, len);
     }
 
     // reset color
@@ -5,6 +5,10 @@
 // Selfmade
 // Project
 
+#ifndef LOG_BUFFER_LENGTH
+#define LOG_BUFFER_LENGTH 256  // Longest message of logPrint() incl. terminator, can be overwritten via build flag
+#endif
+
 /**
  * @brief Priority levels for logging
  */
@@ -28,7 +32,8 @@ bool isLogRelevant(loggingLevel_e currentLevel, loggingLevel_e messageLevel);
 
 /**
  * @brief Checks whether a message would be relevant enough to be logged given a current logging level, and printf's it to stdout with the
- * specific color if relevant
+ * specific color if relevant. Formats into a stack buffer of LOG_BUFFER_LENGTH, longer messages are cut. Messages are dropped while a
+ * binary frame is being sent, see claimSerial()
  *
  * @param currentLevel current level for logging
  * @param messageLevel priority level of the message
@@ -1,4 +1,9 @@
+#include "./controller/ControllerRegistry.h"
+#include "./controller/stepper/ConfiguredStepper.h"
 #include "./controller/stepper/Stepper.h"
+#include "./program/MachineProgram.h"
+#include "./protocol/CommandProtocol.h"
+#include "./protocol/TelemetryPublisher.h"
 
 stepperConfiguration_s spoolConfig = {.stepperId = "spool",
                                       .maxCurrent = 700,
@@ -12,20 +17,27 @@ stepperConfiguration_s spoolConfig = {.stepperId = "spool",
                                           .dir = 16,
                                           .step = 26,
                                           .cs = 5,
+                                          .diag = 0,
                                       }};
-stepperConfiguration_s ferrariConfig = {.stepperId = "ferrari",
-                                        .maxCurrent = 700,
-                                        .microstepsPerStep = 32,
-                                        .stepsPerRotation = 200,
-                                        .mmPerRotation = 8,
-                                        .gearRatio = 1,
-                                        .stall = 5,  // 5 = new ferrari-motor, 10 (or 9) = old ferrari-motor
-                                        .pins = {
-                                            .en = 12,
-                                            .dir = 14,
-                                            .step = 17,
-                                            .cs = 13,
-                                        }};
+// Fixed at compile time, pins and microsteps are checked by the compiler and the cycle converts with constant factors
+struct FerrariConfig {
+    static constexpr stepperConfiguration_s configuration() {
+        return {.stepperId = "ferrari",
+                .maxCurrent = 700,
+                .microstepsPerStep = 32,
+                .stepsPerRotation = 200,
+                .mmPerRotation = 8,
+                .gearRatio = 1,
+                .stall = 5,  // 5 = new ferrari-motor, 10 (or 9) = old ferrari-motor
+                .pins = {
+                    .en = 12,
+                    .dir = 14,
+                    .step = 17,
+                    .cs = 13,
+                    .diag = 0,
+                }};
+    }
+};
 stepperConfiguration_s pullerConfig = {.stepperId = "puller",
                                        .maxCurrent = 700,
                                        .microstepsPerStep = 32,
@@ -38,36 +50,70 @@ stepperConfiguration_s pullerConfig = {.stepperId = "puller",
                                            .dir = 27,
                                            .step = 25,
                                            .cs = 2,
+                                           .diag = 0,
                                        }};
 
 FastAccelStepperEngine engine = FastAccelStepperEngine();
 Stepper spool = Stepper(spoolConfig, &engine);
-Stepper ferrari = Stepper(ferrariConfig, &engine);
+ConfiguredStepper<FerrariConfig> ferrari = ConfiguredStepper<FerrariConfig>(&engine);
 Stepper puller = Stepper(pullerConfig, &engine);
+TmcBusScheduler bus = TmcBusScheduler();
+
+Stepper *steppers[] = {&spool, &ferrari, &puller};
+machineControllers_s controllers = {.steppers = steppers,
+                                    .stepperCount = 3,
+                                    .heaters = NULL,
+                                    .heaterCount = 0,
+                                    .motors = NULL,
+                                    .motorCount = 0};
+MachineProgram program = MachineProgram(controllers);
+TelemetryPublisher telemetry = TelemetryPublisher(controllers);
+#ifdef COMMAND_PROTOCOL
+CommandProtocol protocol = CommandProtocol(controllers);  // Replaces the single character commands, see CommandProtocol.h
+#endif
+
+// Commands first, so the controllers act on them in the same cycle. Master first, so the spool follows in the same cycle
+auto machine = makeControllerRegistry(program, puller, spool, ferrari);
+
+// Demo sequence of the ferrari, see MachineProgram.h for the format
+const uint8_t FERRARI_PROGRAM[] = {
+    0x51, 0x50, 0x01, 0x1B, 0x00, 0xED, 0xC4,                    // Header: 'QP', version 1, 27 bytes of code, CRC
+    0x01, 0x01, 0x46, 0x00,                                      // OP_HOME ferrari 70rpm
+    0x02, 0x01, 0x78, 0x00, 0x50, 0x00,                          // OP_MOVE ferrari 120rpm to 80mm
+    0x04, 0x01, 0x78, 0x00, 0x3F, 0x00, 0x6C, 0x00, 0x06, 0x00,  // OP_OSCILLATE ferrari 120rpm between 63mm and 108mm, 6 strokes
+    0x02, 0x01, 0x50, 0x00, 0x50, 0x00,                          // OP_MOVE ferrari 80rpm to 80mm
+    0x00,                                                        // OP_END
+};
 
 uint16_t TEMP_SPEED_RPM = 5;
+const uint32_t CONTROL_PERIOD_US = 10000;  // Period of the control cycle, every controller is handled once per cycle
+uint32_t nextCycleUs = 0;                  // micros() of the next control cycle
+const float SPOOL_PULLER_RATIO = 0.25;  // Spool rotations per puller rotation, line speed changes carry over via electronic gearing
 
 void setup() {
     SPI.begin();
     Serial.begin(115200);
-    Serial.println("\n-----------------");
+#ifndef COMMAND_PROTOCOL
+    Serial.println("\n-----------------");  // Plain text would corrupt the frames of the command protocol
+#endif
 
     // Initalisation
     engine.init();
-    spool.init();
-    puller.init();
-    ferrari.init();
+    spool.setBusScheduler(&bus);
+    puller.setBusScheduler(&bus);
+    ferrari.setBusScheduler(&bus);
+    machine.init();
 
-    McValidatorEsp32 testValidator;
-    uint8_t pins[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
-    uint16_t pinLen = 10;
-    Serial.printf("digiPinTest: %d\n", testValidator.isDigitalPin(pins, pinLen));
+#ifdef ALLOCATION_GUARD
+    AllocationGuard::reset();  // Allocations during setup are fine, only the control loop is guarded
+#endif
 
     // Set starting commands
     // ferrari.movePosition(80, 80);
 }
 
 void loop() {
+#ifndef COMMAND_PROTOCOL
     // Handle commands sent by user via terminal
     if (Serial.available() > 0) {
         uint8_t newCommand = Serial.read();
@@ -93,6 +139,13 @@ void loop() {
                 }
                 spool.switchModeOff();
                 break;
+            case 's':  // stream stall values of the spool once per full step, non-blocking alternative to 'c'
+                Serial.println("[CMD]: startStream()");
+                spool.getStream().start(0, STREAM_FULL_STEP);
+                break;
+            case 'S':
+                spool.getStream().stop();
+                break;
             case 'h':  // Home
                 Serial.println("[CMD]: home()");
                 // ferrari.moveHome(70);
@@ -102,6 +155,14 @@ void loop() {
                 Serial.println("[CMD]: home()");
                 ferrari.moveOscillate(2, 63, 108);
                 break;
+            case 'w':  // Level-wind, traverse tied to the spool rotations
+                Serial.println("[CMD]: moveWind()");
+                ferrari.moveWind(&spool, 1.75, 63, 108);
+                break;
+            case 'P':  // Program, runs next to the handle()-calls below
+                Serial.println("[CMD]: program.start()");
+                if (program.load(FERRARI_PROGRAM, sizeof(FERRARI_PROGRAM))) program.start();
+                break;
             case 'p':  // Position
                 Serial.println("[CMD]: movePosition()");
                 ferrari.movePosition(80, 80);
@@ -124,56 +185,56 @@ void loop() {
             case '1':  // Oscillate
                 Serial.println("[CMD]: 111111111111111111111()");
                 puller.moveRotate(-20);
-                spool.moveRotateWithLoadAdjust(-5, 5);
+                spool.moveFollow(&puller, SPOOL_PULLER_RATIO, 5);
                 // ferrari.moveOscillate(30, 80, 130);
                 break;
             case '2':  // Oscillate
                 Serial.println("[CMD]: 222222222222222222222222()");
                 puller.moveRotate(-30);
-                spool.moveRotateWithLoadAdjust(-7.5, 5);
+                spool.moveFollow(&puller, SPOOL_PULLER_RATIO, 5);
                 // ferrari.moveOscillate(30, 80, 130);
                 break;
             case '3':  // Oscillate
                 Serial.println("[CMD]: 333333333333333333333333333333333()");
                 puller.moveRotate(-40);
-                spool.moveRotateWithLoadAdjust(-10, 5);
+                spool.moveFollow(&puller, SPOOL_PULLER_RATIO, 5);
                 // ferrari.moveOscillate(30, 80, 130);
                 break;
             case '4':  // Oscillate
                 Serial.println("[CMD]: 44444444444444444444444444444444()");
                 puller.moveRotate(-50);
-                spool.moveRotateWithLoadAdjust(-12.5, 5);
+                spool.moveFollow(&puller, SPOOL_PULLER_RATIO, 5);
                 // ferrari.moveOscillate(30, 80, 130);
                 break;
             case '5':
                 Serial.println("[CMD]: 555555555555555555()");
                 puller.moveRotate(-60);
-                spool.moveRotateWithLoadAdjust(-15, 5);
+                spool.moveFollow(&puller, SPOOL_PULLER_RATIO, 5);
                 break;
             case '6':
                 Serial.println("[CMD]: 666666666666()");
                 puller.moveRotate(-80);
-                spool.moveRotateWithLoadAdjust(-20, 5);
+                spool.moveFollow(&puller, SPOOL_PULLER_RATIO, 5);
                 break;
             case '7':
                 Serial.println("[CMD]: 777777777777777()");
                 puller.moveRotate(-100);
-                spool.moveRotateWithLoadAdjust(-25, 5);
+                spool.moveFollow(&puller, SPOOL_PULLER_RATIO, 5);
                 break;
             case '8':
                 Serial.println("[CMD]: 88888888888888888()");
                 puller.moveRotate(-120);
-                spool.moveRotateWithLoadAdjust(-30, 5);
+                spool.moveFollow(&puller, SPOOL_PULLER_RATIO, 5);
                 break;
             case '9':
                 Serial.println("[CMD]: 999999999999999999()");
                 puller.moveRotate(-140);
-                spool.moveRotateWithLoadAdjust(-35, 5);
+                spool.moveFollow(&puller, SPOOL_PULLER_RATIO, 5);
                 break;
             case '0':
                 Serial.println("[CMD]: 000000000000000000000()");
                 puller.moveRotate(-160);
-                spool.moveRotateWithLoadAdjust(-40, 5);
+                spool.moveFollow(&puller, SPOOL_PULLER_RATIO, 5);
                 break;
 
             case 'q':
@@ -204,12 +265,14 @@ void loop() {
                 break;
             case 'x':  // mode off
                 Serial.println("[CMD]: switchModeStandby()");
+                program.abort();
                 spool.switchModeStandby();
                 ferrari.switchModeStandby();
                 puller.switchModeStandby();
                 break;
             case 'X':  // mode standby
                 Serial.println("[CMD]: switchModeOff()");
+                program.abort();
                 spool.switchModeOff();
                 ferrari.switchModeOff();
                 puller.switchModeOff();
@@ -218,6 +281,28 @@ void loop() {
                 Serial.println("[CMD]: enable debugging, printStatusLong()");
                 ferrari.printStatus(true);
                 break;
+            case 'm':  // monitor all steppers at 100 Hz, convert with tools/telemetryToCsv.cpp
+                Serial.println("[CMD]: telemetry.start()");
+                telemetry.start(10);
+                break;
+            case 'M':
+                telemetry.stop();
+                break;
+#ifdef STEPPER_TRACE_ENABLED
+            case 't':  // start tracing, freeze shortly after a stall or driver error
+                Serial.println("[CMD]: startTrace()");
+                ferrari.getTrace().start(TRACE_TRIGGER_STALL | TRACE_TRIGGER_ERROR, true, 20);
+                break;
+            case 'T':  // dump trace, convert with tools/stepperTraceToCsv.cpp. Skipped while a telemetry or stream frame is being sent
+                ferrari.dumpTrace();
+                break;
+#endif
+#ifdef ALLOCATION_GUARD
+            case 'A':  // heap allocations of the control loop since setup, should stay 0
+                Serial.printf("[CMD]: allocations: %u (%u bytes)\n", AllocationGuard::getAllocations(),
+                              (unsigned)AllocationGuard::getAllocatedBytes());
+                break;
+#endif
             case 'd':  // enable debugging
                 Serial.println("[CMD]: enable debugging");
                 // ferrari.setDebuggingLevel(INFO);
@@ -231,20 +316,18 @@ void loop() {
                 Serial.println("[CMD] Unknown command - input ignored");
         };
     }
+#endif
 
-    // Let the stepper do its thing for a second
-    for (int i = 0; i < 10; ++i) {
-        for (int k = 0; k < 10; ++k) {
-            spool.handle();
-            ferrari.handle();
-            puller.handle();
-            delay(10);  // TODO: Delay only to prevent a debug-message-flood
-        }
-        // spool.printStatus(false);
-        // ferrari.printStatus(false);
-        // puller.printStatus(false);
-    }
-    // spool.printStatus(true);
-    // ferrari.printStatus(true);
-    // puller.printStatus(true);
+    // Run the controllers at a fixed period instead of blocking in between, so commands are read while waiting. A late cycle does not
+    // shift the following ones, unless it is late by a whole period
+    uint32_t now = micros();
+    if ((int32_t)(now - nextCycleUs) < 0) return;
+    nextCycleUs = (now - nextCycleUs < CONTROL_PERIOD_US) ? nextCycleUs + CONTROL_PERIOD_US : now + CONTROL_PERIOD_US;
+
+#ifdef COMMAND_PROTOCOL
+    protocol.handle();  // Every cycle, so received commands are executed within one cycle
+#endif
+    machine.handle();
+    bus.handle();
+    telemetry.handle();
 }
@@ -0,0 +1,174 @@
+// Related
+#include "MotionProfile.h"
+// System / External
+#include <math.h>
+#include <stdint.h>
+// Selfmade
+// Project
+
+void planTrapezoidProfile(motionProfile_s &profile, float distance, float vStart, float vMax, float vEnd, float accel) {
+    if (distance < 0) distance = -distance;
+    if (accel <= 0) accel = 1;
+    if (vMax <= 0) vMax = 1;
+    vStart = fminf(fabsf(vStart), vMax);
+    vEnd = fminf(fabsf(vEnd), vMax);
+
+    // Correct end speeds that can not be reached within the distance
+    float reachable = sqrtf(vStart * vStart + 2 * accel * distance);
+    if (vEnd > reachable) vEnd = reachable;
+    float stoppable = vStart * vStart - 2 * accel * distance;
+    if (stoppable > vEnd * vEnd) vEnd = sqrtf(stoppable);
+
+    profile.distance = distance;
+    profile.vStart = vStart;
+    profile.vEnd = vEnd;
+    profile.accel = accel;
+    profile.jerk = 0;
+    profile.tJerk = 0;
+
+    float distanceAccel = (vMax * vMax - vStart * vStart) / (2 * accel);
+    float distanceDecel = (vMax * vMax - vEnd * vEnd) / (2 * accel);
+    if (distanceAccel + distanceDecel <= distance) {
+        profile.vCruise = vMax;
+        profile.tCruise = (distance - distanceAccel - distanceDecel) / vMax;
+    } else {
+        // Distance too short to reach vMax, accelerate to the peak speed and decelerate right away
+        profile.vCruise = sqrtf((2 * accel * distance + vStart * vStart + vEnd * vEnd) / 2);
+        profile.vCruise = fmaxf(profile.vCruise, fmaxf(vStart, vEnd));
+        profile.tCruise = 0;
+    }
+    profile.tAccel = (profile.vCruise - vStart) / accel;
+    profile.tDecel = (profile.vCruise - vEnd) / accel;
+}
+
+void planSCurveProfile(motionProfile_s &profile, float distance, float vMax, float accel, float jerk) {
+    if (jerk <= 0) {
+        planTrapezoidProfile(profile, distance, 0, vMax, 0, accel);
+        return;
+    }
+    if (distance < 0) distance = -distance;
+    if (accel <= 0) accel = 1;
+    if (vMax <= 0) vMax = 1;
+
+    // Speed reached at the end of the acceleration phase decides whether the full acceleration is reached
+    float speedFullAccel = accel * accel / jerk;
+    float speed = vMax;
+    float tRamp = (speed < speedFullAccel) ? 2 * sqrtf(speed / jerk) : speed / accel + accel / jerk;
+    if (speed * tRamp > distance) {
+        // Distance too short for vMax, choose the speed whose acceleration and deceleration phases cover exactly the distance
+        speed = powf(distance * sqrtf(jerk) / 2, 2.0f / 3.0f);
+        if (speed >= speedFullAccel) speed = accel / 2 * (sqrtf(accel * accel / (jerk * jerk) + 4 * distance / accel) - accel / jerk);
+        tRamp = (speed < speedFullAccel) ? 2 * sqrtf(speed / jerk) : speed / accel + accel / jerk;
+    }
+
+    profile.distance = distance;
+    profile.vStart = 0;
+    profile.vCruise = speed;
+    profile.vEnd = 0;
+    profile.jerk = jerk;
+    profile.tJerk = (speed < speedFullAccel) ? tRamp / 2 : accel / jerk;
+    profile.accel = jerk * profile.tJerk;
+    profile.tAccel = tRamp;
+    profile.tDecel = tRamp;
+    profile.tCruise = fmaxf(distance - speed * tRamp, 0) / speed;
+}
+
+/**
+ * @brief Evaluate the acceleration phase starting at v0, also used for the deceleration phase by mirroring the time at the end
+ *
+ * @param profile planned move
+ * @param v0 speed at the start of the phase in steps/s
+ * @param rampTime duration of the phase in s
+ * @param t time since start of the phase in s
+ * @param position memory location to write the distance travelled since the start of the phase to
+ * @param velocity memory location to write the speed to
+ */
+static void evaluateRamp(const motionProfile_s &profile, float v0, float rampTime, float t, float &position, float &velocity) {
+    float tConstant = fmaxf(rampTime - 2 * profile.tJerk, 0);
+    position = 0;
+    velocity = v0;
+
+    // Acceleration rising
+    float tau = fminf(t, profile.tJerk);
+    position += velocity * tau + profile.jerk * tau * tau * tau / 6;
+    velocity += profile.jerk * tau * tau / 2;
+    t -= tau;
+    if (t <= 0) return;
+
+    // Acceleration constant
+    tau = fminf(t, tConstant);
+    position += velocity * tau + profile.accel * tau * tau / 2;
+    velocity += profile.accel * tau;
+    t -= tau;
+    if (t <= 0) return;
+
+    // Acceleration falling
+    tau = fminf(t, profile.tJerk);
+    position += velocity * tau + profile.accel * tau * tau / 2 - profile.jerk * tau * tau * tau / 6;
+    velocity += profile.accel * tau - profile.jerk * tau * tau / 2;
+}
+
+void scaleProfile(motionProfile_s &profile, float factor) {
+    profile.distance *= factor;
+    profile.vStart *= factor;
+    profile.vCruise *= factor;
+    profile.vEnd *= factor;
+    profile.accel *= factor;
+    profile.jerk *= factor;
+}
+
+float profileDuration(const motionProfile_s &profile) { return profile.tAccel + profile.tCruise + profile.tDecel; }
+
+float profilePositionAt(const motionProfile_s &profile, float t) {
+    if (t <= 0) return 0;
+    float duration = profileDuration(profile);
+    if (t >= duration) return profile.distance;
+
+    float position;
+    float velocity;
+    if (t < profile.tAccel) {
+        evaluateRamp(profile, profile.vStart, profile.tAccel, t, position, velocity);
+        return position;
+    }
+    if (t < profile.tAccel + profile.tCruise) {
+        evaluateRamp(profile, profile.vStart, profile.tAccel, profile.tAccel, position, velocity);
+        return position + profile.vCruise * (t - profile.tAccel);
+    }
+    evaluateRamp(profile, profile.vEnd, profile.tDecel, duration - t, position, velocity);
+    return fmaxf(profile.distance - position, 0);
+}
+
+float profileVelocityAt(const motionProfile_s &profile, float t) {
+    if (t <= 0) return profile.vStart;
+    float duration = profileDuration(profile);
+    if (t >= duration) return profile.vEnd;
+    if (t >= profile.tAccel && t < profile.tAccel + profile.tCruise) return profile.vCruise;
+
+    float position;
+    float velocity;
+    if (t < profile.tAccel) {
+        evaluateRamp(profile, profile.vStart, profile.tAccel, t, position, velocity);
+    } else {
+        evaluateRamp(profile, profile.vEnd, profile.tDecel, duration - t, position, velocity);
+    }
+    return velocity;
+}
+
+float profileTimeAtPosition(const motionProfile_s &profile, float position) {
+    if (position <= 0) return 0;
+    float duration = profileDuration(profile);
+    if (position >= profile.distance) return duration;
+
+    // Position is monotonic over time, so a bisection always converges
+    float low = 0;
+    float high = duration;
+    for (uint8_t i = 0; i < 32 && (high - low) > 1e-6f; ++i) {
+        float mid = (low + high) / 2;
+        if (profilePositionAt(profile, mid) < position) {
+            low = mid;
+        } else {
+            high = mid;
+        }
+    }
+    return high;
+}
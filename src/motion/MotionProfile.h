@@ -0,0 +1,95 @@
+#pragma once
+
+// Related
+// System / External
+#include <stdint.h>
+// Selfmade
+// Project
+
+/**
+ * @brief Speed over time of a single move in one direction, units are steps, seconds and their derivatives. The acceleration and
+ * deceleration phases each consist of a jerk phase increasing the acceleration, a phase of constant acceleration and a jerk phase
+ * decreasing it again. Without jerk limit the jerk phases are 0 long (trapezoidal speed profile)
+ *
+ */
+struct motionProfile_s {
+    float distance;  // Length of the move in steps, always positive
+    float vStart;    // Speed at the start in steps/s
+    float vCruise;   // Highest speed reached in steps/s
+    float vEnd;      // Speed at the end in steps/s
+    float accel;     // Highest acceleration and deceleration in steps/s²
+    float jerk;      // Change of acceleration in steps/s³, 0 = no limit
+    float tJerk;     // Duration of each jerk phase in s
+    float tAccel;    // Duration of the acceleration phase in s
+    float tCruise;   // Duration of the constant speed phase in s
+    float tDecel;    // Duration of the deceleration phase in s
+};
+
+/**
+ * @brief Plan a move with constant acceleration (trapezoidal speed profile). If the distance is too short to reach vEnd, vEnd is
+ * corrected to the closest reachable speed
+ *
+ * @param profile memory location to write the planned profile to
+ * @param distance length of the move in steps
+ * @param vStart speed at the start in steps/s
+ * @param vMax highest allowed speed in steps/s
+ * @param vEnd speed at the end in steps/s
+ * @param accel acceleration in steps/s²
+ */
+void planTrapezoidProfile(motionProfile_s &profile, float distance, float vStart, float vMax, float vEnd, float accel);
+
+/**
+ * @brief Plan a move from standstill to standstill with limited jerk (S-curve speed profile). The smooth acceleration excites less
+ * resonances than constant acceleration, which allows higher speeds on the same mechanics
+ *
+ * @param profile memory location to write the planned profile to
+ * @param distance length of the move in steps
+ * @param vMax highest allowed speed in steps/s
+ * @param accel highest allowed acceleration in steps/s²
+ * @param jerk highest allowed jerk in steps/s³, 0 = no limit (trapezoidal speed profile)
+ */
+void planSCurveProfile(motionProfile_s &profile, float distance, float vMax, float accel, float jerk);
+
+/**
+ * @brief Scale the distance of a move while keeping its timing, e.g. to let several axes move in sync. Speeds, acceleration and jerk
+ * scale by the same factor
+ *
+ * @param profile planned move to be scaled
+ * @param factor scaling factor, must be positive
+ */
+void scaleProfile(motionProfile_s &profile, float factor);
+
+/**
+ * @brief Get the total duration of a move
+ *
+ * @param profile planned move
+ * @return float duration in s
+ */
+float profileDuration(const motionProfile_s &profile);
+
+/**
+ * @brief Get the distance travelled after some time
+ *
+ * @param profile planned move
+ * @param t time since start of the move in s
+ * @return float travelled distance in steps
+ */
+float profilePositionAt(const motionProfile_s &profile, float t);
+
+/**
+ * @brief Get the speed after some time
+ *
+ * @param profile planned move
+ * @param t time since start of the move in s
+ * @return float speed in steps/s
+ */
+float profileVelocityAt(const motionProfile_s &profile, float t);
+
+/**
+ * @brief Get the time at which a distance is reached
+ *
+ * @param profile planned move
+ * @param position travelled distance in steps
+ * @return float time since start of the move in s
+ */
+float profileTimeAtPosition(const motionProfile_s &profile, float position);
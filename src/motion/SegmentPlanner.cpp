@@ -0,0 +1,78 @@
+// Related
+#include "SegmentPlanner.h"
+// System / External
+#include <math.h>
+#include <stdint.h>
+// Selfmade
+// Project
+#include "MotionProfile.h"
+
+void SegmentPlanner::reset() {
+    _head = 0;
+    _count = 0;
+    _entrySpeed = 0;
+    _entryDirection = 0;
+}
+
+plannerWaypoint_s &SegmentPlanner::waypointAt(uint8_t index) { return _waypoints[(_head + index) % SEGMENT_PLANNER_LENGTH]; }
+
+bool SegmentPlanner::add(int32_t target, float vMax) {
+    if (_count >= SEGMENT_PLANNER_LENGTH) return false;
+    plannerWaypoint_s &waypoint = waypointAt(_count);
+    waypoint.target = target;
+    waypoint.vMax = fabsf(vMax);
+    _count++;
+    return true;
+}
+
+bool SegmentPlanner::pop(int32_t start, float accel, motionProfile_s &profile, bool &forward) {
+    if (_count == 0) return false;
+
+    // junction[i] is the speed at the start of segment i, junction[_count] the final standstill
+    float junction[SEGMENT_PLANNER_LENGTH + 1];
+    float distance[SEGMENT_PLANNER_LENGTH];
+    int8_t direction[SEGMENT_PLANNER_LENGTH];
+    int32_t previous = start;
+    for (uint8_t i = 0; i < _count; ++i) {
+        plannerWaypoint_s &waypoint = waypointAt(i);
+        int32_t steps = waypoint.target - previous;
+        distance[i] = fabsf((float)steps);
+        direction[i] = steps > 0 ? 1 : (steps < 0 ? -1 : 0);
+        previous = waypoint.target;
+
+        // Highest speed allowed at the junction itself, reversals at standstill
+        if (i == 0) {
+            junction[i] = (direction[i] == _entryDirection) ? fminf(_entrySpeed, waypoint.vMax) : 0;
+        } else {
+            junction[i] = (direction[i] == direction[i - 1] && direction[i] != 0) ? fminf(waypoint.vMax, waypointAt(i - 1).vMax) : 0;
+        }
+    }
+    junction[_count] = 0;
+
+    // Backward pass: every junction must allow stopping at the last waypoint
+    for (int8_t i = _count - 1; i > 0; --i) {
+        junction[i] = fminf(junction[i], sqrtf(junction[i + 1] * junction[i + 1] + 2 * accel * distance[i]));
+    }
+    // Forward pass: every junction must be reachable from the previous one
+    for (uint8_t i = 0; i < _count; ++i) {
+        junction[i + 1] = fminf(junction[i + 1], sqrtf(junction[i] * junction[i] + 2 * accel * distance[i]));
+    }
+
+    // Release the first segment, the planner corrects the exit speed in case the fixed entry speed is too high to brake in time
+    plannerWaypoint_s &first = waypointAt(0);
+    planTrapezoidProfile(profile, distance[0], junction[0], fmaxf(first.vMax, junction[0]), junction[1], accel);
+    forward = direction[0] > 0;
+    if (direction[0] != 0) {
+        _entrySpeed = profile.vEnd;
+        _entryDirection = direction[0];
+    }
+    _head = (_head + 1) % SEGMENT_PLANNER_LENGTH;
+    _count--;
+    return true;
+}
+
+uint8_t SegmentPlanner::getCount() { return _count; }
+
+uint8_t SegmentPlanner::getFree() { return SEGMENT_PLANNER_LENGTH - _count; }
+
+float SegmentPlanner::getEntrySpeed() { return _entrySpeed; }
@@ -0,0 +1,84 @@
+#pragma once
+
+// Related
+// System / External
+#include <stdint.h>
+// Selfmade
+// Project
+#include "MotionProfile.h"
+
+#ifndef SEGMENT_PLANNER_LENGTH
+#define SEGMENT_PLANNER_LENGTH 16  // Number of waypoints the planner looks ahead
+#endif
+
+/**
+ * @brief Waypoint of a path, the segment leading to it is travelled with at most vMax
+ *
+ */
+struct plannerWaypoint_s {
+    int32_t target;  // Position in steps
+    float vMax;      // Highest speed on the way to the target in steps/s
+};
+
+/**
+ * @brief Plans a path through several waypoints of one axis without stopping at each of them. Like CNC firmware, the speed at each
+ * junction is the highest one that still allows stopping at the last buffered waypoint (backward pass) and that can be reached from
+ * the previous junction (forward pass). Reversals are passed at standstill
+ *
+ * Segments are released one by one as profile, the exit speed of a released segment is fixed and becomes the entry speed of the next.
+ * Since every plan is able to stop within the buffered waypoints, adding further waypoints never requires to brake harder.
+ */
+class SegmentPlanner {
+   private:
+    plannerWaypoint_s _waypoints[SEGMENT_PLANNER_LENGTH];  // Ring buffer of waypoints not released yet
+    uint8_t _head = 0;                                     // Index of the first waypoint
+    uint8_t _count = 0;                                    // Number of buffered waypoints
+    float _entrySpeed = 0;                                 // Exit speed of the last released segment in steps/s
+    int8_t _entryDirection = 0;                            // Direction of the last released segment, 0 = standstill
+
+    /**
+     * @brief Get a buffered waypoint
+     *
+     * @param index position in the buffer, 0 = next to be released
+     * @return plannerWaypoint_s& waypoint
+     */
+    plannerWaypoint_s &waypointAt(uint8_t index);
+
+   public:
+    /**
+     * @brief Drop all waypoints and start from standstill
+     *
+     */
+    void reset();
+
+    /**
+     * @brief Append a waypoint
+     *
+     * @param target position in steps
+     * @param vMax highest speed on the way to the target in steps/s
+     * @return true added
+     * @return false buffer full
+     */
+    bool add(int32_t target, float vMax);
+
+    /**
+     * @brief Plan the junction speeds of all buffered waypoints and release the segment to the first one
+     *
+     * @param start position in steps the segment starts at, usually the target of the last released segment
+     * @param accel acceleration in steps/s²
+     * @param profile memory location to write the profile of the segment to
+     * @param forward memory location to write the direction to, true = position counts up
+     * @return true segment released
+     * @return false no waypoints left
+     */
+    bool pop(int32_t start, float accel, motionProfile_s &profile, bool &forward);
+
+    // Getter-method
+    uint8_t getCount();
+
+    // Getter-method
+    uint8_t getFree();
+
+    // Getter-method, exit speed of the last released segment in steps/s
+    float getEntrySpeed();
+};
@@ -0,0 +1,49 @@
+// Related
+#include "SpoolDiameterEstimator.h"
+// System / External
+#include <math.h>
+#include <stdint.h>
+// Selfmade
+// Project
+
+SpoolDiameterEstimator::SpoolDiameterEstimator(float coreDiameterMm, float maxDiameterMm) { reset(coreDiameterMm, maxDiameterMm); }
+
+void SpoolDiameterEstimator::reset(float coreDiameterMm, float maxDiameterMm) {
+    _coreDiameter = fabsf(coreDiameterMm) > 0 ? fabsf(coreDiameterMm) : 1;
+    _maxDiameter = fmaxf(fabsf(maxDiameterMm), _coreDiameter);
+    _diameter = _coreDiameter;
+    clearReference();
+}
+
+void SpoolDiameterEstimator::clearReference() { _referenced = false; }
+
+bool SpoolDiameterEstimator::update(float lineLengthMm, float spoolRotations) {
+    if (!_referenced) {
+        _referenceLength = lineLengthMm;
+        _referenceRotations = spoolRotations;
+        _referenced = true;
+        return false;
+    }
+
+    float rotations = fabsf(spoolRotations - _referenceRotations);
+    if (rotations < MIN_ROTATIONS) return false;
+    float length = fabsf(lineLengthMm - _referenceLength);
+    _referenceLength = lineLengthMm;
+    _referenceRotations = spoolRotations;
+
+    // The line wound during one rotation equals the circumference, far off values come from slack or slip
+    float measured = length / (PI_F * rotations);
+    if (measured < _coreDiameter * 0.9f || measured > _maxDiameter * 1.1f) return false;
+
+    measured = fminf(fmaxf(measured, _coreDiameter), _maxDiameter);
+    _diameter += SMOOTHING * (measured - _diameter);
+    return true;
+}
+
+float SpoolDiameterEstimator::getDiameter() { return _diameter; }
+
+float SpoolDiameterEstimator::getSmoothing() { return SMOOTHING; }
+
+float SpoolDiameterEstimator::getSpoolRpm(float lineSpeedMmPerMin) { return lineSpeedMmPerMin / (PI_F * _diameter); }
+
+float SpoolDiameterEstimator::getRatio(float mmPerRotation) { return mmPerRotation / (PI_F * _diameter); }
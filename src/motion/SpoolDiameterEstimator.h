@@ -0,0 +1,86 @@
+#pragma once
+
+// Related
+// System / External
+#include <stdint.h>
+// Selfmade
+// Project
+
+/**
+ * @brief Estimates the current winding diameter of a spool from the line length wound per spool rotation. The estimate gives the
+ * spool speed needed for a line speed (feedforward), so a load loop only has to correct small errors
+ *
+ */
+class SpoolDiameterEstimator {
+   private:
+    const float MIN_ROTATIONS = 0.5;  // Spool rotations needed for a new measurement, shorter windows are dominated by noise
+    const float SMOOTHING = 0.3;      // Weight of a new measurement, 1 = no filtering
+    const float PI_F = 3.14159265f;
+
+    float _coreDiameter;            // Diameter of the empty spool in mm
+    float _maxDiameter;             // Diameter of the full spool in mm
+    float _diameter;                // Current estimate in mm
+    bool _referenced = false;       // Flag whether the reference values are valid
+    float _referenceLength = 0;     // Line length at the last measurement in mm
+    float _referenceRotations = 0;  // Spool rotations at the last measurement
+
+   public:
+    /**
+     * @brief Construct a new estimator for an empty spool
+     *
+     * @param coreDiameterMm diameter of the empty spool in mm, lower limit of the estimate
+     * @param maxDiameterMm diameter of the full spool in mm, upper limit of the estimate
+     */
+    SpoolDiameterEstimator(float coreDiameterMm = 1, float maxDiameterMm = 1000);
+
+    /**
+     * @brief Start over with an empty spool
+     *
+     * @param coreDiameterMm diameter of the empty spool in mm, lower limit of the estimate
+     * @param maxDiameterMm diameter of the full spool in mm, upper limit of the estimate
+     */
+    void reset(float coreDiameterMm, float maxDiameterMm);
+
+    /**
+     * @brief Forget the last measurement but keep the estimate, e.g. when winding starts again after a stop
+     *
+     */
+    void clearReference();
+
+    /**
+     * @brief Measure the diameter once the spool has turned far enough since the last measurement. Only the changes matter, so both
+     * values may start anywhere and count in any direction
+     *
+     * @param lineLengthMm line length wound so far, e.g. puller position in mm
+     * @param spoolRotations rotations of the spool so far
+     * @return true estimate updated
+     * @return false spool has not turned far enough or the measurement is implausible
+     */
+    bool update(float lineLengthMm, float spoolRotations);
+
+    // Getter-method
+    float getDiameter();
+
+    /**
+     * @brief Get the weight of a new measurement in the estimate
+     *
+     * @return float weight 0...1
+     */
+    float getSmoothing();
+
+    /**
+     * @brief Get the spool speed needed for a line speed at the current diameter
+     *
+     * @param lineSpeedMmPerMin line speed in mm per minute
+     * @return float spool speed in rotations per minute
+     */
+    float getSpoolRpm(float lineSpeedMmPerMin);
+
+    /**
+     * @brief Get the spool rotations per rotation of a feeding roller at the current diameter
+     *
+     * @param mmPerRotation line length fed per rotation of the roller in mm
+     * @return float spool rotations per roller rotation
+     */
+    float getRatio(float mmPerRotation);
+};
@@ -0,0 +1,39 @@
+// Related
+#include "Traverse.h"
+// System / External
+#include <math.h>
+#include <stdint.h>
+// Selfmade
+// Project
+
+/**
+ * @brief Reduce a travelled distance to a single period of the traverse (there and back)
+ *
+ * @param travel travelled distance
+ * @param length distance between the endpoints, must be positive
+ * @return float travelled distance within [0, 2 * length)
+ */
+static float traversePhase(float travel, float length) { return fmodf(fabsf(travel), 2 * length); }
+
+float traversePosition(float travel, float start, float end) {
+    float length = fabsf(end - start);
+    if (length == 0) return start;
+
+    float phase = traversePhase(travel, length);
+    float offset = phase <= length ? phase : 2 * length - phase;
+    return end > start ? start + offset : start - offset;
+}
+
+int8_t traverseDirection(float travel, float start, float end) {
+    float length = fabsf(end - start);
+    if (length == 0) return 0;
+
+    bool towardsEnd = traversePhase(travel, length) < length;
+    return (towardsEnd == (end > start)) ? 1 : -1;
+}
+
+float traverseTravelAt(float position, float start, float end, bool towardsEnd) {
+    float length = fabsf(end - start);
+    float offset = (position - start) * (end - start) < 0 ? 0 : fminf(fabsf(position - start), length);  // Clamp to the endpoints
+    return towardsEnd ? offset : 2 * length - offset;
+}
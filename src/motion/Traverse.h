@@ -0,0 +1,39 @@
+#pragma once
+
+// Related
+// System / External
+#include <stdint.h>
+// Selfmade
+// Project
+
+/**
+ * @brief Fold a travelled distance into a position going back and forth between two endpoints (triangle wave), as a level-winding
+ * traverse does
+ *
+ * @param travel distance travelled since leaving start in the direction of end, negative values are mirrored
+ * @param start first endpoint
+ * @param end second endpoint
+ * @return float position between start and end
+ */
+float traversePosition(float travel, float start, float end);
+
+/**
+ * @brief Get the direction of the traverse at a travelled distance, see traversePosition()
+ *
+ * @param travel distance travelled since leaving start in the direction of end, negative values are mirrored
+ * @param start first endpoint
+ * @param end second endpoint
+ * @return int8_t 1 = position increasing, -1 = position decreasing, 0 = both endpoints are equal
+ */
+int8_t traverseDirection(float travel, float start, float end);
+
+/**
+ * @brief Get the distance that has to be travelled from start to reach a position, the inverse of traversePosition()
+ *
+ * @param position position between start and end, clamped if outside
+ * @param start first endpoint
+ * @param end second endpoint
+ * @param towardsEnd true = position is reached on the way towards end, false = on the way back to start
+ * @return float travelled distance within one period
+ */
+float traverseTravelAt(float position, float start, float end, bool towardsEnd);
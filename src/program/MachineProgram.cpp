@@ -0,0 +1,241 @@
+// Related
+#include "MachineProgram.h"
+// System / External
+#include <Arduino.h>
+// Selfmade
+// Project
+#include "../logger/logging.h"
+#include "../utils/Utils.h"
+
+// Size of the operands of each opcode, indexed by programOpcode_e
+static const uint8_t OPERAND_SIZES[OP_COUNT] = {0, 3, 5, 3, 9, 1, 2, 3, 3, 3, 4};
+
+static uint16_t readU16(const uint8_t *data) { return data[0] | (data[1] << 8); }
+
+static int16_t readI16(const uint8_t *data) { return (int16_t)readU16(data); }
+
+static uint32_t readU32(const uint8_t *data) { return readU16(data) | ((uint32_t)readU16(data + 2) << 16); }
+
+MachineProgram::MachineProgram(machineControllers_s controllers) { _controllers = controllers; }
+
+void MachineProgram::init() {}
+
+bool MachineProgram::isReady() { return true; }
+
+bool MachineProgram::load(const uint8_t *program, uint16_t length) {
+    abort();
+    _code = NULL;
+    _codeLength = 0;
+    _state = PROGRAM_EMPTY;
+
+    // Header
+    if (program == NULL || length < PROGRAM_HEADER_SIZE || readU16(program) != PROGRAM_MAGIC) {
+        logPrint(_logging, ERROR, "{program: {event: 'rejected', reason: 'no program'}}\n");
+        return false;
+    }
+    uint16_t codeLength = readU16(program + 3);
+    if (program[2] != PROGRAM_VERSION || codeLength != length - PROGRAM_HEADER_SIZE) {
+        logPrint(_logging, ERROR, "{program: {event: 'rejected', reason: 'version or length', version: %u}}\n", program[2]);
+        return false;
+    }
+    const uint8_t *code = program + PROGRAM_HEADER_SIZE;
+    if (crc16Ccitt(code, codeLength) != readU16(program + 5)) {
+        logPrint(_logging, ERROR, "{program: {event: 'rejected', reason: 'crc'}}\n");
+        return false;
+    }
+
+    // Walk all instructions once, so a running program can rely on them
+    uint16_t offset = 0;
+    while (offset < codeLength) {
+        uint8_t size = validateInstruction(code, codeLength, offset);
+        if (size == 0) {
+            logPrint(_logging, ERROR, "{program: {event: 'rejected', reason: 'instruction', pc: %u}}\n", offset);
+            return false;
+        }
+        if (code[offset] == OP_END) break;
+        offset += size;
+    }
+    if (offset >= codeLength) {
+        logPrint(_logging, ERROR, "{program: {event: 'rejected', reason: 'missing end'}}\n");
+        return false;
+    }
+
+    _code = code;
+    _codeLength = codeLength;
+    _state = PROGRAM_LOADED;
+    return true;
+}
+
+uint8_t MachineProgram::validateInstruction(const uint8_t *code, uint16_t length, uint16_t offset) {
+    uint8_t opcode = code[offset];
+    if (opcode >= OP_COUNT || offset + 1 + OPERAND_SIZES[opcode] > length) return 0;
+
+    // Controller index of the instruction
+    uint8_t index = OPERAND_SIZES[opcode] > 0 ? code[offset + 1] : 0;
+    switch (opcode) {
+        case OP_HOME:
+        case OP_MOVE:
+        case OP_ROTATE:
+        case OP_OSCILLATE:
+        case OP_STANDBY:
+        case OP_WAIT_LOAD:
+            if (index >= _controllers.stepperCount) return 0;
+            break;
+        case OP_HEAT:
+        case OP_WAIT_TEMP:
+            if (index >= _controllers.heaterCount) return 0;
+            break;
+        case OP_MOTOR: {
+            // turnRightPwm() and turnLeftPwm() take 0-255, larger values would only fail when the program runs
+            int16_t pwm = readI16(code + offset + 2);
+            if (index >= _controllers.motorCount || pwm > PROGRAM_MAX_PWM || pwm < -PROGRAM_MAX_PWM) return 0;
+            break;
+        }
+        default:  // No controller involved
+            break;
+    }
+    return 1 + OPERAND_SIZES[opcode];
+}
+
+void MachineProgram::start() {
+    if (_code == NULL) return;
+    _programCounter = 0;
+    _stepStarted = false;
+    _state = PROGRAM_RUNNING;
+}
+
+void MachineProgram::abort() {
+    if (_state != PROGRAM_RUNNING) return;
+    _state = PROGRAM_ABORTED;
+    logPrint(_logging, WARNING, "{program: {event: 'aborted', pc: %u}}\n", _programCounter);
+}
+
+void MachineProgram::fail(const char *reason) {
+    _state = PROGRAM_ABORTED;
+    logPrint(_logging, ERROR, "{program: {event: 'failed', reason: '%s', pc: %u}}\n", reason, _programCounter);
+}
+
+void MachineProgram::handle() {
+    PROFILE_HANDLE();
+    if (_state != PROGRAM_RUNNING) return;
+
+    // One instruction per call: start it, then wait for it on this and the following calls
+    const uint8_t *instruction = _code + _programCounter;
+    if (!_stepStarted) {
+        if (instruction[0] == OP_END) {
+            _state = PROGRAM_FINISHED;
+            logPrint(_logging, INFO, "{program: {event: 'finished'}}\n");
+            return;
+        }
+        startInstruction(instruction);
+        _stepStarted = true;
+        _stepStartMs = millis();
+    }
+    if (!isInstructionDone(instruction)) return;
+
+    _programCounter += 1 + OPERAND_SIZES[instruction[0]];
+    _stepStarted = false;
+}
+
+void MachineProgram::startInstruction(const uint8_t *instruction) {
+    const uint8_t *operands = instruction + 1;
+    logPrint(_logging, INFO, "{program: {event: 'step', pc: %u, op: %u}}\n", _programCounter, instruction[0]);
+
+    switch (instruction[0]) {
+        case OP_HOME:
+            _controllers.steppers[operands[0]]->moveHome(readI16(operands + 1));
+            break;
+        case OP_MOVE:
+            _controllers.steppers[operands[0]]->movePosition(readI16(operands + 1), readI16(operands + 3));
+            break;
+        case OP_ROTATE:
+            _controllers.steppers[operands[0]]->moveRotate(readI16(operands + 1));
+            break;
+        case OP_OSCILLATE:
+            _controllers.steppers[operands[0]]->moveOscillate(readI16(operands + 1), readI16(operands + 3), readI16(operands + 5));
+            break;
+        case OP_STANDBY:
+            _controllers.steppers[operands[0]]->switchModeStandby();
+            break;
+        case OP_HEAT: {
+            HeatController *heater = _controllers.heaters[operands[0]];
+            uint16_t temperature = readU16(operands + 1);
+            if (temperature == 0) {
+                heater->stop();
+                break;
+            }
+            heater->setTargetTemperature(temperature);
+            heater->start();
+            break;
+        }
+        case OP_MOTOR: {
+            DcMotor *motor = _controllers.motors[operands[0]];
+            int16_t pwm = readI16(operands + 1);
+            if (pwm > 0) {
+                motor->turnRightPwm(pwm);
+            } else if (pwm < 0) {
+                motor->turnLeftPwm(-pwm);
+            } else {
+                motor->off();
+            }
+            break;
+        }
+        case OP_WAIT_LOAD:  // Nothing to start, only waiting
+        case OP_WAIT_TEMP:
+        case OP_WAIT_MS:
+        default:
+            break;
+    }
+}
+
+bool MachineProgram::isInstructionDone(const uint8_t *instruction) {
+    const uint8_t *operands = instruction + 1;
+    Stepper *stepper = NULL;
+
+    switch (instruction[0]) {
+        case OP_HOME:
+            stepper = _controllers.steppers[operands[0]];
+            if (isStepperFailed(stepper)) return false;
+            return stepper->isHomed() && stepper->isIdle();
+        case OP_MOVE:
+        case OP_STANDBY:
+            stepper = _controllers.steppers[operands[0]];
+            if (isStepperFailed(stepper)) return false;
+            return stepper->isIdle();
+        case OP_OSCILLATE: {
+            uint16_t strokes = readU16(operands + 7);
+            stepper = _controllers.steppers[operands[0]];
+            if (strokes == 0) return true;
+            if (isStepperFailed(stepper) || stepper->hasPendingCommand()) return false;
+            if (stepper->getMotion().getRecipeMoves() < strokes) return false;
+            stepper->switchModeStandby();  // The last stroke ended at standstill, stop before the next one gets far
+            return true;
+        }
+        case OP_WAIT_LOAD:
+            stepper = _controllers.steppers[operands[0]];
+            if (isStepperFailed(stepper)) return false;
+            return stepper->getStatus().load >= operands[1];
+        case OP_WAIT_TEMP: {
+            HeatController *heater = _controllers.heaters[operands[0]];
+            if (!heater->isActive()) {
+                fail("heater not active");
+                return false;
+            }
+            return heater->getCurrentTemperature() >= readU16(operands + 1);  // NAN never reaches the temperature
+        }
+        case OP_WAIT_MS:
+            return millis() - _stepStartMs >= readU32(operands);
+        default:  // Instructions without waiting
+            return true;
+    }
+}
+
+bool MachineProgram::isStepperFailed(Stepper *stepper) {
+    if (stepper->hasPendingCommand() || stepper->getCurrentMode() != OFF) return false;
+    fail("stepper off");
+    return true;
+}
+
+programState_e MachineProgram::getState() { return _state; }
+
+uint16_t MachineProgram::getProgramCounter() { return _programCounter; }
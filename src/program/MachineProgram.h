@@ -0,0 +1,148 @@
+#pragma once
+
+// Related
+// System / External
+#include <stdint.h>
+// Selfmade
+// Project
+#include "../controller/BaseController.h"
+#include "../controller/MachineControllers.h"
+
+/**
+ * Binary program format, all values little endian:
+ *
+ *   header:      'Q' 'P' | version (u8) | code length (u16) | CRC-16/CCITT-FALSE of the code (u16)
+ *   instruction: opcode (u8) | operands as listed at programOpcode_e
+ *
+ * Steppers, heaters and motors are addressed by their index in machineControllers_s. Speeds are in rpm, positions in mm,
+ * temperatures in degree celsius. The code has to end with OP_END.
+ */
+const uint16_t PROGRAM_MAGIC = 0x5051;  // "QP" read as little endian
+const uint8_t PROGRAM_VERSION = 1;      // Format version, programs of other versions are rejected
+const uint8_t PROGRAM_HEADER_SIZE = 7;  // Bytes in front of the code
+const int16_t PROGRAM_MAX_PWM = 255;    // Highest magnitude of the pwm of OP_MOTOR, programs with larger values are rejected
+
+/**
+ * @brief Instructions of a program with their operands
+ */
+enum programOpcode_e {
+    OP_END = 0x00,        // End of the program
+    OP_HOME = 0x01,       // stepper (u8), rpm (i16): home, waits until homed
+    OP_MOVE = 0x02,       // stepper (u8), rpm (i16), position (i16): move to the position, waits until arrived
+    OP_ROTATE = 0x03,     // stepper (u8), rpm (i16): rotate endlessly, does not wait
+    OP_OSCILLATE = 0x04,  // stepper (u8), rpm (i16), start (i16), end (i16), strokes (u16): waits for the strokes, 0 = endless
+    OP_STANDBY = 0x05,    // stepper (u8): decelerate to standstill, waits until stopped
+    OP_WAIT_LOAD = 0x06,  // stepper (u8), load (u8): waits until the load in % reaches the value
+    OP_HEAT = 0x07,       // heater (u8), temperature (u16): start heating to the temperature, 0 = stop heating, does not wait
+    OP_WAIT_TEMP = 0x08,  // heater (u8), temperature (u16): waits until the measured temperature reaches the value
+    OP_MOTOR = 0x09,      // motor (u8), pwm (i16, -255-255): turn right if positive, left if negative, 0 = off, does not wait
+    OP_WAIT_MS = 0x0A,    // duration (u32): waits for the duration in ms
+    OP_COUNT              // Number of opcodes, not an instruction
+};
+
+enum programState_e { PROGRAM_EMPTY, PROGRAM_LOADED, PROGRAM_RUNNING, PROGRAM_FINISHED, PROGRAM_ABORTED };
+
+/**
+ * @brief Runs a machine program, e.g. a production sequence, without blocking
+ *
+ * Each handle() starts or checks one instruction, the controllers keep being handled by their own handle()-calls. Programs are
+ * validated completely on load(), so a running program can not fail on its format.
+ */
+class MachineProgram : public BaseController {
+   private:
+    machineControllers_s _controllers;  // Controllers the program is allowed to use
+    const uint8_t *_code = NULL;        // Instructions of the loaded program, owned by the caller
+    uint16_t _codeLength = 0;           // Size of the instructions in bytes
+    uint16_t _programCounter = 0;       // Offset of the current instruction in _code
+    bool _stepStarted = false;          // Flag whether the current instruction was started and is waited for
+    unsigned long _stepStartMs = 0;     // millis() when the current instruction was started
+    programState_e _state = PROGRAM_EMPTY;
+
+    /**
+     * @brief Check whether an instruction fits into the code, only addresses existing controllers and has operands in range
+     *
+     * @param code instructions to be checked
+     * @param length size of the code in bytes
+     * @param offset offset of the instruction in the code
+     * @return uint8_t size of the instruction including the opcode, 0 if invalid
+     */
+    uint8_t validateInstruction(const uint8_t *code, uint16_t length, uint16_t offset);
+
+    /**
+     * @brief Start the instruction, e.g. by commanding a controller
+     *
+     * @param instruction opcode followed by the operands
+     */
+    void startInstruction(const uint8_t *instruction);
+
+    /**
+     * @brief Check whether the started instruction is done, aborts the program if it can not finish anymore
+     *
+     * @param instruction opcode followed by the operands
+     * @return true done, continue with the next instruction
+     * @return false still waiting
+     */
+    bool isInstructionDone(const uint8_t *instruction);
+
+    /**
+     * @brief Check whether a stepper that is waited for was switched off, e.g. by a stall or driver error
+     *
+     * @param stepper stepper to be checked
+     * @return true stepper will not finish the instruction
+     * @return false stepper still working
+     */
+    bool isStepperFailed(Stepper *stepper);
+
+    /**
+     * @brief Stop executing instructions and log the reason
+     *
+     * @param reason text for the log
+     */
+    void fail(const char *reason);
+
+   public:
+    /**
+     * @brief Constructor
+     *
+     * @param controllers controllers the program is allowed to use, addressed by their indices
+     */
+    MachineProgram(machineControllers_s controllers);
+
+    void init();
+
+    /**
+     * @brief Execute the program step by step, call repeatedly next to the handle() of the controllers
+     *
+     */
+    void handle();
+
+    bool isReady();
+
+    /**
+     * @brief Validate a program and load it, a running program is aborted
+     *
+     * @param program header and code in the binary format, has to stay valid as long as it is loaded
+     * @param length size of the program in bytes
+     * @return true loaded, start with start()
+     * @return false invalid, the previous program was unloaded
+     */
+    bool load(const uint8_t *program, uint16_t length);
+
+    /**
+     * @brief Run the loaded program from its beginning
+     *
+     */
+    void start();
+
+    /**
+     * @brief Stop executing instructions. The controllers keep their current command, e.g. stop them via switchModeStandby()
+     *
+     */
+    void abort();
+
+    // Getter-method
+    programState_e getState();
+
+    // Getter-method, offset of the current instruction in the code
+    uint16_t getProgramCounter();
+};
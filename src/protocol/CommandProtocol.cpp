@@ -0,0 +1,247 @@
+// Related
+#include "CommandProtocol.h"
+// System / External
+#include <Arduino.h>
+#include <string.h>
+// Selfmade
+// Project
+#include "../utils/SerialClaim.h"
+#include "../utils/Utils.h"
+
+static const uint8_t COMMAND_FRAME_OVERHEAD = 3;  // Sequence number and CRC
+static const uint8_t ACK_FRAME_LENGTH = 4;        // Sequence number, status and CRC
+
+static float readFloat(const uint8_t *data) {
+    float value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static int32_t readI32(const uint8_t *data) {
+    int32_t value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+CommandProtocol::CommandProtocol(machineControllers_s controllers) { _controllers = controllers; }
+
+void CommandProtocol::init() {}
+
+bool CommandProtocol::isReady() { return true; }
+
+void CommandProtocol::handle() {
+    PROFILE_HANDLE();
+    transmitAcks();
+
+    // Read straight into the receive buffer, only as much as already arrived so nothing blocks
+    int available = Serial.available();
+    while (available > 0) {
+        uint16_t chunk = min((uint16_t)available, (uint16_t)(COMMAND_PROTOCOL_RX_LENGTH - _rxLength));
+        uint16_t read = Serial.readBytes(_rx + _rxLength, chunk);
+        if (read == 0) break;
+        available -= read;
+        _rxLength += read;
+        processReceived();
+    }
+}
+
+void CommandProtocol::receive(const uint8_t *data, size_t length) {
+    while (length > 0) {
+        uint16_t space = COMMAND_PROTOCOL_RX_LENGTH - _rxLength;
+        uint16_t chunk = length < space ? length : space;
+        memcpy(_rx + _rxLength, data, chunk);
+        _rxLength += chunk;
+        data += chunk;
+        length -= chunk;
+        processReceived();
+    }
+}
+
+void CommandProtocol::processReceived() {
+    // Process every completed frame where it is
+    for (; _scanned < _rxLength; ++_scanned) {
+        if (_rx[_scanned] != 0) continue;
+        if (_discarding) {
+            _discarding = false;
+        } else {
+            processFrame(_rx + _frameStart, _scanned - _frameStart);
+        }
+        _frameStart = _scanned + 1;
+    }
+
+    // Keep only the started frame, moved to the front. Usually all frames are complete and nothing is moved
+    if (_frameStart > 0) {
+        _rxLength -= _frameStart;
+        memmove(_rx, _rx + _frameStart, _rxLength);
+        _scanned = _rxLength;
+        _frameStart = 0;
+    }
+
+    // Frame does not fit at all, skip it up to the next delimiter
+    if (_rxLength == COMMAND_PROTOCOL_RX_LENGTH) {
+        if (!_discarding) _counters.overflows++;
+        _discarding = true;
+        _rxLength = 0;
+        _scanned = 0;
+    }
+}
+
+void CommandProtocol::processFrame(uint8_t *frame, uint16_t length) {
+    if (length == 0) return;  // Consecutive delimiters, e.g. sent to resynchronise
+
+    uint16_t decoded = cobsDecode(frame, length);
+    if (decoded < COMMAND_FRAME_OVERHEAD) {
+        _counters.crcErrors++;
+        return;
+    }
+    uint16_t payload = decoded - sizeof(uint16_t);
+    uint16_t crc = frame[payload] | (frame[payload + 1] << 8);
+    if (crc16Ccitt(frame, payload) != crc) {
+        _counters.crcErrors++;
+        return;
+    }
+    _counters.frames++;
+
+    // Retried frame, its ack got lost
+    uint8_t sequence = frame[0];
+    if (_sequenceValid && sequence == _lastSequence) {
+        _counters.duplicates++;
+        sendAck(sequence, _lastStatus);
+        return;
+    }
+
+    // Check all commands first, a frame is only executed as a whole
+    commandStatus_e status = COMMAND_OK;
+    for (uint16_t offset = 1; offset < payload;) {
+        uint8_t size = parseCommand(frame + offset, payload - offset, false);
+        if (size == 0) {
+            status = COMMAND_INVALID;
+            break;
+        }
+        offset += size;
+    }
+    if (status == COMMAND_OK) {
+        for (uint16_t offset = 1; offset < payload;) offset += parseCommand(frame + offset, payload - offset, true);
+    } else {
+        _counters.invalid++;
+    }
+
+    _sequenceValid = true;
+    _lastSequence = sequence;
+    _lastStatus = status;
+    sendAck(sequence, status);
+}
+
+uint8_t CommandProtocol::parseCommand(const uint8_t *command, uint16_t length, bool execute) {
+    if (length < 2) return 0;
+    uint8_t index = command[1];
+    const uint8_t *parameters = command + 2;
+
+    // Size of the parameters and the kind of controller addressed
+    uint8_t size = 0;
+    uint8_t controllerCount = _controllers.stepperCount;
+    switch (command[0]) {
+        case CMD_STANDBY:
+        case CMD_OFF:
+            size = 0;
+            break;
+        case CMD_ROTATE:
+        case CMD_SPEED:
+        case CMD_HOME:
+            size = 4;
+            break;
+        case CMD_POSITION:
+            size = 8;
+            break;
+        case CMD_OSCILLATE:
+            size = 12;
+            break;
+        case CMD_HEAT:
+            size = 4;
+            controllerCount = _controllers.heaterCount;
+            break;
+        default:  // Unknown command
+            return 0;
+    }
+    if (length < 2 + size || index >= controllerCount) return 0;
+    if (!execute) return 2 + size;
+
+    switch (command[0]) {
+        case CMD_ROTATE:
+            _controllers.steppers[index]->moveRotate(readFloat(parameters));
+            break;
+        case CMD_POSITION:
+            _controllers.steppers[index]->movePosition(readFloat(parameters), readI32(parameters + 4));
+            break;
+        case CMD_OSCILLATE:
+            _controllers.steppers[index]->moveOscillate(readFloat(parameters), readI32(parameters + 4), readI32(parameters + 8));
+            break;
+        case CMD_SPEED:
+            _controllers.steppers[index]->adjustMoveSpeed(readFloat(parameters));
+            break;
+        case CMD_STANDBY:
+            _controllers.steppers[index]->switchModeStandby();
+            break;
+        case CMD_OFF:
+            _controllers.steppers[index]->switchModeOff();
+            break;
+        case CMD_HOME:
+            _controllers.steppers[index]->moveHome(readFloat(parameters));
+            break;
+        case CMD_HEAT: {
+            HeatController *heater = _controllers.heaters[index];
+            float temperature = readFloat(parameters);
+            if (temperature <= 0) {
+                heater->stop();
+                break;
+            }
+            heater->setTargetTemperature(temperature);
+            heater->start();
+            break;
+        }
+        default:  // Already rejected above
+            break;
+    }
+    return 2 + size;
+}
+
+void CommandProtocol::sendAck(uint8_t sequence, commandStatus_e status) {
+    if (_ackCount == COMMAND_PROTOCOL_ACK_QUEUE) {
+        _counters.droppedAcks++;
+        return;
+    }
+    _ackSequences[_ackCount] = sequence;
+    _ackStatus[_ackCount] = status;
+    _ackCount++;
+    transmitAcks();
+}
+
+void CommandProtocol::transmitAcks() {
+    while (_ackCount > 0 && claimSerial(this)) {
+        uint8_t ack[ACK_FRAME_LENGTH] = {_ackSequences[0], _ackStatus[0]};
+        uint16_t crc = crc16Ccitt(ack, 2);
+        ack[2] = crc & 0xFF;
+        ack[3] = crc >> 8;
+
+        // Encoded ack between two delimiters, encoded again on every call and continued at the cursor
+        uint8_t encoded[ACK_FRAME_LENGTH + 3];
+        encoded[0] = 0;
+        uint8_t length = 1 + cobsEncode(ack, ACK_FRAME_LENGTH, encoded + 1);
+        encoded[length++] = 0;
+        int available = Serial.availableForWrite();
+        if (available <= 0) return;
+
+        uint8_t chunk = min(available, length - _ackCursor);
+        _ackCursor += Serial.write(encoded + _ackCursor, chunk);
+        if (_ackCursor < length) return;
+
+        // Ack complete, a writer waiting for Serial goes before the next one
+        releaseSerial(this);
+        _ackCursor = 0;
+        _ackCount--;
+        memmove(_ackSequences, _ackSequences + 1, _ackCount);
+        memmove(_ackStatus, _ackStatus + 1, _ackCount);
+    }
+}
+
+commandProtocolCounters_s CommandProtocol::getCounters() { return _counters; }
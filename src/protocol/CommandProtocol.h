@@ -0,0 +1,156 @@
+#pragma once
+
+// Related
+// System / External
+#include <stddef.h>
+#include <stdint.h>
+// Selfmade
+// Project
+#include "../controller/BaseController.h"
+#include "../controller/MachineControllers.h"
+
+#ifndef COMMAND_PROTOCOL_RX_LENGTH
+#define COMMAND_PROTOCOL_RX_LENGTH 128  // Receive buffer in bytes, limits the size of an encoded frame, can be overwritten via build flag
+#endif
+
+#ifndef COMMAND_PROTOCOL_ACK_QUEUE
+#define COMMAND_PROTOCOL_ACK_QUEUE 4  // Acks waiting for Serial, can be overwritten via build flag
+#endif
+
+/**
+ * Frames in both directions are COBS encoded and end with a zero byte, acks also start with one. Decoded, all values little endian:
+ *
+ *   command frame: sequence (u8) | commands | CRC-16/CCITT-FALSE of sequence and commands (u16)
+ *   command:       opcode (u8) | controller index (u8) | parameters as listed at commandOpcode_e
+ *   ack frame:     sequence (u8) | status (u8) | CRC-16/CCITT-FALSE of sequence and status (u16)
+ *
+ * All commands of a frame are checked before any of them is executed, so a frame is executed completely or not at all. A frame
+ * repeating the sequence number of the previous one is acknowledged again without executing it, so lost acks can be retried safely.
+ * Frames with a wrong CRC are dropped without ack.
+ */
+
+/**
+ * @brief Commands of a frame with their parameters
+ */
+enum commandOpcode_e {
+    CMD_ROTATE = 0x01,     // stepper, rpm (f32): rotate endlessly
+    CMD_POSITION = 0x02,   // stepper, rpm (f32), position in mm (i32): move to the position
+    CMD_OSCILLATE = 0x03,  // stepper, rpm (f32), start in mm (i32), end in mm (i32): move between the positions
+    CMD_SPEED = 0x04,      // stepper, rpm (f32): change the speed of the current command
+    CMD_STANDBY = 0x05,    // stepper: decelerate to standstill
+    CMD_OFF = 0x06,        // stepper: power off
+    CMD_HOME = 0x07,       // stepper, rpm (f32): home
+    CMD_HEAT = 0x08        // heater, temperature in degree celsius (f32): heat to the temperature, 0 = stop heating
+};
+
+enum commandStatus_e {
+    COMMAND_OK = 0,      // Frame executed, or already executed before
+    COMMAND_INVALID = 1  // Unknown command, unknown controller or wrong length, nothing was executed
+};
+
+/**
+ * @brief Counters of the protocol, e.g. to judge the quality of the connection
+ *
+ */
+struct commandProtocolCounters_s {
+    uint32_t frames;       // Frames with a valid CRC
+    uint32_t crcErrors;    // Frames dropped due to their encoding or CRC
+    uint32_t invalid;      // Frames rejected due to their commands
+    uint32_t duplicates;   // Frames repeated by the sender, acknowledged without being executed
+    uint32_t overflows;    // Frames dropped as they did not fit in the receive buffer
+    uint32_t droppedAcks;  // Acks not sent as the ack queue was full, i.e. Serial was busy for long
+};
+
+/**
+ * @brief Receives command frames from Serial and executes them on the machine controllers
+ *
+ * Frames are decoded and parsed in place in the receive buffer. handle() processes every frame received so far, so a command is
+ * executed in the cycle it arrives in.
+ */
+class CommandProtocol : public BaseController {
+   private:
+    machineControllers_s _controllers;         // Controllers the commands are executed on
+    uint8_t _rx[COMMAND_PROTOCOL_RX_LENGTH];   // Receive buffer, frames are decoded in place
+    uint16_t _rxLength = 0;                    // Bytes in the receive buffer
+    uint16_t _frameStart = 0;                  // Start of the frame being received
+    uint16_t _scanned = 0;                     // Bytes already checked for the delimiter
+    bool _discarding = false;                  // Flag whether the rest of an oversized frame is skipped
+    bool _sequenceValid = false;               // Flag whether a frame was executed before, see _lastSequence
+    uint8_t _lastSequence = 0;                 // Sequence number of the last executed frame
+    commandStatus_e _lastStatus = COMMAND_OK;  // Status of the last executed frame, repeated for duplicates
+    commandProtocolCounters_s _counters = {};  // Statistics
+
+    // Acks waiting for Serial, oldest first
+    uint8_t _ackSequences[COMMAND_PROTOCOL_ACK_QUEUE];  // Sequence numbers of the acknowledged frames
+    uint8_t _ackStatus[COMMAND_PROTOCOL_ACK_QUEUE];     // Results of the acknowledged frames, see commandStatus_e
+    uint8_t _ackCount = 0;                              // Number of queued acks
+    uint8_t _ackCursor = 0;                             // Bytes of the oldest ack already sent
+
+    /**
+     * @brief Execute the frames completed in the receive buffer and make room for the next bytes
+     *
+     */
+    void processReceived();
+
+    /**
+     * @brief Decode, check and execute a received frame
+     *
+     * @param frame encoded frame without delimiter, overwritten while decoding
+     * @param length size of the encoded frame in bytes
+     */
+    void processFrame(uint8_t *frame, uint16_t length);
+
+    /**
+     * @brief Check a command and execute it if requested
+     *
+     * @param command opcode followed by the parameters
+     * @param length bytes left in the frame starting at command
+     * @param execute true = execute the command, false = only check it
+     * @return uint8_t size of the command in bytes, 0 if invalid
+     */
+    uint8_t parseCommand(const uint8_t *command, uint16_t length, bool execute);
+
+    /**
+     * @brief Queue an ack frame and send the queued ones, dropped if the queue is full
+     *
+     * @param sequence sequence number of the acknowledged frame
+     * @param status result of the frame
+     */
+    void sendAck(uint8_t sequence, commandStatus_e status);
+
+    /**
+     * @brief Send as much of the queued acks as the Serial transmit buffer takes without blocking. Like other frames, an ack keeps
+     * Serial claimed until it is sent completely
+     *
+     */
+    void transmitAcks();
+
+   public:
+    /**
+     * @brief Constructor
+     *
+     * @param controllers controllers the commands are executed on, addressed by their indices
+     */
+    CommandProtocol(machineControllers_s controllers);
+
+    void init();
+
+    /**
+     * @brief Read everything Serial received so far and execute the completed frames, call repeatedly
+     *
+     */
+    void handle();
+
+    bool isReady();
+
+    /**
+     * @brief Process received bytes, e.g. from another interface than Serial. Acks are still sent via Serial
+     *
+     * @param data received bytes, may contain parts of frames
+     * @param length number of bytes
+     */
+    void receive(const uint8_t *data, size_t length);
+
+    // Getter-method
+    commandProtocolCounters_s getCounters();
+};
@@ -0,0 +1,330 @@
+// Related
+#include "ModbusSlave.h"
+// System / External
+#include <Arduino.h>
+#include <math.h>
+// Selfmade
+// Project
+#include "../utils/Utils.h"
+
+static const uint16_t MODBUS_MAX_READ = 125;   // Registers per read request
+static const uint16_t MODBUS_MAX_WRITE = 123;  // Registers per write request
+static const uint8_t MODBUS_KIND_BLOCKS = 16;  // Blocks of each kind of controller between two bases
+
+static uint16_t readU16(const uint8_t *data) { return (data[0] << 8) | data[1]; }
+
+static void writeU16(uint8_t *data, uint16_t value) {
+    data[0] = value >> 8;
+    data[1] = value & 0xFF;
+}
+
+static const uint8_t MODBUS_MAX_RX_TIMEOUT = 126;  // Longest receive timeout of the UART in characters
+
+ModbusSlave::ModbusSlave(machineControllers_s controllers, uint8_t address, uint32_t baud, Stream *port) {
+    _controllers = controllers;
+    _address = address;
+    _port = port;
+    _baud = baud;
+
+    // 3.5 characters of 11 bits, fixed to 1750 us above 19200 baud as recommended by the specification
+    _silenceUs = baud > 19200 ? 1750 : 38500000UL / baud;
+}
+
+ModbusSlave::ModbusSlave(machineControllers_s controllers, uint8_t address, uint32_t baud, HardwareSerial *port)
+    : ModbusSlave(controllers, address, baud, (Stream *)port) {
+    _uart = port;
+}
+
+void ModbusSlave::init() {
+    if (_uart == NULL) return;
+
+    // The timeout counts in characters of 11 bits, rounded up so it never ends a request early
+    uint32_t symbols = ((uint64_t)_silenceUs * _baud + 10999999) / 11000000;
+    _uart->setRxTimeout((uint8_t)min(symbols, (uint32_t)MODBUS_MAX_RX_TIMEOUT));
+    _uart->onReceive([this]() { _rxTimedOut = true; }, true);
+}
+
+bool ModbusSlave::isReady() {
+    return _port != NULL && _controllers.stepperCount + _controllers.heaterCount + _controllers.motorCount <= MODBUS_MAX_BLOCKS &&
+           _controllers.stepperCount <= MODBUS_KIND_BLOCKS && _controllers.heaterCount <= MODBUS_KIND_BLOCKS &&
+           _controllers.motorCount <= MODBUS_KIND_BLOCKS;
+}
+
+void ModbusSlave::handle() {
+    PROFILE_HANDLE();
+    if (!isReady()) return;
+
+    // Send the rest of a response first, a master does not send the next request before
+    if (_txLength > 0) {
+        int available = _port->availableForWrite();
+        if (available > 0) {
+            uint16_t chunk = min((uint16_t)available, (uint16_t)(_txLength - _txCursor));
+            _txCursor += _port->write(_tx + _txCursor, chunk);
+            if (_txCursor >= _txLength) _txLength = 0;
+        }
+    }
+
+    // Take the timeout before the bytes, so everything that arrived up to it is read below
+    bool timedOut = _rxTimedOut;
+    _rxTimedOut = false;
+
+    // Take everything that arrived, bytes beyond the longest frame are dropped with the request
+    bool received = false;
+    while (_port->available() > 0) {
+        uint8_t byte = _port->read();
+        received = true;
+        if (_rxLength < MODBUS_FRAME_LENGTH) {
+            _rx[_rxLength++] = byte;
+        } else {
+            _rxOverflow = true;
+        }
+    }
+    unsigned long now = micros();
+    if (received) _lastByteUs = now;
+    if (_rxLength == 0) return;
+
+    // A request ends with silence on the bus. The UART reports it exactly, otherwise it is only measured between two handle()-calls
+    // and known requests are answered as soon as they are complete
+    if (_uart != NULL) {
+        if (!timedOut) return;
+    } else {
+        uint16_t expected = getExpectedLength();
+        bool complete = !_rxOverflow && expected > 0 && _rxLength == expected &&
+                        crc16Modbus(_rx, _rxLength - 2) == (_rx[_rxLength - 2] | (_rx[_rxLength - 1] << 8));
+        if (!complete && now - _lastByteUs < _silenceUs) return;
+    }
+
+    if (!_rxOverflow) processRequest();
+    _rxLength = 0;
+    _rxOverflow = false;
+}
+
+uint16_t ModbusSlave::getExpectedLength() {
+    if (_rxLength < 2) return 0;
+    switch (_rx[1]) {
+        case 3:
+        case 4:
+        case 6:
+            return 8;
+        case 16:
+            return _rxLength >= 7 ? 9 + _rx[6] : 0;
+        default:  // Unknown function, wait for the silence
+            return 0;
+    }
+}
+
+void ModbusSlave::processRequest() {
+    if (_rxLength < 4 || crc16Modbus(_rx, _rxLength - 2) != (_rx[_rxLength - 2] | (_rx[_rxLength - 1] << 8))) {
+        _crcErrors++;
+        return;
+    }
+    uint8_t address = _rx[0];
+    if (address != _address && address != 0) return;  // Other slave
+    _requests++;
+
+    // Address 0 is a broadcast, writes are executed without response
+    bool broadcast = address == 0;
+    uint8_t function = _rx[1];
+    uint16_t start = _rxLength >= 6 ? readU16(_rx + 2) : 0;
+    uint16_t count = _rxLength >= 6 ? readU16(_rx + 4) : 0;
+    switch (function) {
+        case 3:
+        case 4: {
+            if (broadcast) return;
+            if (_rxLength != 8 || count == 0 || count > MODBUS_MAX_READ) return sendException(function, 3);
+            if (!isRangeMapped(start, count)) return sendException(function, 2);
+
+            // One snapshot per request, so multi-register values are consistent
+            if (function == 4) takeSnapshot();
+            _tx[0] = _address;
+            _tx[1] = function;
+            _tx[2] = count * 2;
+            for (uint16_t i = 0; i < count; ++i) {
+                uint16_t registerAddress = start + i;
+                int8_t block = findBlock(registerAddress);
+                uint8_t offset = registerAddress % MODBUS_BLOCK_SIZE;
+                writeU16(_tx + 3 + i * 2, function == 3 ? _holding[block][offset] : _snapshot[block][offset]);
+            }
+            return sendResponse(3 + count * 2);
+        }
+        case 6: {
+            if (_rxLength != 8) return;
+            if (!isRangeMapped(start, 1)) return broadcast ? (void)0 : sendException(function, 2);
+            writeRegister(start, count);  // Second word is the value
+            if (start % MODBUS_BLOCK_SIZE == 0) executeCommand(findBlock(start));
+            if (broadcast) return;
+            memcpy(_tx, _rx, 6);  // Echo of the request
+            return sendResponse(6);
+        }
+        case 16: {
+            if (_rxLength < 9 || count == 0 || count > MODBUS_MAX_WRITE || _rx[6] != count * 2 || _rxLength != 9 + count * 2) {
+                return broadcast ? (void)0 : sendException(function, 3);
+            }
+            if (!isRangeMapped(start, count)) return broadcast ? (void)0 : sendException(function, 2);
+
+            // Store all values first, so a command sees the setpoints of the same request
+            for (uint16_t i = 0; i < count; ++i) writeRegister(start + i, readU16(_rx + 7 + i * 2));
+            for (uint16_t i = 0; i < count; ++i) {
+                if ((start + i) % MODBUS_BLOCK_SIZE == 0) executeCommand(findBlock(start + i));
+            }
+            if (broadcast) return;
+            memcpy(_tx, _rx, 6);  // Address, function, start and count
+            return sendResponse(6);
+        }
+        default:
+            if (!broadcast) sendException(function, 1);
+            return;
+    }
+}
+
+int8_t ModbusSlave::findBlock(uint16_t address) {
+    uint8_t index = (address % 256) / MODBUS_BLOCK_SIZE;
+    if (address < MODBUS_HEATER_BASE) return index < _controllers.stepperCount ? index : -1;
+    if (address < MODBUS_MOTOR_BASE) return index < _controllers.heaterCount ? _controllers.stepperCount + index : -1;
+    if (address < MODBUS_MOTOR_BASE + 256) {
+        return index < _controllers.motorCount ? _controllers.stepperCount + _controllers.heaterCount + index : -1;
+    }
+    return -1;
+}
+
+bool ModbusSlave::isRangeMapped(uint16_t address, uint16_t count) {
+    if (address + count > 0xFFFF) return false;
+    for (uint16_t i = 0; i < count; ++i) {
+        if (findBlock(address + i) < 0) return false;
+    }
+    return true;
+}
+
+void ModbusSlave::takeSnapshot() {
+    uint8_t block = 0;
+    for (uint8_t i = 0; i < _controllers.stepperCount; ++i, ++block) {
+        Stepper *stepper = _controllers.steppers[i];
+        stepperStatus_s status = stepper->getStatus();
+        uint16_t *registers = _snapshot[block];
+        registers[MODBUS_STEPPER_MODE] = stepper->getCurrentMode();
+        registers[MODBUS_STEPPER_CURRENT_RPM] = (int16_t)lroundf(status.rpm * 10);
+        registers[MODBUS_STEPPER_CURRENT_LOAD] = status.load;
+        registers[MODBUS_STEPPER_POSITION_HI] = (uint32_t)status.position >> 16;
+        registers[MODBUS_STEPPER_POSITION_LO] = (uint32_t)status.position & 0xFFFF;
+        registers[MODBUS_STEPPER_ERRORS] = status.errorOverheating | status.errorShutdownHeat << 1 | status.errorShutdownShortCircuit << 2 |
+                                           status.errorOpenLoad << 3 | status.errorStall << 4;
+        registers[MODBUS_STEPPER_CURRENT_SCALE] = status.currentScale;
+        registers[MODBUS_STEPPER_HOMED] = stepper->isHomed();
+        registers[MODBUS_STEPPER_DIAMETER] = lroundf(status.diameter * 10);
+        registers[MODBUS_STEPPER_IDLE] = stepper->isIdle();
+    }
+    for (uint8_t i = 0; i < _controllers.heaterCount; ++i, ++block) {
+        HeatController *heater = _controllers.heaters[i];
+        float temperature = heater->getCurrentTemperature();
+        uint16_t *registers = _snapshot[block];
+        registers[MODBUS_HEATER_TEMPERATURE] = isnan(temperature) ? 0x8000 : (int16_t)lroundf(temperature * 10);
+        registers[MODBUS_HEATER_CURRENT_TARGET] = lroundf(heater->getTargetTemperature() * 10);
+        registers[MODBUS_HEATER_HEATING] = heater->isHeating();
+        registers[MODBUS_HEATER_ACTIVE] = heater->isActive();
+        registers[MODBUS_HEATER_PID] = lroundf(heater->getPidValue());
+    }
+    for (uint8_t i = 0; i < _controllers.motorCount; ++i, ++block) {
+        DcMotor *motor = _controllers.motors[i];
+        int32_t position = motor->getPosition();
+        uint16_t *registers = _snapshot[block];
+        registers[MODBUS_MOTOR_RPM] = (int16_t)lroundf(motor->getCurrentSpeed() * 10);
+        registers[MODBUS_MOTOR_POSITION_HI] = (uint32_t)position >> 16;
+        registers[MODBUS_MOTOR_POSITION_LO] = (uint32_t)position & 0xFFFF;
+        registers[MODBUS_MOTOR_MOVING] = motor->isMoving();
+    }
+}
+
+void ModbusSlave::writeRegister(uint16_t address, uint16_t value) {
+    int8_t block = findBlock(address);
+    uint8_t offset = address % MODBUS_BLOCK_SIZE;
+    _holding[block][offset] = value;
+
+    // Setpoints that act without a command
+    if (address >= MODBUS_MOTOR_BASE && offset == MODBUS_MOTOR_PWM) {
+        DcMotor *motor = _controllers.motors[block - _controllers.stepperCount - _controllers.heaterCount];
+        int16_t pwm = value;
+        if (pwm > 0) {
+            motor->turnRightPwm(min(pwm, (int16_t)255));
+        } else if (pwm < 0) {
+            motor->turnLeftPwm(min((int16_t)-pwm, (int16_t)255));
+        } else {
+            motor->off();
+        }
+    } else if (address >= MODBUS_HEATER_BASE && address < MODBUS_MOTOR_BASE && offset == MODBUS_HEATER_TARGET) {
+        _controllers.heaters[block - _controllers.stepperCount]->setTargetTemperature(value / 10.0);
+    }
+}
+
+void ModbusSlave::executeCommand(int8_t block) {
+    uint16_t *registers = _holding[block];
+    if (block >= _controllers.stepperCount + _controllers.heaterCount) return;  // DC motors act on their setpoints directly
+    if (block >= _controllers.stepperCount) {
+        HeatController *heater = _controllers.heaters[block - _controllers.stepperCount];
+        if (registers[MODBUS_HEATER_COMMAND] != 0) {
+            heater->start();
+        } else {
+            heater->stop();
+        }
+        return;
+    }
+
+    Stepper *stepper = _controllers.steppers[block];
+    float rpm = (int16_t)registers[MODBUS_STEPPER_RPM] / 10.0;
+    int16_t position1 = registers[MODBUS_STEPPER_POSITION_1];
+    int16_t position2 = registers[MODBUS_STEPPER_POSITION_2];
+    switch (registers[MODBUS_STEPPER_COMMAND]) {
+        case MODBUS_COMMAND_ROTATE:
+            stepper->moveRotate(rpm);
+            break;
+        case MODBUS_COMMAND_POSITION:
+            stepper->movePosition(rpm, position1);
+            break;
+        case MODBUS_COMMAND_OSCILLATE:
+            stepper->moveOscillate(rpm, position1, position2);
+            break;
+        case MODBUS_COMMAND_STANDBY:
+            stepper->switchModeStandby();
+            break;
+        case MODBUS_COMMAND_OFF:
+            stepper->switchModeOff();
+            break;
+        case MODBUS_COMMAND_HOME:
+            stepper->moveHome(rpm);
+            break;
+        case MODBUS_COMMAND_SPEED:
+            stepper->adjustMoveSpeed(rpm);
+            break;
+        case MODBUS_COMMAND_LOAD_ADJUST:
+            stepper->moveRotateWithLoadAdjust(rpm, registers[MODBUS_STEPPER_LOAD]);
+            break;
+        case MODBUS_COMMAND_NONE:
+        default:
+            break;
+    }
+}
+
+void ModbusSlave::sendResponse(uint16_t length) {
+    uint16_t crc = crc16Modbus(_tx, length);
+    _tx[length++] = crc & 0xFF;
+    _tx[length++] = crc >> 8;
+    _txLength = length;
+    _txCursor = 0;
+
+    // Most responses fit into the transmit buffer right away
+    int available = _port->availableForWrite();
+    if (available > 0) {
+        _txCursor += _port->write(_tx, min((uint16_t)available, _txLength));
+        if (_txCursor >= _txLength) _txLength = 0;
+    }
+}
+
+void ModbusSlave::sendException(uint8_t function, uint8_t exception) {
+    _tx[0] = _address;
+    _tx[1] = function | 0x80;
+    _tx[2] = exception;
+    sendResponse(3);
+}
+
+uint32_t ModbusSlave::getRequests() { return _requests; }
+
+uint32_t ModbusSlave::getCrcErrors() { return _crcErrors; }
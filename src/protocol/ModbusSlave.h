@@ -0,0 +1,247 @@
+#pragma once
+
+// Related
+// System / External
+#include <Arduino.h>
+#include <stdint.h>
+// Selfmade
+// Project
+#include "../controller/BaseController.h"
+#include "../controller/MachineControllers.h"
+
+#ifndef MODBUS_MAX_BLOCKS
+#define MODBUS_MAX_BLOCKS 12  // Steppers, heaters and motors together, can be overwritten via build flag
+#endif
+
+const uint16_t MODBUS_FRAME_LENGTH = 256;  // Longest RTU frame
+const uint8_t MODBUS_BLOCK_SIZE = 16;      // Registers of each controller, blocks start at their base + index * MODBUS_BLOCK_SIZE
+const uint16_t MODBUS_STEPPER_BASE = 0;    // First register of the stepper blocks
+const uint16_t MODBUS_HEATER_BASE = 256;   // First register of the heater blocks
+const uint16_t MODBUS_MOTOR_BASE = 512;    // First register of the DC motor blocks
+
+/**
+ * @brief Holding registers of a stepper block (read / write). Writing the command executes it with the setpoints, also when they are
+ * written in the same request
+ */
+enum modbusStepperHolding_e {
+    MODBUS_STEPPER_COMMAND = 0,     // modbusStepperCommand_e, reads the last command
+    MODBUS_STEPPER_RPM = 1,         // Speed in 0.1 rpm (signed)
+    MODBUS_STEPPER_POSITION_1 = 2,  // Target of positioning, start of oscillation in mm (signed)
+    MODBUS_STEPPER_POSITION_2 = 3,  // End of oscillation in mm (signed)
+    MODBUS_STEPPER_LOAD = 4         // Desired load in % when rotating with load adjustment
+};
+
+enum modbusStepperCommand_e {
+    MODBUS_COMMAND_NONE = 0,
+    MODBUS_COMMAND_ROTATE = 1,       // moveRotate(rpm)
+    MODBUS_COMMAND_POSITION = 2,     // movePosition(rpm, position 1)
+    MODBUS_COMMAND_OSCILLATE = 3,    // moveOscillate(rpm, position 1, position 2)
+    MODBUS_COMMAND_STANDBY = 4,      // switchModeStandby()
+    MODBUS_COMMAND_OFF = 5,          // switchModeOff()
+    MODBUS_COMMAND_HOME = 6,         // moveHome(rpm)
+    MODBUS_COMMAND_SPEED = 7,        // adjustMoveSpeed(rpm)
+    MODBUS_COMMAND_LOAD_ADJUST = 8,  // moveRotateWithLoadAdjust(rpm, load)
+    MODBUS_COMMAND_COUNT             // Number of commands, not a command
+};
+
+/**
+ * @brief Input registers of a stepper block (read only)
+ */
+enum modbusStepperInput_e {
+    MODBUS_STEPPER_MODE = 0,           // stepperMode_e
+    MODBUS_STEPPER_CURRENT_RPM = 1,    // Speed in 0.1 rpm (signed)
+    MODBUS_STEPPER_CURRENT_LOAD = 2,   // Load in %
+    MODBUS_STEPPER_POSITION_HI = 3,    // Position in mm, signed 32 bit, high word
+    MODBUS_STEPPER_POSITION_LO = 4,    // Position in mm, low word
+    MODBUS_STEPPER_ERRORS = 5,         // Error bits: overheating, shutdown heat, short circuit, open load, stall (bit 0...4)
+    MODBUS_STEPPER_CURRENT_SCALE = 6,  // Current scale 0...31
+    MODBUS_STEPPER_HOMED = 7,          // 1 if the position is known
+    MODBUS_STEPPER_DIAMETER = 8,       // Estimated winding diameter in 0.1 mm, 0 = not estimated
+    MODBUS_STEPPER_IDLE = 9            // 1 while standing still without a pending command
+};
+
+/**
+ * @brief Holding registers of a heater block (read / write)
+ */
+enum modbusHeaterHolding_e {
+    MODBUS_HEATER_COMMAND = 0,  // 1 = start, 0 = stop
+    MODBUS_HEATER_TARGET = 1    // Target temperature in 0.1 degree celsius, applies right away
+};
+
+/**
+ * @brief Input registers of a heater block (read only)
+ */
+enum modbusHeaterInput_e {
+    MODBUS_HEATER_TEMPERATURE = 0,     // Measured temperature in 0.1 degree celsius (signed), 0x8000 = no measurement
+    MODBUS_HEATER_CURRENT_TARGET = 1,  // Target temperature in 0.1 degree celsius
+    MODBUS_HEATER_HEATING = 2,         // 1 while the heating element is switched on
+    MODBUS_HEATER_ACTIVE = 3,          // 1 while the temperature is maintained
+    MODBUS_HEATER_PID = 4              // Heating time per activation cycle in ms
+};
+
+/**
+ * @brief Holding registers of a DC motor block (read / write)
+ */
+enum modbusMotorHolding_e {
+    MODBUS_MOTOR_PWM = 0  // Turn right if positive, left if negative, 0 = off (signed, -255...255), applies right away
+};
+
+/**
+ * @brief Input registers of a DC motor block (read only)
+ */
+enum modbusMotorInput_e {
+    MODBUS_MOTOR_RPM = 0,          // Speed in 0.1 rpm (signed)
+    MODBUS_MOTOR_POSITION_HI = 1,  // Position in encoder ticks, signed 32 bit, high word
+    MODBUS_MOTOR_POSITION_LO = 2,  // Position in encoder ticks, low word
+    MODBUS_MOTOR_MOVING = 3        // 1 while turning
+};
+
+/**
+ * @brief Modbus RTU slave mapping the machine controllers onto holding and input registers, function codes 03, 04, 06 and 16
+ *
+ * Usage on a RS485 transceiver with automatic direction control:
+ *     ModbusSlave modbus = ModbusSlave(controllers, 1, 19200, &Serial1);
+ *     Serial1.begin(19200, SERIAL_8N1, rxPin, txPin);
+ *     modbus.init();    // in setup(), after the port is started
+ *     modbus.handle();  // in loop(), next to the controllers
+ *
+ * Requests are read without blocking and end after 3.5 characters of silence. On a HardwareSerial, the receive timeout of the UART
+ * detects the silence, independent of the handle()-frequency. Any other Stream is checked for silence in handle(), there a request
+ * of a known length also ends as soon as its CRC is valid. Reads are answered from a snapshot of all input registers taken once per
+ * request, so polling never reaches the drivers.
+ */
+class ModbusSlave : public BaseController {
+   private:
+    machineControllers_s _controllers;                              // Controllers mapped onto the registers
+    Stream *_port;                                                  // Serial port of the bus
+    HardwareSerial *_uart = NULL;                                   // Port whose receive timeout ends requests, NULL = see _silenceUs
+    volatile bool _rxTimedOut = false;                              // Flag set by the receive timeout of _uart, see init()
+    uint8_t _address;                                               // Slave address 1...247
+    uint32_t _baud;                                                 // Baud rate of the bus
+    uint32_t _silenceUs;                                            // Silence that ends a request, 3.5 characters
+    uint8_t _rx[MODBUS_FRAME_LENGTH];                               // Request being received
+    uint16_t _rxLength = 0;                                         // Bytes of the request
+    bool _rxOverflow = false;                                       // Flag whether the request did not fit, dropped at its end
+    unsigned long _lastByteUs = 0;                                  // micros() when the last byte was received
+    uint8_t _tx[MODBUS_FRAME_LENGTH];                               // Response being sent
+    uint16_t _txLength = 0;                                         // Bytes of the response, 0 = nothing to send
+    uint16_t _txCursor = 0;                                         // Bytes of the response already sent
+    uint16_t _holding[MODBUS_MAX_BLOCKS][MODBUS_BLOCK_SIZE] = {};   // Setpoints as written by the master
+    uint16_t _snapshot[MODBUS_MAX_BLOCKS][MODBUS_BLOCK_SIZE] = {};  // Input registers, taken before each request
+    uint32_t _requests = 0;                                         // Requests addressed to this slave
+    uint32_t _crcErrors = 0;                                        // Requests dropped due to their CRC or length
+
+    /**
+     * @brief Find the block of a register
+     *
+     * @param address register address
+     * @return int8_t block index over all controllers, -1 if no controller is mapped there
+     */
+    int8_t findBlock(uint16_t address);
+
+    /**
+     * @brief Length of the request in the receive buffer, as far as it can be told from its function code
+     *
+     * @return uint16_t expected length in bytes, 0 if unknown yet
+     */
+    uint16_t getExpectedLength();
+
+    /**
+     * @brief Check and answer the received request
+     *
+     */
+    void processRequest();
+
+    /**
+     * @brief Refresh the input registers of all controllers from their cached status
+     *
+     */
+    void takeSnapshot();
+
+    /**
+     * @brief Store a holding register and apply setpoints that act right away
+     *
+     * @param address register address, has to be mapped
+     * @param value new value
+     */
+    void writeRegister(uint16_t address, uint16_t value);
+
+    /**
+     * @brief Execute the command stored in the command register of a block
+     *
+     * @param block block index over all controllers
+     */
+    void executeCommand(int8_t block);
+
+    /**
+     * @brief Check whether a range of registers is mapped completely
+     *
+     * @param address first register
+     * @param count number of registers
+     * @return true all registers belong to controllers
+     * @return false at least one register is not mapped
+     */
+    bool isRangeMapped(uint16_t address, uint16_t count);
+
+    /**
+     * @brief Queue a response, the CRC is appended
+     *
+     * @param length size of the response in _tx without CRC
+     */
+    void sendResponse(uint16_t length);
+
+    /**
+     * @brief Queue an exception response
+     *
+     * @param function function code of the request
+     * @param exception exception code, 1 = illegal function, 2 = illegal address, 3 = illegal value
+     */
+    void sendException(uint8_t function, uint8_t exception);
+
+   public:
+    /**
+     * @brief Constructor for any stream, the end of a request is detected by handle()
+     *
+     * @param controllers controllers to be mapped, addressed by their indices
+     * @param address slave address 1...247
+     * @param baud baud rate of the port, used for the silent interval
+     * @param port stream of the bus, started by the caller. Has to report its free transmit space via availableForWrite()
+     */
+    ModbusSlave(machineControllers_s controllers, uint8_t address, uint32_t baud, Stream *port);
+
+    /**
+     * @brief Constructor for a serial port, the end of a request is detected by the receive timeout of the UART
+     *
+     * @param controllers controllers to be mapped, addressed by their indices
+     * @param address slave address 1...247
+     * @param baud baud rate of the port, used for the silent interval
+     * @param port serial port of the bus, started by the caller before init()
+     */
+    ModbusSlave(machineControllers_s controllers, uint8_t address, uint32_t baud, HardwareSerial *port);
+
+    /**
+     * @brief Set up the receive timeout of the serial port, if any
+     *
+     */
+    void init();
+
+    /**
+     * @brief Receive, answer and send without blocking, call repeatedly
+     *
+     */
+    void handle();
+
+    /**
+     * @brief Check whether all controllers fit into the register map
+     *
+     * @return true ready
+     * @return false more controllers than MODBUS_MAX_BLOCKS or more than 16 of one kind
+     */
+    bool isReady();
+
+    // Getter-method
+    uint32_t getRequests();
+
+    // Getter-method
+    uint32_t getCrcErrors();
+};
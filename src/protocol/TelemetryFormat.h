@@ -0,0 +1,65 @@
+#pragma once
+
+// Related
+// System / External
+#include <stdint.h>
+// Selfmade
+// Project
+
+/**
+ * Telemetry frames are COBS encoded and start and end with a zero byte, like the acks of CommandProtocol. Decoders skip the empty chunks
+ * between two delimiters. Decoded, all values little endian:
+ *
+ *   header:   schema (u8) | steppers (u8) | heaters (u8) | motors (u8) | sequence (u16) | flags (u8)
+ *   time:     millis() as varint, absolute in keyframes, otherwise the difference to the previous frame
+ *   channels: zigzag varints of every controller of the groups flagged in the frame, in the order of the channel enums
+ *   crc:      CRC-16/CCITT-FALSE of header, time and channels (u16)
+ *
+ * Keyframes carry absolute values of all groups, the other frames the difference to the value in the previous frame containing the
+ * group. After a lost frame, a decoder has to wait for the next keyframe.
+ */
+
+const uint8_t TELEMETRY_SCHEMA = 1;            // Layout of the frames, changes whenever the channels change
+const uint8_t TELEMETRY_HEADER_SIZE = 7;       // Bytes of the header
+const int32_t TELEMETRY_NO_VALUE = INT32_MIN;  // Channel value without a measurement, e.g. a disconnected thermocouple
+
+enum telemetryFlag_e {
+    TELEMETRY_KEYFRAME = 0x01,  // Frame carries absolute values
+    TELEMETRY_STEPPERS = 0x02,  // Frame contains the stepper channels
+    TELEMETRY_HEATERS = 0x04,   // Frame contains the heater channels
+    TELEMETRY_MOTORS = 0x08     // Frame contains the DC motor channels
+};
+
+/**
+ * @brief Channels of each stepper
+ */
+enum telemetryStepperChannel_e {
+    TELEMETRY_STEPPER_RPM,       // Speed in 0.01 rpm
+    TELEMETRY_STEPPER_LOAD,      // Load in %
+    TELEMETRY_STEPPER_POSITION,  // Position in mm
+    TELEMETRY_STEPPER_CURRENT,   // Current scale 0...31
+    TELEMETRY_STEPPER_ERRORS,    // Error bits: overheating, shutdown heat, short circuit, open load, stall (bit 0...4)
+    TELEMETRY_STEPPER_DIAMETER,  // Estimated winding diameter in 0.1 mm, 0 = not estimated
+    TELEMETRY_STEPPER_MODE,      // Current stepperMode_e
+    TELEMETRY_STEPPER_CHANNELS   // Number of channels, not a channel
+};
+
+/**
+ * @brief Channels of each heater
+ */
+enum telemetryHeaterChannel_e {
+    TELEMETRY_HEATER_TEMPERATURE,  // Measured temperature in 0.01 degree celsius
+    TELEMETRY_HEATER_TARGET,       // Target temperature in 0.01 degree celsius
+    TELEMETRY_HEATER_PID,          // Heating time per activation cycle in ms
+    TELEMETRY_HEATER_HEATING,      // 1 while the heating element is switched on
+    TELEMETRY_HEATER_CHANNELS      // Number of channels, not a channel
+};
+
+/**
+ * @brief Channels of each DC motor
+ */
+enum telemetryMotorChannel_e {
+    TELEMETRY_MOTOR_RPM,       // Speed in 0.01 rpm
+    TELEMETRY_MOTOR_POSITION,  // Position in encoder ticks
+    TELEMETRY_MOTOR_CHANNELS   // Number of channels, not a channel
+};
@@ -0,0 +1,153 @@
+// Related
+#include "TelemetryPublisher.h"
+// System / External
+#include <Arduino.h>
+#include <math.h>
+// Selfmade
+// Project
+#include "../utils/SerialClaim.h"
+#include "../utils/Utils.h"
+
+static const uint8_t GROUP_FLAGS[TELEMETRY_GROUPS] = {TELEMETRY_STEPPERS, TELEMETRY_HEATERS, TELEMETRY_MOTORS};
+
+TelemetryPublisher::TelemetryPublisher(machineControllers_s controllers) { _controllers = controllers; }
+
+void TelemetryPublisher::init() {}
+
+bool TelemetryPublisher::isReady() { return true; }
+
+bool TelemetryPublisher::start(uint16_t stepperPeriodMs, uint16_t heaterPeriodMs, uint16_t motorPeriodMs) {
+    uint16_t channels = _controllers.stepperCount * TELEMETRY_STEPPER_CHANNELS + _controllers.heaterCount * TELEMETRY_HEATER_CHANNELS +
+                        _controllers.motorCount * TELEMETRY_MOTOR_CHANNELS;
+    if (channels > TELEMETRY_MAX_CHANNELS) {
+        logPrint(_logging, ERROR, "{telemetry: {event: 'rejected', channels: %u, max: %u}}\n", channels, TELEMETRY_MAX_CHANNELS);
+        return false;
+    }
+
+    _periodsMs[TELEMETRY_GROUP_STEPPERS] = _controllers.stepperCount > 0 ? stepperPeriodMs : 0;
+    _periodsMs[TELEMETRY_GROUP_HEATERS] = _controllers.heaterCount > 0 ? heaterPeriodMs : 0;
+    _periodsMs[TELEMETRY_GROUP_MOTORS] = _controllers.motorCount > 0 ? motorPeriodMs : 0;
+    unsigned long now = millis();
+    for (uint8_t group = 0; group < TELEMETRY_GROUPS; ++group) _nextSampleMs[group] = now;
+    _framesUntilKeyframe = 0;
+    _dropped = 0;
+    _active = true;
+    return true;
+}
+
+void TelemetryPublisher::stop() { _active = false; }
+
+void TelemetryPublisher::handle() {
+    PROFILE_HANDLE();
+    transmit();
+    if (!_active) return;
+
+    // Groups due for a sample
+    unsigned long now = millis();
+    uint8_t flags = 0;
+    for (uint8_t group = 0; group < TELEMETRY_GROUPS; ++group) {
+        if (_periodsMs[group] == 0 || (long)(now - _nextSampleMs[group]) < 0) continue;
+        flags |= GROUP_FLAGS[group];
+        _nextSampleMs[group] += _periodsMs[group];
+        if ((long)(now - _nextSampleMs[group]) >= 0) _nextSampleMs[group] = now + _periodsMs[group];  // Fell behind, resynchronise
+    }
+    if (flags == 0) return;
+
+    // Previous frame still being sent, the differences stay relative to what was actually sent
+    if (_txLength > 0) {
+        _dropped++;
+        return;
+    }
+
+    if (_framesUntilKeyframe == 0) {
+        flags = TELEMETRY_KEYFRAME;
+        for (uint8_t group = 0; group < TELEMETRY_GROUPS; ++group) {
+            if (_periodsMs[group] > 0) flags |= GROUP_FLAGS[group];
+        }
+    }
+    buildFrame(flags, now);
+    transmit();
+}
+
+void TelemetryPublisher::buildFrame(uint8_t flags, uint32_t nowMs) {
+    bool keyframe = flags & TELEMETRY_KEYFRAME;
+    uint16_t length = 0;
+    _frame[length++] = TELEMETRY_SCHEMA;
+    _frame[length++] = _controllers.stepperCount;
+    _frame[length++] = _controllers.heaterCount;
+    _frame[length++] = _controllers.motorCount;
+    _frame[length++] = _sequence & 0xFF;
+    _frame[length++] = _sequence >> 8;
+    _frame[length++] = flags;
+    length += varintEncode(keyframe ? nowMs : nowMs - _lastTimeMs, _frame + length);
+    _lastTimeMs = nowMs;
+
+    // Channels are numbered over all controllers, whether their group is in the frame or not
+    uint8_t channel = 0;
+    for (uint8_t i = 0; i < _controllers.stepperCount; ++i, channel += TELEMETRY_STEPPER_CHANNELS) {
+        if (!(flags & TELEMETRY_STEPPERS)) continue;
+        Stepper *stepper = _controllers.steppers[i];
+        stepperStatus_s status = stepper->getStatus();
+        uint8_t errors = status.errorOverheating | status.errorShutdownHeat << 1 | status.errorShutdownShortCircuit << 2 |
+                         status.errorOpenLoad << 3 | status.errorStall << 4;
+        appendValue(length, channel + TELEMETRY_STEPPER_RPM, lroundf(status.rpm * 100), keyframe);
+        appendValue(length, channel + TELEMETRY_STEPPER_LOAD, status.load, keyframe);
+        appendValue(length, channel + TELEMETRY_STEPPER_POSITION, status.position, keyframe);
+        appendValue(length, channel + TELEMETRY_STEPPER_CURRENT, status.currentScale, keyframe);
+        appendValue(length, channel + TELEMETRY_STEPPER_ERRORS, errors, keyframe);
+        appendValue(length, channel + TELEMETRY_STEPPER_DIAMETER, lroundf(status.diameter * 10), keyframe);
+        appendValue(length, channel + TELEMETRY_STEPPER_MODE, stepper->getCurrentMode(), keyframe);
+    }
+    for (uint8_t i = 0; i < _controllers.heaterCount; ++i, channel += TELEMETRY_HEATER_CHANNELS) {
+        if (!(flags & TELEMETRY_HEATERS)) continue;
+        HeatController *heater = _controllers.heaters[i];
+        float temperature = heater->getCurrentTemperature();
+        appendValue(length, channel + TELEMETRY_HEATER_TEMPERATURE, isnan(temperature) ? TELEMETRY_NO_VALUE : lroundf(temperature * 100),
+                    keyframe);
+        appendValue(length, channel + TELEMETRY_HEATER_TARGET, lroundf(heater->getTargetTemperature() * 100), keyframe);
+        appendValue(length, channel + TELEMETRY_HEATER_PID, lroundf(heater->getPidValue()), keyframe);
+        appendValue(length, channel + TELEMETRY_HEATER_HEATING, heater->isHeating(), keyframe);
+    }
+    for (uint8_t i = 0; i < _controllers.motorCount; ++i, channel += TELEMETRY_MOTOR_CHANNELS) {
+        if (!(flags & TELEMETRY_MOTORS)) continue;
+        DcMotor *motor = _controllers.motors[i];
+        appendValue(length, channel + TELEMETRY_MOTOR_RPM, lroundf(motor->getCurrentSpeed() * 100), keyframe);
+        appendValue(length, channel + TELEMETRY_MOTOR_POSITION, motor->getPosition(), keyframe);
+    }
+
+    uint16_t crc = crc16Ccitt(_frame, length);
+    _frame[length++] = crc & 0xFF;
+    _frame[length++] = crc >> 8;
+
+    // Leading delimiter, so text output that slipped in before ends there instead of corrupting the frame
+    _tx[0] = 0;
+    _txLength = 1 + cobsEncode(_frame, length, _tx + 1);
+    _tx[_txLength++] = 0;
+    _txCursor = 0;
+    _sequence++;
+    _framesUntilKeyframe = keyframe ? TELEMETRY_KEYFRAME_INTERVAL - 1 : _framesUntilKeyframe - 1;
+}
+
+void TelemetryPublisher::appendValue(uint16_t &length, uint8_t channel, int32_t value, bool keyframe) {
+    // Differences wrap around like the values themselves, so every jump is representable
+    int32_t encoded = keyframe ? value : (int32_t)((uint32_t)value - (uint32_t)_lastValues[channel]);
+    length += varintEncode(zigzagEncode(encoded), _frame + length);
+    _lastValues[channel] = value;
+}
+
+void TelemetryPublisher::transmit() {
+    if (_txLength == 0 || !claimSerial(this)) return;
+    int available = Serial.availableForWrite();
+    if (available <= 0) return;
+
+    uint16_t chunk = min((uint16_t)available, (uint16_t)(_txLength - _txCursor));
+    _txCursor += Serial.write(_tx + _txCursor, chunk);
+    if (_txCursor >= _txLength) {
+        _txLength = 0;
+        releaseSerial(this);
+    }
+}
+
+bool TelemetryPublisher::isActive() { return _active; }
+
+uint32_t TelemetryPublisher::getDropped() { return _dropped; }
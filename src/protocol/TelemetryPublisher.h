@@ -0,0 +1,114 @@
+#pragma once
+
+// Related
+// System / External
+#include <stdint.h>
+// Selfmade
+// Project
+#include "../controller/BaseController.h"
+#include "../controller/MachineControllers.h"
+#include "TelemetryFormat.h"
+
+#ifndef TELEMETRY_MAX_CHANNELS
+#define TELEMETRY_MAX_CHANNELS 48  // Channels of all controllers together, can be overwritten via build flag
+#endif
+
+const uint16_t TELEMETRY_KEYFRAME_INTERVAL = 50;  // Frames from one keyframe to the next, limits the time to resynchronise
+const uint16_t TELEMETRY_FRAME_LENGTH = TELEMETRY_HEADER_SIZE + 5 * (TELEMETRY_MAX_CHANNELS + 1) + 2;  // Longest decoded frame
+
+/**
+ * @brief Groups of controllers that are sampled at their own rate
+ *
+ */
+enum telemetryGroup_e { TELEMETRY_GROUP_STEPPERS, TELEMETRY_GROUP_HEATERS, TELEMETRY_GROUP_MOTORS, TELEMETRY_GROUPS };
+
+/**
+ * @brief Streams the state of all machine controllers over Serial in compact binary frames, see TelemetryFormat.h
+ *
+ * Values are sent as differences to the previous frame, so unchanged channels only take one byte. At 100 Hz the three steppers of a
+ * winder take less than 4 kB/s, a third of 115200 baud. A frame is only built once the previous one is sent completely, samples due
+ * meanwhile are skipped and counted as dropped. Serial stays claimed while a frame is sent (see claimSerial()), so acks, streams and log
+ * output never end up in the middle of it.
+ */
+class TelemetryPublisher : public BaseController {
+   private:
+    machineControllers_s _controllers;                                       // Controllers to be sampled
+    bool _active = false;                                                    // Flag whether frames are published
+    uint16_t _periodsMs[TELEMETRY_GROUPS];                                   // Sampling interval of each group, 0 = not sampled
+    unsigned long _nextSampleMs[TELEMETRY_GROUPS];                           // millis() of the next sample of each group
+    int32_t _lastValues[TELEMETRY_MAX_CHANNELS];                             // Values of the frames sent so far, base of the differences
+    uint32_t _lastTimeMs = 0;                                                // millis() of the previous frame
+    uint16_t _sequence = 0;                                                  // Sequence number of the next frame
+    uint16_t _framesUntilKeyframe = 0;                                       // Frames until the next keyframe is due
+    uint32_t _dropped = 0;                                                   // Samples skipped as the previous frame was still sent
+    uint8_t _frame[TELEMETRY_FRAME_LENGTH];                                  // Decoded frame being built
+    uint8_t _tx[TELEMETRY_FRAME_LENGTH + TELEMETRY_FRAME_LENGTH / 254 + 3];  // Encoded frame between two delimiters being sent
+    uint16_t _txLength = 0;                                                  // Bytes of the encoded frame, 0 = nothing to send
+    uint16_t _txCursor = 0;                                                  // Bytes of the encoded frame already sent
+
+    /**
+     * @brief Sample the flagged groups and encode them as frame ready to be sent
+     *
+     * @param flags groups in the frame and whether it is a keyframe, see telemetryFlag_e
+     * @param nowMs current millis()
+     */
+    void buildFrame(uint8_t flags, uint32_t nowMs);
+
+    /**
+     * @brief Append a channel value to the frame, as difference to the previous value unless it is a keyframe
+     *
+     * @param length current size of the frame, increased by the appended bytes
+     * @param channel index of the channel over all controllers
+     * @param value current value
+     * @param keyframe true = append the absolute value
+     */
+    void appendValue(uint16_t &length, uint8_t channel, int32_t value, bool keyframe);
+
+    /**
+     * @brief Send as much of the pending frame as the Serial transmit buffer takes without blocking, waits while another writer holds
+     * Serial
+     *
+     */
+    void transmit();
+
+   public:
+    /**
+     * @brief Constructor
+     *
+     * @param controllers controllers to be sampled, the frames contain them in the order of their indices
+     */
+    TelemetryPublisher(machineControllers_s controllers);
+
+    void init();
+
+    /**
+     * @brief Sample due groups and send frames without blocking, call repeatedly
+     *
+     */
+    void handle();
+
+    bool isReady();
+
+    /**
+     * @brief Start publishing frames, beginning with a keyframe
+     *
+     * @param stepperPeriodMs sampling interval of the steppers, 0 = not sampled
+     * @param heaterPeriodMs sampling interval of the heaters, 0 = not sampled. Temperatures are measured every 250 ms
+     * @param motorPeriodMs sampling interval of the DC motors, 0 = not sampled
+     * @return true started
+     * @return false the controllers have more channels than TELEMETRY_MAX_CHANNELS
+     */
+    bool start(uint16_t stepperPeriodMs, uint16_t heaterPeriodMs = 250, uint16_t motorPeriodMs = 10);
+
+    /**
+     * @brief Stop publishing, a frame being sent is still completed
+     *
+     */
+    void stop();
+
+    // Getter-method
+    bool isActive();
+
+    // Getter-method, samples skipped as the previous frame was still sent
+    uint32_t getDropped();
+};
@@ -0,0 +1,71 @@
+// Related
+#include "AllocationGuard.h"
+// System / External
+#include <new>
+#include <stdlib.h>
+// Selfmade
+// Project
+
+#ifdef ALLOCATION_GUARD
+
+uint8_t AllocationGuard::_depth = 0;
+bool AllocationGuard::_trap = false;
+uint32_t AllocationGuard::_allocations = 0;
+size_t AllocationGuard::_bytes = 0;
+
+void AllocationGuard::enter() { _depth++; }
+
+void AllocationGuard::leave() { _depth--; }
+
+void AllocationGuard::onAllocation(size_t size) {
+    if (_depth == 0) return;
+    if (_trap) abort();
+    _allocations++;
+    _bytes += size;
+}
+
+void AllocationGuard::setTrap(bool trap) { _trap = trap; }
+
+void AllocationGuard::reset() {
+    _allocations = 0;
+    _bytes = 0;
+}
+
+uint32_t AllocationGuard::getAllocations() { return _allocations; }
+
+size_t AllocationGuard::getAllocatedBytes() { return _bytes; }
+
+AllocationGuardScope::AllocationGuardScope() { AllocationGuard::enter(); }
+
+AllocationGuardScope::~AllocationGuardScope() { AllocationGuard::leave(); }
+
+// Replaced global allocation functions, the default operator delete releases via free(). Out of memory operator new behaves like the
+// standard one: the new_handler is called until it frees memory, without one std::bad_alloc is thrown, or abort() is called if the
+// build has exceptions disabled. The nothrow versions return NULL right away
+void *operator new(size_t size) {
+    AllocationGuard::onAllocation(size);
+    void *pointer;
+    while ((pointer = malloc(size > 0 ? size : 1)) == NULL) {
+        std::new_handler handler = std::get_new_handler();
+        if (handler == NULL) {
+#if __cpp_exceptions
+            throw std::bad_alloc();
+#else
+            abort();
+#endif
+        }
+        handler();
+    }
+    return pointer;
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+    AllocationGuard::onAllocation(size);
+    return malloc(size > 0 ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &tag) noexcept { return operator new(size, tag); }
+
+#endif
@@ -0,0 +1,80 @@
+#pragma once
+
+// Related
+// System / External
+#include <stddef.h>
+#include <stdint.h>
+// Selfmade
+// Project
+
+/**
+ * @brief Counts heap allocations via operator new while a controller is inside handle(), only compiled with ALLOCATION_GUARD
+ *
+ * PROFILE_HANDLE() opens a guarded scope in every handle(), so allocations of the control loop show up in getAllocations() while
+ * allocations during setup are ignored. With setTrap(true) the first guarded allocation aborts with a backtrace instead. Allocations of
+ * other tasks while a handle() runs are counted as well, and plain malloc() calls are not seen.
+ */
+class AllocationGuard {
+   private:
+    static uint8_t _depth;         // Number of nested guarded scopes, allocations are counted while > 0
+    static bool _trap;             // Flag whether a guarded allocation aborts
+    static uint32_t _allocations;  // Guarded allocations since the last reset()
+    static size_t _bytes;          // Bytes of the guarded allocations since the last reset()
+
+   public:
+    /**
+     * @brief Start a guarded scope, use via AllocationGuardScope
+     *
+     */
+    static void enter();
+
+    /**
+     * @brief End a guarded scope, use via AllocationGuardScope
+     *
+     */
+    static void leave();
+
+    /**
+     * @brief Register an allocation, called by the replaced operator new
+     *
+     * @param size requested bytes
+     */
+    static void onAllocation(size_t size);
+
+    /**
+     * @brief Abort on the first guarded allocation instead of counting it
+     *
+     * @param trap true = abort, false = count only
+     */
+    static void setTrap(bool trap);
+
+    /**
+     * @brief Reset the counters, e.g. once setup is done
+     *
+     */
+    static void reset();
+
+    // Getter-method
+    static uint32_t getAllocations();
+
+    // Getter-method
+    static size_t getAllocatedBytes();
+};
+
+/**
+ * @brief Guards the lifetime of its scope, use via PROFILE_HANDLE()
+ *
+ */
+class AllocationGuardScope {
+   public:
+    AllocationGuardScope();
+    ~AllocationGuardScope();
+};
+
+// Place at the beginning of handle() to guard it against allocations, compiles to nothing unless ALLOCATION_GUARD is defined.
+// PROFILE_HANDLE() includes it
+#ifdef ALLOCATION_GUARD
+#define GUARD_HANDLE() AllocationGuardScope _allocationScope
+#else
+#define GUARD_HANDLE()
+#endif
@@ -0,0 +1,36 @@
+// Related
+#include "SerialClaim.h"
+// System / External
+#include <Arduino.h>
+// Selfmade
+// Project
+
+static const uint16_t SERIAL_RESERVATION_MS = 50;  // A refused writer keeps its place as long as it asks again within this time
+
+static const void *serialOwner = NULL;  // Writer in the middle of a frame, NULL = Serial is free
+static const void *serialNext = NULL;   // Writer refused while Serial was claimed, gets it next
+static unsigned long serialNextMs = 0;  // millis() serialNext asked last
+
+bool claimSerial(const void *owner) {
+    if (serialOwner == owner) return true;
+
+    // The first refused writer is next, so a writer sending frames back to back can not starve the others
+    unsigned long now = millis();
+    bool reserved = serialNext != NULL && serialNext != owner && now - serialNextMs < SERIAL_RESERVATION_MS;
+    if (serialOwner != NULL || reserved) {
+        if (!reserved) {
+            serialNext = owner;
+            serialNextMs = now;
+        }
+        return false;
+    }
+    serialOwner = owner;
+    if (serialNext == owner) serialNext = NULL;
+    return true;
+}
+
+void releaseSerial(const void *owner) {
+    if (serialOwner == owner) serialOwner = NULL;
+}
+
+bool isSerialClaimed() { return serialOwner != NULL; }
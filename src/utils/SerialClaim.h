@@ -0,0 +1,27 @@
+#pragma once
+
+// Related
+// System / External
+// Selfmade
+// Project
+
+/**
+ * @brief Claim Serial for a binary frame. A writer keeps the claim until the last byte of its frame is written, others wait meanwhile,
+ * so frames sent in chunks over several handle()-calls never interleave. The first refused writer gets Serial next, as long as it keeps
+ * asking. Only to be used from the loop, not from interrupts
+ *
+ * @param owner writer claiming Serial, e.g. its this pointer
+ * @return true claimed, or already claimed by owner
+ * @return false another writer is in the middle of a frame
+ */
+bool claimSerial(const void *owner);
+
+/**
+ * @brief Release Serial after the last byte of a frame, nothing happens if owner does not hold the claim
+ *
+ * @param owner writer that claimed Serial
+ */
+void releaseSerial(const void *owner);
+
+// Getter-method, flag whether a writer is in the middle of a frame
+bool isSerialClaimed();
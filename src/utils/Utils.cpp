@@ -0,0 +1,84 @@
+// Related
+#include "Utils.h"
+// System / External
+#include <stddef.h>
+#include <stdint.h>
+// Selfmade
+// Project
+
+uint16_t crc16Ccitt(const uint8_t *data, size_t length, uint16_t crc) {
+    for (size_t i = 0; i < length; ++i) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+uint16_t crc16Modbus(const uint8_t *data, size_t length) {
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < length; ++i) {
+        crc ^= data[i];
+        for (uint8_t bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x0001) ? (crc >> 1) ^ 0xA001 : crc >> 1;
+        }
+    }
+    return crc;
+}
+
+size_t cobsEncode(const uint8_t *data, size_t length, uint8_t *output) {
+    size_t codeIndex = 0;  // Position of the code byte of the current block
+    size_t write = 1;
+    uint8_t code = 1;
+    for (size_t i = 0; i < length; ++i) {
+        if (data[i] != 0) {
+            output[write++] = data[i];
+            code++;
+        }
+        // A zero or a full block of 254 bytes ends the block
+        if (data[i] == 0 || code == 0xFF) {
+            output[codeIndex] = code;
+            codeIndex = write++;
+            code = 1;
+        }
+    }
+    output[codeIndex] = code;
+    return write;
+}
+
+size_t cobsDecode(uint8_t *data, size_t length) {
+    size_t read = 0;
+    size_t write = 0;  // Never overtakes read, as every block loses its code byte
+    while (read < length) {
+        uint8_t code = data[read];
+        if (code == 0 || read + code > length) return 0;
+        read++;
+        for (uint8_t i = 1; i < code; ++i) data[write++] = data[read++];
+        if (code != 0xFF && read < length) data[write++] = 0;
+    }
+    return write;
+}
+
+uint32_t zigzagEncode(int32_t value) { return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31); }
+
+int32_t zigzagDecode(uint32_t code) { return (int32_t)(code >> 1) ^ -(int32_t)(code & 1); }
+
+size_t varintEncode(uint32_t value, uint8_t *output) {
+    size_t length = 0;
+    while (value >= 0x80) {
+        output[length++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    output[length++] = value;
+    return length;
+}
+
+size_t varintDecode(const uint8_t *data, size_t length, uint32_t &value) {
+    value = 0;
+    for (size_t i = 0; i < length && i < 5; ++i) {
+        value |= (uint32_t)(data[i] & 0x7F) << (7 * i);
+        if ((data[i] & 0x80) == 0) return i + 1;
+    }
+    return 0;
+}
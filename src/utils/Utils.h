@@ -0,0 +1,82 @@
+#pragma once
+
+// Related
+// System / External
+#include <stddef.h>
+#include <stdint.h>
+// Selfmade
+// Project
+
+/**
+ * @brief Calculate the CRC-16/CCITT-FALSE checksum (polynom 0x1021, start value 0xFFFF) of a memory area
+ *
+ * @param data memory area to be checked
+ * @param length size of the memory area in bytes
+ * @param crc start value, pass the result of a previous call to continue a calculation over multiple areas
+ * @return uint16_t checksum
+ */
+uint16_t crc16Ccitt(const uint8_t *data, size_t length, uint16_t crc = 0xFFFF);
+
+/**
+ * @brief Calculate the CRC-16/MODBUS checksum (reflected polynom 0xA001, start value 0xFFFF) of a memory area, sent low byte first
+ *
+ * @param data memory area to be checked
+ * @param length size of the memory area in bytes
+ * @return uint16_t checksum
+ */
+uint16_t crc16Modbus(const uint8_t *data, size_t length);
+
+/**
+ * @brief Encode a memory area with Consistent Overhead Byte Stuffing (COBS), so the result contains no zero bytes and a zero byte can
+ * delimit frames. The delimiter itself is not written
+ *
+ * @param data memory area to be encoded
+ * @param length size of the memory area in bytes
+ * @param output encoded data, has to hold length + length / 254 + 1 bytes, must not overlap data
+ * @return size_t size of the encoded data in bytes
+ */
+size_t cobsEncode(const uint8_t *data, size_t length, uint8_t *output);
+
+/**
+ * @brief Decode COBS encoded data in place, the decoded data is never longer than the encoded one
+ *
+ * @param data encoded data without the delimiter, overwritten with the decoded data
+ * @param length size of the encoded data in bytes
+ * @return size_t size of the decoded data in bytes, 0 if the data is no valid COBS encoding
+ */
+size_t cobsDecode(uint8_t *data, size_t length);
+
+/**
+ * @brief Map signed to unsigned values so small magnitudes of both signs get small codes (0, -1, 1, -2 ... to 0, 1, 2, 3 ...)
+ *
+ * @param value signed value
+ * @return uint32_t zigzag code
+ */
+uint32_t zigzagEncode(int32_t value);
+
+/**
+ * @brief Reverse zigzagEncode()
+ *
+ * @param code zigzag code
+ * @return int32_t signed value
+ */
+int32_t zigzagDecode(uint32_t code);
+
+/**
+ * @brief Write a value as LEB128 varint, 7 bits per byte with the highest bit set on all but the last byte
+ *
+ * @param value value to be written
+ * @param output memory location to write to, has to hold up to 5 bytes
+ * @return size_t number of bytes written
+ */
+size_t varintEncode(uint32_t value, uint8_t *output);
+
+/**
+ * @brief Read a varint written by varintEncode()
+ *
+ * @param data memory area to read from
+ * @param length size of the memory area in bytes
+ * @param value read value
+ * @return size_t number of bytes read, 0 if the varint is truncated or too long
+ */
+size_t varintDecode(const uint8_t *data, size_t length, uint32_t &value);
@@ -32,3 +32,15 @@ class McValidatorEsp32 : public virtual McValidator {
     // inherit function overload from base class isDigitalPin(uint8_t pins[], uint16_t pinsLength)
     using McValidator::isDigitalPin;
 };
+
+/**
+ * @brief Compile-time variant of McValidatorEsp32::isDigitalPin(), usable in static_assert
+ *
+ * @param pin Pin-number
+ * @return true pin is a valid digital pin
+ * @return false pin does not exist or is reserved
+ */
+constexpr bool isEsp32DigitalPin(uint8_t pin) {
+    return pin == 18 || pin == 19 || pin == 23 || pin == 5 || pin == 13 || pin == 12 || pin == 14 || pin == 27 || pin == 16 || pin == 17 ||
+           pin == 25 || pin == 26;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+// Minimal checks and helpers shared by the host tests and benchmarks. A failed check prints its location, the test keeps running and
+// returns 1 from main() via TEST_RESULT()
+
+// Related
+// System / External
+#include <HostSim.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <time.h>
+// Selfmade
+// Project
+
+static int hostTestFailures __attribute__((unused)) = 0;  // Failed checks of the running test binary
+
+#define CHECK(condition)                                                       \
+    do {                                                                       \
+        if (!(condition)) {                                                    \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            hostTestFailures++;                                                \
+        }                                                                      \
+    } while (0)
+
+#define CHECK_NEAR(actual, expected, tolerance)                                                                               \
+    do {                                                                                                                      \
+        double checkActual = (actual), checkExpected = (expected);                                                            \
+        if (checkActual < checkExpected - (tolerance) || checkActual > checkExpected + (tolerance)) {                         \
+            printf("%s:%d: CHECK_NEAR(%s) failed, %g is not %g +- %g\n", __FILE__, __LINE__, #actual, checkActual, checkExpected, \
+                   (double)(tolerance));                                                                                      \
+            hostTestFailures++;                                                                                               \
+        }                                                                                                                     \
+    } while (0)
+
+#define TEST_RESULT()                                                                    \
+    (printf("%s: %s\n", __FILE__, hostTestFailures == 0 ? "passed" : "FAILED"), hostTestFailures == 0 ? 0 : 1)
+
+/**
+ * @brief Real time for benchmarks, unlike micros() which returns the simulated time
+ *
+ * @return uint64_t monotonic time in ns
+ */
+static inline uint64_t hostNowNs() {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+/**
+ * @brief Open a pty in raw mode, e.g. to attach a serial port of the stubs to the slave side
+ *
+ * @param master memory location to write the file descriptor of the master side to
+ * @param slave memory location to write the file descriptor of the slave side to
+ * @return true opened
+ * @return false no pty available
+ */
+static inline bool openPty(int &master, int &slave) {
+    master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) return false;
+    slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+    if (slave < 0) return false;
+
+    termios attributes;
+    tcgetattr(slave, &attributes);
+    cfmakeraw(&attributes);
+    tcsetattr(slave, TCSANOW, &attributes);
+    fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+    fcntl(slave, F_SETFL, fcntl(slave, F_GETFL) | O_NONBLOCK);
+    return true;
+}
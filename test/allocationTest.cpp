@@ -0,0 +1,189 @@
+/**
+ * @brief Host test that the control loop does not allocate, run via "make -C test"
+ *
+ * Built against a library compiled with ALLOCATION_GUARD, so every handle() is a guarded scope like in a firmware built with the flag.
+ * The controllers of main.cpp run through every recipe mode while commands arrive via the command protocol and telemetry is sent. Any
+ * allocation inside a handle() counts, allocations of the setup and of the commands given between the cycles are ignored.
+ */
+
+// Related
+// System / External
+#include <Arduino.h>
+#include <FastAccelStepper.h>
+#include <HostSim.h>
+#include <string.h>
+// Selfmade
+// Project
+#include "../src/controller/ControllerRegistry.h"
+#include "../src/controller/stepper/Stepper.h"
+#include "../src/program/MachineProgram.h"
+#include "../src/protocol/CommandProtocol.h"
+#include "../src/protocol/TelemetryPublisher.h"
+#include "../src/utils/AllocationGuard.h"
+#include "../src/utils/Utils.h"
+#include "HostTest.h"
+
+#ifndef ALLOCATION_GUARD
+#error "allocationTest has to be built with ALLOCATION_GUARD, see the Makefile"
+#endif
+
+const uint32_t HANDLE_PERIOD_US = 10000;  // Simulated time between two cycles
+const uint16_t MODE_CYCLES = 500;         // Cycles per recipe mode, 5 s of simulated time
+const uint8_t COMMAND_INTERVAL = 50;      // Cycles between two speed commands via the protocol
+const uint8_t SPOOL_CS_PIN = 5;           // Chip select of the spool
+const uint8_t FERRARI_CS_PIN = 13;        // Chip select of the ferrari
+const uint8_t PULLER_CS_PIN = 2;          // Chip select of the puller
+const uint8_t FERRARI_INDEX = 1;          // Index of the ferrari in the controllers, as addressed by the protocol
+const uint32_t STATUS_IDLE = 600;         // DRV_STATUS with a StallGuard value of light load
+const uint32_t STATUS_STALLED = 0;        // DRV_STATUS with a StallGuard value of full load
+
+stepperConfiguration_s spoolConfig = {.stepperId = "spool",
+                                      .maxCurrent = 700,
+                                      .microstepsPerStep = 32,
+                                      .stepsPerRotation = 200,
+                                      .mmPerRotation = 2800,
+                                      .gearRatio = 5.18,
+                                      .stall = 8,
+                                      .pins = {.en = 12, .dir = 16, .step = 26, .cs = SPOOL_CS_PIN, .diag = 0}};
+stepperConfiguration_s ferrariConfig = {.stepperId = "ferrari",
+                                        .maxCurrent = 700,
+                                        .microstepsPerStep = 32,
+                                        .stepsPerRotation = 200,
+                                        .mmPerRotation = 8,
+                                        .gearRatio = 1,
+                                        .stall = 5,
+                                        .pins = {.en = 12, .dir = 14, .step = 17, .cs = FERRARI_CS_PIN, .diag = 0}};
+stepperConfiguration_s pullerConfig = {.stepperId = "puller",
+                                       .maxCurrent = 700,
+                                       .microstepsPerStep = 32,
+                                       .stepsPerRotation = 200,
+                                       .mmPerRotation = 10,
+                                       .gearRatio = 1,
+                                       .stall = 8,
+                                       .pins = {.en = 12, .dir = 27, .step = 25, .cs = PULLER_CS_PIN, .diag = 0}};
+
+/**
+ * @brief Pass a frame with a speed command for the ferrari to the protocol, as if the host had sent it
+ *
+ * @param sequence sequence number of the frame
+ * @param rpm new speed
+ */
+static void injectSpeed(uint8_t sequence, float rpm) {
+    uint8_t frame[9] = {sequence, CMD_SPEED, FERRARI_INDEX};
+    memcpy(frame + 3, &rpm, sizeof(rpm));
+    uint16_t crc = crc16Ccitt(frame, 7);
+    frame[7] = crc & 0xFF;
+    frame[8] = crc >> 8;
+
+    uint8_t encoded[sizeof(frame) + 2];
+    size_t length = cobsEncode(frame, sizeof(frame), encoded);
+    encoded[length++] = 0;
+    Serial.hostInject(encoded, length);
+}
+
+int main() {
+    // Sanity check of the guard itself, otherwise the test below would pass without counting anything
+    AllocationGuard::reset();
+    {
+        AllocationGuardScope scope;
+        int *volatile allocated = new int;
+        delete allocated;
+    }
+    CHECK(AllocationGuard::getAllocations() == 1);
+
+    HostSim::reset();
+    HostSim::setDrvStatus(SPOOL_CS_PIN, STATUS_IDLE);
+    HostSim::setDrvStatus(FERRARI_CS_PIN, STATUS_IDLE);
+    HostSim::setDrvStatus(PULLER_CS_PIN, STATUS_IDLE);
+    Serial.begin(115200);
+    FastAccelStepperEngine engine;
+    Stepper spool(spoolConfig, &engine);
+    Stepper ferrari(ferrariConfig, &engine);
+    Stepper puller(pullerConfig, &engine);
+    TmcBusScheduler bus;
+    Stepper *steppers[] = {&spool, &ferrari, &puller};
+    machineControllers_s controllers = {.steppers = steppers, .stepperCount = 3, .heaters = NULL, .heaterCount = 0, .motors = NULL,
+                                        .motorCount = 0};
+    MachineProgram program(controllers);
+    TelemetryPublisher telemetry(controllers);
+    CommandProtocol protocol(controllers);
+    auto machine = makeControllerRegistry(protocol, program, puller, spool, ferrari, telemetry);
+    engine.init();
+    spool.setBusScheduler(&bus);
+    puller.setBusScheduler(&bus);
+    ferrari.setBusScheduler(&bus);
+    machine.init();
+    CHECK(telemetry.start(20));
+    puller.moveRotate(30);
+    AllocationGuard::reset();  // Like main.cpp, only the control loop is guarded
+
+    // Home the ferrari by reporting a stalled motor while it approaches, the modes after it need a homed stepper
+    ferrari.moveHome(60);
+    for (uint16_t i = 0; i < 1000 && !ferrari.isHomed(); ++i) {
+        HostSim::setDrvStatus(FERRARI_CS_PIN, i > 10 && ferrari.getCurrentMode() == HOMING ? STATUS_STALLED : STATUS_IDLE);
+        machine.handle();
+        bus.handle();
+        HostSim::advanceUs(HANDLE_PERIOD_US);
+    }
+    HostSim::setDrvStatus(FERRARI_CS_PIN, STATUS_IDLE);
+    CHECK(ferrari.isHomed());
+    CHECK(AllocationGuard::getAllocations() == 0);
+
+    uint8_t sequence = 0;
+    for (uint8_t mode = 0; mode < 9; ++mode) {
+        const char *name = "";
+        switch (mode) {
+            case 0:
+                name = "ROTATING";
+                ferrari.moveRotate(60);
+                break;
+            case 1:
+                name = "ADJUSTING";
+                ferrari.moveRotateWithLoadAdjust(60, 30);
+                break;
+            case 2:
+                name = "POSITIONING";
+                ferrari.movePosition(60, 40);
+                break;
+            case 3:
+                name = "OSCILLATING";
+                ferrari.moveOscillate(120, 10, 30);
+                break;
+            case 4:
+                name = "FOLLOWING";
+                ferrari.moveFollow(&puller, 0.5, 30);
+                break;
+            case 5:
+                name = "WINDING";
+                ferrari.moveWind(&puller, 1.75, 10, 30);
+                break;
+            case 6:
+                name = "PATH";
+                break;
+            case 7:
+                name = "STANDBY";
+                ferrari.switchModeStandby();
+                break;
+            default:
+                name = "OFF";
+                ferrari.switchModeOff();
+                break;
+        }
+
+        bool pathHigh = true;
+        for (uint16_t i = 0; i < MODE_CYCLES; ++i) {
+            // Keep the path going with a zigzag of short segments
+            while (mode == 6 && ferrari.addWaypoint(pathHigh ? 22 : 20, 120)) pathHigh = !pathHigh;
+            if (i % COMMAND_INTERVAL == 0 && mode < 2) injectSpeed(sequence++, 40 + i % 40);
+            machine.handle();
+            bus.handle();
+            HostSim::advanceUs(HANDLE_PERIOD_US);
+        }
+        printf("%s: %u allocations (%u bytes)\n", name, AllocationGuard::getAllocations(), (unsigned)AllocationGuard::getAllocatedBytes());
+        CHECK(AllocationGuard::getAllocations() == 0);
+        AllocationGuard::reset();
+    }
+    CHECK(protocol.getCounters().frames == sequence);
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,376 @@
+/**
+ * @brief Host benchmark of the hot paths of the library, run via "make -C test bench"
+ *
+ * Every result is one JSON object per line, so runs can be compared by scripts:
+ *   {"bench":"<name>","ns_per_op":...} for the conversion kernels
+ *   {"bench":"handle","mode":"<mode>","calls":...,"ns_mean":...,"ns_p50":...,"ns_p99":...,"ns_max":...} per recipe mode
+ *   {"bench":"path","segment_mm":...,"segments":...,"seconds":...,"mm_per_s":...,"drained":...} per segment length, drained > 1 means
+ *   the queue ran dry before the end of the path
+ *   {"bench":"dispatch","controllers":"<kind>","count":...,"registry_ns":...,"virtual_ns":...} per cycle over all controllers, once
+ *   through ControllerRegistry and once through BaseController pointers like before the registry
+ *   {"bench":"footprint","stepper":...,"configured_stepper":...,"driver":...,...} bytes per Stepper instance, per ConfiguredStepper
+ *   instance and per component. Pointers take 8 bytes on a 64 bit host instead of 4 on the ESP32, so only compare runs of the same host
+ *   {"bench":"configured","mode":"<mode>","stepper_ns_mean":...,"configured_ns_mean":...,"stepper_ns_p50":...,"configured_ns_p50":...}
+ *   per recipe mode, the same run once with a Stepper and once with a ConfiguredStepper of the same configuration
+ *
+ * Times are real host time. Between two handle() calls 10 ms of simulated time pass, like in the loop of main.cpp, so the stepper
+ * sees realistic positions and speeds from the FastAccelStepper stub.
+ */
+
+// Related
+// System / External
+#include <Arduino.h>
+#include <FastAccelStepper.h>
+#include <HostSim.h>
+#include <stdio.h>
+
+#include <algorithm>
+// Selfmade
+// Project
+#include "../src/controller/ControllerRegistry.h"
+#include "../src/controller/stepper/ConfiguredStepper.h"
+#include "../src/controller/stepper/Stepper.h"
+#include "../src/controller/stepper/StepperTest.h"
+#include "HostTest.h"
+
+const uint32_t KERNEL_ITERATIONS = 1000000;  // Calls per kernel benchmark
+const uint16_t HANDLE_CALLS = 2000;          // handle()-calls per recipe mode, 20 s of simulated time
+const uint32_t HANDLE_PERIOD_US = 10000;     // Simulated time between two handle()-calls
+const uint8_t CS_PIN = 13;                   // Chip select of the benchmarked stepper
+const uint8_t MASTER_CS_PIN = 2;             // Chip select of the master of FOLLOWING and WINDING
+const uint32_t STATUS_IDLE = 600;            // DRV_STATUS with a StallGuard value of light load
+const uint32_t STATUS_STALLED = 0;           // DRV_STATUS with a StallGuard value of full load
+const uint16_t PATH_SEGMENTS = 400;          // Segments of the path benchmark
+const float PATH_RPM = 120;                  // Speed limit of the path benchmark
+const uint16_t PATH_ACCELERATION = 60000;    // Acceleration of the path benchmark, high enough that short segments go fast
+const uint32_t DISPATCH_CYCLES = 1000000;    // Cycles per dispatch benchmark
+
+// Configuration of the benchmarked stepper, fixed at compile time for ConfiguredStepper
+struct BenchConfig {
+    static constexpr stepperConfiguration_s configuration() {
+        return {.stepperId = "bench",
+                .maxCurrent = 700,
+                .microstepsPerStep = 32,
+                .stepsPerRotation = 200,
+                .mmPerRotation = 8,
+                .gearRatio = 1,
+                .stall = 5,
+                .pins = {.en = 12, .dir = 14, .step = 17, .cs = CS_PIN, .diag = 0}};
+    }
+};
+stepperConfiguration_s benchConfig = BenchConfig::configuration();
+stepperConfiguration_s masterConfig = {.stepperId = "master",
+                                       .maxCurrent = 700,
+                                       .microstepsPerStep = 32,
+                                       .stepsPerRotation = 200,
+                                       .mmPerRotation = 2800,
+                                       .gearRatio = 5.18,
+                                       .stall = 8,
+                                       .pins = {.en = 12, .dir = 16, .step = 26, .cs = MASTER_CS_PIN, .diag = 0}};
+
+volatile uint32_t sink;  // Keeps the compiler from dropping the benchmarked calls
+
+/**
+ * @brief Controller doing next to nothing in handle(), so the dispatch benchmark measures the calls themselves
+ *
+ */
+class CountingController : public BaseController {
+   public:
+    uint32_t calls = 0;  // handle()-calls so far
+
+    void init() override {}
+
+    void handle() override { calls++; }
+
+    bool isReady() override { return true; }
+};
+
+/**
+ * @brief Stepper with its configuration passed at runtime, constructed like ConfiguredStepper for measureHandle()
+ *
+ */
+class RuntimeBenchStepper : public Stepper {
+   public:
+    RuntimeBenchStepper(FastAccelStepperEngine *engine) : Stepper(benchConfig, engine) {}
+};
+
+/**
+ * @brief Print the result of a kernel benchmark
+ *
+ * @param name name of the benchmark
+ * @param startNs hostNowNs() before the loop
+ */
+void printKernel(const char *name, uint64_t startNs) {
+    printf("{\"bench\":\"%s\",\"ns_per_op\":%.2f}\n", name, (double)(hostNowNs() - startNs) / KERNEL_ITERATIONS);
+}
+
+void benchKernels() {
+    uint64_t start = hostNowNs();
+    for (uint32_t i = 0; i < KERNEL_ITERATIONS; ++i) sink = indexOfClosestNumberInSortedArray(80 + i % 3600, speeds, 40);
+    printKernel("indexOfClosestNumberInSortedArray", start);
+
+    start = hostNowNs();
+    for (uint32_t i = 0; i < KERNEL_ITERATIONS; ++i) sink = stallToLoadPercent(80 + i % 3600, i % 1024, speeds, minLoad, maxLoad, 40);
+    printKernel("stallToLoadPercent", start);
+
+    start = hostNowNs();
+    for (uint32_t i = 0; i < KERNEL_ITERATIONS; ++i) sink = speedUsToRpm(50 + i % 5000, 6400);
+    printKernel("speedUsToRpm", start);
+
+    start = hostNowNs();
+    for (uint32_t i = 0; i < KERNEL_ITERATIONS; ++i) sink = speedRpmToUs(1 + i % 300, 6400);
+    printKernel("speedRpmToUs", start);
+
+    start = hostNowNs();
+    for (uint32_t i = 0; i < KERNEL_ITERATIONS; ++i) sink = positionToMm(i, 6400, 8);
+    printKernel("positionToMm", start);
+
+    start = hostNowNs();
+    for (uint32_t i = 0; i < KERNEL_ITERATIONS; ++i) sink = mmToPosition(i % 1000, 6400, 8);
+    printKernel("mmToPosition", start);
+}
+
+/**
+ * @brief Run the cycles through BaseController pointers, not inlined so the compiler cannot resolve the virtual calls
+ *
+ * @param controllers controllers in the order they are called
+ * @param count number of controllers
+ * @return uint64_t real time taken in ns
+ */
+__attribute__((noinline, noclone)) uint64_t runVirtual(BaseController *const *controllers, uint8_t count) {
+    uint64_t start = hostNowNs();
+    for (uint32_t i = 0; i < DISPATCH_CYCLES; ++i) {
+        for (uint8_t c = 0; c < count; ++c) controllers[c]->handle();
+    }
+    return hostNowNs() - start;
+}
+
+/**
+ * @brief Run the cycles through a ControllerRegistry, not inlined like runVirtual()
+ *
+ * @param registry registry of the controllers
+ * @return uint64_t real time taken in ns
+ */
+template <class Registry>
+__attribute__((noinline, noclone)) uint64_t runRegistry(Registry &registry) {
+    uint64_t start = hostNowNs();
+    for (uint32_t i = 0; i < DISPATCH_CYCLES; ++i) registry.handle();
+    return hostNowNs() - start;
+}
+
+/**
+ * @brief Compare the cost of one cycle over four controllers through ControllerRegistry and through virtual calls, once for controllers
+ * without work and once for idle steppers, to put the difference in proportion to a real handle()
+ *
+ */
+void benchDispatch() {
+    CountingController counters[4];
+    BaseController *counterList[] = {&counters[0], &counters[1], &counters[2], &counters[3]};
+    auto counterRegistry = makeControllerRegistry(counters[0], counters[1], counters[2], counters[3]);
+    uint64_t registryNs = runRegistry(counterRegistry);
+    uint64_t virtualNs = runVirtual(counterList, 4);
+    sink = counters[0].calls;
+    printf("{\"bench\":\"dispatch\",\"controllers\":\"counter\",\"count\":4,\"registry_ns\":%.2f,\"virtual_ns\":%.2f}\n",
+           (double)registryNs / DISPATCH_CYCLES, (double)virtualNs / DISPATCH_CYCLES);
+
+    HostSim::reset();
+    HostSim::setDrvStatus(CS_PIN, STATUS_IDLE);
+    HostSim::setDrvStatus(MASTER_CS_PIN, STATUS_IDLE);
+    FastAccelStepperEngine engine;
+    Stepper first(benchConfig, &engine), second(masterConfig, &engine), third(benchConfig, &engine), fourth(masterConfig, &engine);
+    engine.init();
+    BaseController *stepperList[] = {&first, &second, &third, &fourth};
+    auto stepperRegistry = makeControllerRegistry(first, second, third, fourth);
+    stepperRegistry.init();
+    registryNs = runRegistry(stepperRegistry);
+    virtualNs = runVirtual(stepperList, 4);
+    printf("{\"bench\":\"dispatch\",\"controllers\":\"stepper\",\"count\":4,\"registry_ns\":%.2f,\"virtual_ns\":%.2f}\n",
+           (double)registryNs / DISPATCH_CYCLES, (double)virtualNs / DISPATCH_CYCLES);
+}
+
+/**
+ * @brief Print the RAM taken by a Stepper instance, a ConfiguredStepper instance and the components, the cycle time is covered by
+ * benchHandle()
+ *
+ */
+void benchFootprint() {
+    printf("{\"bench\":\"footprint\",\"stepper\":%zu,\"configured_stepper\":%zu,\"config\":%zu,\"units\":%zu,\"driver\":%zu,"
+           "\"motion\":%zu,\"gearing\":%zu,\"homing\":%zu,\"tuning\":%zu,\"diag\":%zu,\"stream\":%zu}\n",
+           sizeof(Stepper), sizeof(ConfiguredStepper<BenchConfig>), sizeof(stepperConfiguration_s), sizeof(RuntimeStepperUnits),
+           sizeof(TmcDriver), sizeof(StepperMotion), sizeof(StepperGearing), sizeof(StepperHoming), sizeof(StepperTuning),
+           sizeof(StepperDiag), sizeof(StepperStream));
+}
+
+/**
+ * @brief Call handle() of both steppers for a while without measuring, e.g. to finish homing
+ *
+ * @param stepper benchmarked stepper
+ * @param master master of the benchmarked stepper
+ * @param calls handle()-calls
+ */
+void run(Stepper &stepper, Stepper &master, uint16_t calls) {
+    for (uint16_t i = 0; i < calls; ++i) {
+        master.handle();
+        stepper.handle();
+        HostSim::advanceUs(HANDLE_PERIOD_US);
+    }
+}
+
+/**
+ * @brief Home a stepper by reporting a stalled motor until homing finished
+ *
+ */
+void home(Stepper &stepper, Stepper &master) {
+    stepper.moveHome(60);
+    HostSim::setDrvStatus(CS_PIN, STATUS_STALLED);
+    for (uint16_t i = 0; i < 1000 && !stepper.isHomed(); ++i) {
+        run(stepper, master, 1);
+        // Release the end stop while backing off, so the re-approach sees the bump again
+        HostSim::setDrvStatus(CS_PIN, stepper.getCurrentMode() == HOMING && !stepper.isHomed() ? STATUS_STALLED : STATUS_IDLE);
+    }
+    HostSim::setDrvStatus(CS_PIN, STATUS_IDLE);
+}
+
+/**
+ * @brief Measure handle() in one recipe mode
+ *
+ * @tparam BenchStepper Stepper or ConfiguredStepper<BenchConfig>, constructed from the engine only
+ * @param mode recipe mode, also used to start it
+ * @param samples memory location to write the sorted time of each of the HANDLE_CALLS calls in ns to
+ * @return uint64_t time of all calls in ns
+ */
+template <class BenchStepper>
+uint64_t measureHandle(stepperMode_e mode, uint32_t *samples) {
+    HostSim::reset();
+    HostSim::setDrvStatus(CS_PIN, STATUS_IDLE);
+    HostSim::setDrvStatus(MASTER_CS_PIN, STATUS_IDLE);
+    FastAccelStepperEngine engine;
+    BenchStepper stepper(&engine);
+    Stepper master(masterConfig, &engine);
+    engine.init();
+    master.init();
+    stepper.init();
+    master.moveRotate(30);
+    if (mode == POSITIONING || mode == OSCILLATING_FORWARD || mode == WINDING || mode == PATH) home(stepper, master);
+
+    switch (mode) {
+        case ROTATING:
+            stepper.moveRotate(60);
+            break;
+        case ADJUSTING:
+            stepper.moveRotateWithLoadAdjust(60, 30);
+            break;
+        case HOMING:
+            stepper.moveHome(60);  // Never bumps, so it keeps approaching
+            break;
+        case POSITIONING:
+            stepper.movePosition(60, 1000);
+            break;
+        case OSCILLATING_FORWARD:
+            stepper.moveOscillate(120, 10, 50);
+            break;
+        case FOLLOWING:
+            stepper.moveFollow(&master, 0.5, 30);
+            break;
+        case WINDING:
+            stepper.moveWind(&master, 1.75, 10, 50);
+            break;
+        case PATH:
+            stepper.addWaypoint(10, 120);
+            break;
+        case STANDBY:
+            stepper.switchModeStandby();
+            break;
+        default:
+            stepper.switchModeOff();
+            break;
+    }
+
+    uint64_t total = 0;
+    bool pathHigh = true;
+    for (uint16_t i = 0; i < HANDLE_CALLS; ++i) {
+        // Keep the path going with a zigzag of short segments
+        while (mode == PATH && stepper.addWaypoint(pathHigh ? 12 : 10, 120)) pathHigh = !pathHigh;
+        master.handle();
+        uint64_t start = hostNowNs();
+        stepper.handle();
+        samples[i] = hostNowNs() - start;
+        total += samples[i];
+        HostSim::advanceUs(HANDLE_PERIOD_US);
+    }
+
+    std::sort(samples, samples + HANDLE_CALLS);
+    return total;
+}
+
+/**
+ * @brief Measure handle() in one recipe mode and print the distribution, then compare it to a ConfiguredStepper
+ *
+ * @param name name of the mode
+ * @param mode recipe mode, also used to start it
+ */
+void benchHandle(const char *name, stepperMode_e mode) {
+    static uint32_t samples[HANDLE_CALLS];
+    uint64_t total = measureHandle<RuntimeBenchStepper>(mode, samples);
+    printf("{\"bench\":\"handle\",\"mode\":\"%s\",\"calls\":%u,\"ns_mean\":%.1f,\"ns_p50\":%u,\"ns_p99\":%u,\"ns_max\":%u}\n", name,
+           HANDLE_CALLS, (double)total / HANDLE_CALLS, samples[HANDLE_CALLS / 2], samples[HANDLE_CALLS * 99 / 100],
+           samples[HANDLE_CALLS - 1]);
+
+    uint32_t p50 = samples[HANDLE_CALLS / 2];
+    uint64_t configuredTotal = measureHandle<ConfiguredStepper<BenchConfig>>(mode, samples);
+    printf("{\"bench\":\"configured\",\"mode\":\"%s\",\"stepper_ns_mean\":%.1f,\"configured_ns_mean\":%.1f,\"stepper_ns_p50\":%u,"
+           "\"configured_ns_p50\":%u}\n",
+           name, (double)total / HANDLE_CALLS, (double)configuredTotal / HANDLE_CALLS, p50, samples[HANDLE_CALLS / 2]);
+}
+
+/**
+ * @brief Run a straight path of equal segments and print how fast and continuous it was travelled
+ *
+ * @param segmentMm length of every segment in mm
+ */
+void benchPath(float segmentMm) {
+    HostSim::reset();
+    HostSim::setDrvStatus(CS_PIN, STATUS_IDLE);
+    HostSim::setDrvStatus(MASTER_CS_PIN, STATUS_IDLE);
+    FastAccelStepperEngine engine;
+    Stepper stepper(benchConfig, &engine);
+    Stepper master(masterConfig, &engine);
+    engine.init();
+    stepper.init();
+    master.init();
+    home(stepper, master);
+    stepper.adjustAcceleration(PATH_ACCELERATION);
+    hostStepperStats_s before = engine.hostGetStepper(0)->hostGetStats();
+
+    // Waypoints are added as soon as there is space, like a supervisor streaming a path
+    uint64_t startUs = HostSim::getTimeUs();
+    uint16_t segments = 0;
+    while (segments < PATH_SEGMENTS || stepper.getCurrentMode() == PATH) {
+        while (segments < PATH_SEGMENTS && stepper.addWaypoint(10 + (segments + 1) * segmentMm, PATH_RPM)) segments++;
+        run(stepper, master, 1);
+    }
+    float seconds = (HostSim::getTimeUs() - startUs) / 1e6;
+
+    printf("{\"bench\":\"path\",\"segment_mm\":%.2f,\"segments\":%u,\"seconds\":%.2f,\"mm_per_s\":%.2f,\"drained\":%u}\n", segmentMm,
+           segments, seconds, segments * segmentMm / seconds, engine.hostGetStepper(0)->hostGetStats().drained - before.drained);
+}
+
+int main() {
+    benchKernels();
+    benchDispatch();
+    benchFootprint();
+    benchHandle("ROTATING", ROTATING);
+    benchHandle("ADJUSTING", ADJUSTING);
+    benchHandle("HOMING", HOMING);
+    benchHandle("POSITIONING", POSITIONING);
+    benchHandle("OSCILLATING", OSCILLATING_FORWARD);
+    benchHandle("FOLLOWING", FOLLOWING);
+    benchHandle("WINDING", WINDING);
+    benchHandle("PATH", PATH);
+    benchHandle("STANDBY", STANDBY);
+    benchHandle("OFF", OFF);
+    benchPath(0.05);
+    benchPath(0.2);
+    benchPath(1);
+    return 0;
+}
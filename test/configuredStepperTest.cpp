@@ -0,0 +1,139 @@
+/**
+ * @brief Host test of ConfiguredStepper, run via "make -C test"
+ *
+ * The conversions with the factors known at compile time have to match the ones of the instance bit by bit. A ConfiguredStepper and a
+ * Stepper with the same configuration run through the same commands side by side, their step generators and status have to agree
+ * after every cycle.
+ */
+
+// Related
+// System / External
+#include <Arduino.h>
+#include <FastAccelStepper.h>
+#include <HostSim.h>
+// Selfmade
+// Project
+#include "../src/controller/stepper/ConfiguredStepper.h"
+#include "../src/controller/stepper/Stepper.h"
+#include "HostTest.h"
+
+const uint32_t HANDLE_PERIOD_US = 10000;  // Simulated time between two handle()-calls
+const uint16_t PHASE_CALLS = 1000;        // handle()-calls per command, 10 s of simulated time
+const uint16_t HOMING_CALLS = 50;         // handle()-calls of the approach until the end stop is hit
+const uint8_t CS_PIN = 13;                // Chip select of both steppers, they see the same load
+const uint16_t ACCELERATION = 40000;      // Acceleration in steps/s², the gearing needs many steps per mm
+const uint32_t STATUS_IDLE = 600;         // DRV_STATUS with a StallGuard value of light load
+const uint32_t STATUS_STALLED = 0;        // DRV_STATUS with a StallGuard value of full load
+
+// Geared, so the microsteps per rotation are no power of two and the mm conversion is not exact
+struct GearedConfig {
+    static constexpr stepperConfiguration_s configuration() {
+        return {.stepperId = "geared",
+                .maxCurrent = 700,
+                .microstepsPerStep = 32,
+                .stepsPerRotation = 200,
+                .mmPerRotation = 7.3,
+                .gearRatio = 5.18,
+                .stall = 5,
+                .pins = {.en = 12, .dir = 14, .step = 17, .cs = CS_PIN, .diag = 0}};
+    }
+};
+
+/**
+ * @brief Check that the conversions with compile-time factors equal the ones with runtime factors
+ *
+ */
+static void checkUnits() {
+    RuntimeStepperUnits runtime(GearedConfig::configuration());
+    StepperUnits<ConfiguredUnitFactors<GearedConfig>> configured;
+    CHECK(configured.microstepsPerRotation() == runtime.microstepsPerRotation());
+    CHECK(configured.mmPerRotation() == runtime.mmPerRotation());
+
+    bool equal = true;
+    for (int32_t i = -5000; i <= 5000; i += 7) {
+        equal &= configured.usToRpm(i) == runtime.usToRpm(i);
+        equal &= configured.rpmToUs(i / 10.0) == runtime.rpmToUs(i / 10.0);
+        equal &= configured.rpmToStepsPerS(i / 10.0) == runtime.rpmToStepsPerS(i / 10.0);
+        equal &= configured.stepsPerSToRpm(i) == runtime.stepsPerSToRpm(i);
+        equal &= configured.stepsToMm(i * 100) == runtime.stepsToMm(i * 100);
+        equal &= configured.mmToSteps(i / 10.0) == runtime.mmToSteps(i / 10.0);
+    }
+    CHECK(equal);
+}
+
+/**
+ * @brief Call handle() of both steppers, reporting a stalled motor to both once the approach of homing has gone on for a while
+ *
+ * @param plain stepper with its configuration passed at runtime
+ * @param configured stepper with its configuration fixed at compile time
+ * @param calls handle()-calls
+ * @return true step generators and status agreed after every call
+ * @return false they differed
+ */
+static bool run(Stepper &plain, ConfiguredStepper<GearedConfig> &configured, uint16_t calls) {
+    static uint16_t homingCalls = 0;  // handle()-calls spent homing so far, kept across the phases
+    bool equal = true;
+    for (uint16_t i = 0; i < calls; ++i) {
+        homingCalls = plain.getCurrentMode() == HOMING ? homingCalls + 1 : 0;
+        HostSim::setDrvStatus(CS_PIN, homingCalls > HOMING_CALLS ? STATUS_STALLED : STATUS_IDLE);
+        plain.handle();
+        configured.handle();
+        HostSim::advanceUs(HANDLE_PERIOD_US);
+
+        stepperStatus_s plainStatus = plain.getStatus();
+        stepperStatus_s configuredStatus = configured.getStatus();
+        equal &= plain.getCurrentSteps() == configured.getCurrentSteps();
+        equal &= plain.getCurrentMode() == configured.getCurrentMode();
+        equal &= plainStatus.rpm == configuredStatus.rpm && plainStatus.position == configuredStatus.position;
+    }
+    return equal;
+}
+
+int main() {
+    checkUnits();
+
+    HostSim::reset();
+    HostSim::setDrvStatus(CS_PIN, STATUS_IDLE);
+    FastAccelStepperEngine engine;
+    Stepper plain(GearedConfig::configuration(), &engine);
+    ConfiguredStepper<GearedConfig> configured(&engine);
+    engine.init();
+    plain.init();
+    configured.init();
+    plain.adjustAcceleration(ACCELERATION);
+    configured.adjustAcceleration(ACCELERATION);
+    CHECK(configured.isReady());
+    CHECK(configured.getMicrostepsPerRotation() == plain.getMicrostepsPerRotation());
+
+    plain.movePosition(60, 20);
+    configured.movePosition(60, 20);
+    CHECK(run(plain, configured, PHASE_CALLS));
+    CHECK(configured.isHomed());
+    CHECK(configured.getCurrentMode() == STANDBY);
+
+    plain.moveOscillate(120, 10, 30);
+    configured.moveOscillate(120, 10, 30);
+    CHECK(run(plain, configured, PHASE_CALLS));
+    CHECK(configured.getMotion().getRecipeMoves() > 2);
+
+    bool pathHigh = true;
+    for (uint16_t i = 0; i < PHASE_CALLS; ++i) {
+        while (plain.addWaypoint(pathHigh ? 12.5 : 10, 90)) {
+            CHECK(configured.addWaypoint(pathHigh ? 12.5 : 10, 90));
+            pathHigh = !pathHigh;
+        }
+        CHECK(run(plain, configured, 1));
+    }
+    CHECK(configured.getCurrentMode() == PATH);
+
+    plain.moveRotate(-40);
+    configured.moveRotate(-40);
+    CHECK(run(plain, configured, PHASE_CALLS));
+    CHECK_NEAR(configured.getCurrentRpm(), -40, 0.5);
+
+    plain.switchModeOff();
+    configured.switchModeOff();
+    CHECK(run(plain, configured, PHASE_CALLS));
+    CHECK(configured.getCurrentMode() == OFF);
+    return TEST_RESULT();
+}
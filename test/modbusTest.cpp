@@ -0,0 +1,184 @@
+/**
+ * @brief Host test of the Modbus RTU slave against a local master over a pty, run via "make -C test"
+ *
+ * Serial1 is attached to the slave side of a pty, the test is the master on the other side. The simulated time stands still while
+ * the master waits, so requests without a known length can only end by the receive timeout of the port, like on the UART. A second
+ * slave on the same port as plain Stream has to measure the silence in handle() instead.
+ */
+
+// Related
+// System / External
+#include <Arduino.h>
+#include <FastAccelStepper.h>
+#include <HostSim.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+// Selfmade
+// Project
+#include "../src/controller/stepper/Stepper.h"
+#include "../src/protocol/ModbusSlave.h"
+#include "../src/utils/Utils.h"
+#include "HostTest.h"
+
+const uint32_t BAUD = 19200;              // Baud rate of the bus
+const uint8_t SLAVE_ADDRESS = 1;          // Slave on the receive timeout of the port
+const uint8_t STREAM_ADDRESS = 2;         // Slave measuring the silence itself
+const uint32_t HANDLE_PERIOD_US = 10000;  // Simulated time between two handle()-calls
+const uint8_t CS_PIN = 13;                // Chip select of the stepper
+
+stepperConfiguration_s stepperConfig = {.stepperId = "ferrari",
+                                        .maxCurrent = 700,
+                                        .microstepsPerStep = 32,
+                                        .stepsPerRotation = 200,
+                                        .mmPerRotation = 8,
+                                        .gearRatio = 1,
+                                        .stall = 5,
+                                        .pins = {.en = 12, .dir = 14, .step = 17, .cs = CS_PIN, .diag = 0}};
+
+/**
+ * @brief Send a request from the master, the CRC is appended
+ *
+ * @param master file descriptor of the master side
+ * @param request request without CRC
+ * @param length size of the request in bytes
+ */
+static void sendRequest(int master, const uint8_t *request, size_t length) {
+    uint8_t frame[MODBUS_FRAME_LENGTH];
+    memcpy(frame, request, length);
+    uint16_t crc = crc16Modbus(frame, length);
+    frame[length++] = crc & 0xFF;
+    frame[length++] = crc >> 8;
+    CHECK(write(master, frame, length) == (ssize_t)length);
+}
+
+/**
+ * @brief Receive the response of the slave on the master side
+ *
+ * @param master file descriptor of the master side
+ * @param response memory location to write the response to, MODBUS_FRAME_LENGTH bytes
+ * @return size_t size of the response in bytes, 0 if there was none or its CRC is wrong
+ */
+static size_t receiveResponse(int master, uint8_t *response) {
+    size_t length = 0;
+    pollfd descriptor = {master, POLLIN, 0};
+    while (poll(&descriptor, 1, 20) > 0) {
+        ssize_t read = ::read(master, response + length, MODBUS_FRAME_LENGTH - length);
+        if (read <= 0) break;
+        length += read;
+    }
+    if (length < 4 || crc16Modbus(response, length - 2) != (response[length - 2] | response[length - 1] << 8)) return 0;
+    return length;
+}
+
+/**
+ * @brief Let the slave on the receive timeout process one request and return its response
+ *
+ * @param master file descriptor of the master side
+ * @param slave slave to be handled
+ * @param request request without CRC
+ * @param length size of the request in bytes
+ * @param response memory location to write the response to, MODBUS_FRAME_LENGTH bytes
+ * @return size_t size of the response in bytes, 0 if there was none
+ */
+static size_t transact(int master, ModbusSlave &slave, const uint8_t *request, size_t length, uint8_t *response) {
+    sendRequest(master, request, length);
+    CHECK(Serial1.hostPump(100));
+    slave.handle();
+    return receiveResponse(master, response);
+}
+
+int main() {
+    int master, slavePty;
+    if (!openPty(master, slavePty)) {
+        printf("%s: skipped, no pty available\n", __FILE__);
+        return 0;
+    }
+
+    HostSim::reset();
+    HostSim::setDrvStatus(CS_PIN, 600);
+    FastAccelStepperEngine engine;
+    Stepper stepper(stepperConfig, &engine);
+    engine.init();
+    stepper.init();
+    Stepper *steppers[] = {&stepper};
+    machineControllers_s controllers = {.steppers = steppers, .stepperCount = 1, .heaters = NULL, .heaterCount = 0, .motors = NULL,
+                                        .motorCount = 0};
+    ModbusSlave slave(controllers, SLAVE_ADDRESS, BAUD, &Serial1);
+    Serial1.begin(BAUD);
+    Serial1.hostAttach(slavePty);
+    slave.init();
+    CHECK(slave.isReady());
+    uint8_t response[MODBUS_FRAME_LENGTH];
+
+    // Write setpoints and the rotate command of the stepper in one request
+    const uint8_t rotate[] = {SLAVE_ADDRESS, 16, 0, 0, 0, 2, 4, 0, MODBUS_COMMAND_ROTATE, 0, 200};
+    size_t length = transact(master, slave, rotate, sizeof(rotate), response);
+    CHECK(length == 8 && memcmp(response, rotate, 6) == 0);
+    for (uint8_t i = 0; i < 100; ++i) {
+        stepper.handle();
+        HostSim::advanceUs(HANDLE_PERIOD_US);
+    }
+    CHECK(stepper.getCurrentMode() == ROTATING);
+    CHECK_NEAR(stepper.getCurrentRpm(), 20, 0.5);
+
+    // Holding registers read back as written, input registers from the snapshot
+    const uint8_t readHolding[] = {SLAVE_ADDRESS, 3, 0, 0, 0, 2};
+    length = transact(master, slave, readHolding, sizeof(readHolding), response);
+    CHECK(length == 9 && response[2] == 4 && response[4] == MODBUS_COMMAND_ROTATE && response[6] == 200);
+    const uint8_t readInput[] = {SLAVE_ADDRESS, 4, 0, 0, 0, 2};
+    length = transact(master, slave, readInput, sizeof(readInput), response);
+    CHECK(length == 9 && response[4] == ROTATING);
+    CHECK(abs((int16_t)(response[5] << 8 | response[6])) == 200);  // The status counts in the direction of the step generator
+
+    // Unknown function: the length is unknown, the simulated time stands still, only the receive timeout ends the request
+    const uint8_t unknown[] = {SLAVE_ADDRESS, 0x11};
+    length = transact(master, slave, unknown, sizeof(unknown), response);
+    CHECK(length == 5 && response[1] == 0x91 && response[2] == 1);
+
+    // Unmapped registers and requests to other slaves
+    const uint8_t unmapped[] = {SLAVE_ADDRESS, 3, 0, MODBUS_BLOCK_SIZE, 0, 1};
+    length = transact(master, slave, unmapped, sizeof(unmapped), response);
+    CHECK(length == 5 && response[1] == 0x83 && response[2] == 2);
+    const uint8_t otherSlave[] = {SLAVE_ADDRESS + 10, 3, 0, 0, 0, 1};
+    CHECK(transact(master, slave, otherSlave, sizeof(otherSlave), response) == 0);
+
+    // A gap within a request ends it early, both parts are dropped
+    uint32_t crcErrors = slave.getCrcErrors();
+    uint8_t split[] = {SLAVE_ADDRESS, 3, 0, 0, 0, 1, 0, 0};
+    uint16_t crc = crc16Modbus(split, 6);
+    split[6] = crc & 0xFF;
+    split[7] = crc >> 8;
+    CHECK(write(master, split, 4) == 4);
+    CHECK(Serial1.hostPump(100));
+    slave.handle();
+    CHECK(write(master, split + 4, 4) == 4);
+    CHECK(Serial1.hostPump(100));
+    slave.handle();
+    CHECK(receiveResponse(master, response) == 0);
+    CHECK(slave.getCrcErrors() == crcErrors + 2);
+    CHECK(slave.getRequests() == 5);
+
+    // As plain Stream, known requests end with their CRC and others after the silence measured in handle()
+    ModbusSlave streamSlave(controllers, STREAM_ADDRESS, BAUD, (Stream *)&Serial1);
+    streamSlave.init();
+    const uint8_t streamRead[] = {STREAM_ADDRESS, 4, 0, 0, 0, 1};
+    sendRequest(master, streamRead, sizeof(streamRead));
+    CHECK(Serial1.hostPump(100));
+    streamSlave.handle();
+    length = receiveResponse(master, response);
+    CHECK(length == 7 && response[4] == ROTATING);
+    const uint8_t streamUnknown[] = {STREAM_ADDRESS, 0x11};
+    sendRequest(master, streamUnknown, sizeof(streamUnknown));
+    CHECK(Serial1.hostPump(100));
+    streamSlave.handle();
+    CHECK(receiveResponse(master, response) == 0);
+    HostSim::advanceUs(HANDLE_PERIOD_US);
+    streamSlave.handle();
+    length = receiveResponse(master, response);
+    CHECK(length == 5 && response[1] == 0x91);
+
+    close(slavePty);
+    close(master);
+    return TEST_RESULT();
+}
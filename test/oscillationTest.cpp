@@ -0,0 +1,119 @@
+/**
+ * @brief Host test of the reversals of oscillations under a jittering loop, run via "make -C test"
+ *
+ * handle() is called at random periods, like from a loop busy with other work. The strokes are queued ahead, so each reversal has to
+ * happen at the same position and the pause between the last step towards it and the first step away from it has to be the dwell,
+ * independent of the time handle() is called.
+ */
+
+// Related
+// System / External
+#include <Arduino.h>
+#include <FastAccelStepper.h>
+#include <HostSim.h>
+#include <math.h>
+// Selfmade
+// Project
+#include "../src/controller/stepper/Stepper.h"
+#include "HostTest.h"
+
+const uint32_t MIN_PERIOD_US = 5000;      // Shortest time between two handle()-calls
+const uint32_t MAX_PERIOD_US = 15000;     // Longest time between two handle()-calls
+const uint32_t SAMPLE_US = 50;            // Resolution of the recorded step times
+const uint32_t DURATION_US = 30000000;    // Simulated time of each oscillation
+const float RPM = 60;                     // Speed of the strokes
+const int32_t START_POSITION = 0;         // First end of the strokes in mm
+const int32_t END_POSITION = 10;          // Second end of the strokes in mm
+const uint16_t MIN_REVERSALS = 10;        // Reversals needed for a meaningful spread
+const uint32_t MAX_SPREAD_US = 200;       // Largest allowed spread of the pauses at the reversals
+const uint32_t HOMING_PERIOD_US = 10000;  // Simulated time between two handle()-calls while homing
+const uint16_t HOMING_CALLS = 50;         // handle()-calls of the approach until the end stop is hit
+const uint8_t CS_PIN = 13;                // Chip select of the stepper
+const uint32_t STATUS_IDLE = 600;         // DRV_STATUS with a StallGuard value of light load
+const uint32_t STATUS_STALLED = 0;        // DRV_STATUS with a StallGuard value of full load
+
+stepperConfiguration_s stepperConfig = {.stepperId = "ferrari",
+                                        .maxCurrent = 700,
+                                        .microstepsPerStep = 32,
+                                        .stepsPerRotation = 200,
+                                        .mmPerRotation = 8,
+                                        .gearRatio = 1,
+                                        .stall = 5,
+                                        .pins = {.en = 12, .dir = 14, .step = 17, .cs = CS_PIN, .diag = 0}};
+
+/**
+ * @brief Oscillate with handle() called at random periods and check the pauses and positions of the reversals
+ *
+ * @param dwellMs pause at each reversal in ms
+ */
+static void checkReversals(uint16_t dwellMs) {
+    HostSim::reset();
+    HostSim::setDrvStatus(CS_PIN, STATUS_IDLE);
+    FastAccelStepperEngine engine;
+    Stepper stepper(stepperConfig, &engine);
+    engine.init();
+    stepper.init();
+    FastAccelStepper *generator = engine.hostGetStepper(0);
+    stepper.getMotion().setOscillationDwell(dwellMs);
+    stepper.moveOscillate(RPM, START_POSITION, END_POSITION);
+
+    // Oscillations need a homed stepper, the approach hits the end stop after a while
+    for (uint16_t i = 0; !stepper.isHomed() && i < 10 * HOMING_CALLS; ++i) {
+        if (i == HOMING_CALLS) HostSim::setDrvStatus(CS_PIN, STATUS_STALLED);
+        stepper.handle();
+        HostSim::advanceUs(HOMING_PERIOD_US);
+    }
+    HostSim::setDrvStatus(CS_PIN, STATUS_IDLE);
+    CHECK(stepper.isHomed());
+
+    uint32_t random = 12345;  // Fixed seed, the test has to be reproducible
+    int32_t lastPosition = generator->getCurrentPosition();
+    uint64_t lastStepUs = 0;
+    int8_t direction = 0;
+    uint16_t reversals = 0;
+    int32_t reversalPositions[2] = {};
+    bool positionsEqual = true;
+    uint32_t minPauseUs = UINT32_MAX, maxPauseUs = 0;
+    uint64_t endUs = HostSim::getTimeUs() + DURATION_US;
+    while (HostSim::getTimeUs() < endUs) {
+        stepper.handle();
+        random = random * 1103515245 + 12345;
+        uint32_t periodUs = MIN_PERIOD_US + (random >> 8) % (MAX_PERIOD_US - MIN_PERIOD_US);
+        for (uint32_t elapsedUs = 0; elapsedUs < periodUs; elapsedUs += SAMPLE_US) {
+            HostSim::advanceUs(SAMPLE_US);
+            int32_t position = generator->getCurrentPosition();
+            if (position == lastPosition) continue;
+
+            // The first reversal ends the approach to the start position, only the following ones are strokes at full speed
+            int8_t newDirection = position > lastPosition ? 1 : -1;
+            if (direction != 0 && newDirection != direction) {
+                if (reversals > 0) {
+                    uint32_t pauseUs = HostSim::getTimeUs() - lastStepUs;
+                    minPauseUs = min(minPauseUs, pauseUs);
+                    maxPauseUs = max(maxPauseUs, pauseUs);
+                    int32_t &reversalPosition = reversalPositions[direction > 0];
+                    if (reversals > 2) positionsEqual &= reversalPosition == lastPosition;
+                    reversalPosition = lastPosition;
+                }
+                reversals++;
+            }
+            direction = newDirection;
+            lastPosition = position;
+            lastStepUs = HostSim::getTimeUs();
+        }
+    }
+
+    CHECK(stepper.getCurrentMode() == OSCILLATING_FORWARD || stepper.getCurrentMode() == OSCILLATING_BACKWARD);
+    CHECK(reversals >= MIN_REVERSALS);
+    CHECK(positionsEqual);
+    CHECK(minPauseUs >= dwellMs * 1000);
+    CHECK(maxPauseUs - minPauseUs <= MAX_SPREAD_US);
+    printf("dwell %u ms: %u reversals, pauses %.2f - %.2f ms, spread %u us\n", dwellMs, reversals, minPauseUs / 1000.0,
+           maxPauseUs / 1000.0, maxPauseUs - minPauseUs);
+}
+
+int main() {
+    checkReversals(0);
+    checkReversals(100);
+    return TEST_RESULT();
+}
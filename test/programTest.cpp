@@ -0,0 +1,223 @@
+/**
+ * @brief Host test of the machine program interpreter, run via "make -C test"
+ *
+ * Broken programs have to be rejected by load(), so a running program can not fail on its format. A valid program homes, moves,
+ * oscillates and waits, the program counter has to advance instruction by instruction as the simulated time passes. A stepper switched
+ * off while it is waited for aborts the program.
+ */
+
+// Related
+// System / External
+#include <Arduino.h>
+#include <FastAccelStepper.h>
+#include <HostSim.h>
+#include <math.h>
+#include <string.h>
+// Selfmade
+// Project
+#include "../src/controller/dcmotor/DcMotor.h"
+#include "../src/controller/stepper/Stepper.h"
+#include "../src/program/MachineProgram.h"
+#include "../src/utils/Utils.h"
+#include "HostTest.h"
+
+const uint32_t HANDLE_PERIOD_US = 10000;  // Simulated time between two handle()-calls
+const uint16_t MAX_CALLS = 6000;          // handle()-calls until a program has to be done, 60 s of simulated time
+const uint16_t HOMING_CALLS = 50;         // handle()-calls of the approach until the end stop is hit
+const uint8_t CS_PIN = 13;                // Chip select of the stepper
+const uint32_t STATUS_IDLE = 600;         // DRV_STATUS with a StallGuard value of light load
+const uint32_t STATUS_STALLED = 0;        // DRV_STATUS with a StallGuard value of full load
+const float MM_PER_ROTATION = 8;          // Travel of the stepper per rotation
+const uint16_t STROKES = 3;               // Strokes of the oscillation
+const uint32_t WAIT_MS = 500;             // Duration of OP_WAIT_MS
+
+stepperConfiguration_s stepperConfig = {.stepperId = "ferrari",
+                                        .maxCurrent = 700,
+                                        .microstepsPerStep = 32,
+                                        .stepsPerRotation = 200,
+                                        .mmPerRotation = MM_PER_ROTATION,
+                                        .gearRatio = 1,
+                                        .stall = 5,
+                                        .pins = {.en = 12, .dir = 14, .step = 17, .cs = CS_PIN, .diag = 0}};
+motorConfiguration_s motorConfig = {.motorId = "motor",
+                                    .ticksPerRotation = 100,
+                                    .pins = {.rightTurn = 4, .leftTurn = 5, .encoderA = 18, .encoderB = 19}};
+
+// HOME 60rpm, MOVE 120rpm to 20mm, OSCILLATE 120rpm between 10mm and 30mm for STROKES strokes, WAIT_MS, END
+const uint8_t SEQUENCE[] = {OP_HOME, 0, 60, 0,                                    // pc 0
+                            OP_MOVE, 0, 120, 0, 20, 0,                            // pc 4
+                            OP_OSCILLATE, 0, 120, 0, 10, 0, 30, 0, STROKES, 0,    // pc 10
+                            OP_WAIT_MS, WAIT_MS & 0xFF, WAIT_MS >> 8, 0, 0,       // pc 20
+                            OP_END};                                              // pc 25
+const uint16_t PC_MOVE = 4, PC_OSCILLATE = 10, PC_WAIT = 20, PC_END = 25;         // Offsets of the instructions in SEQUENCE
+
+/**
+ * @brief Put the header in front of the code
+ *
+ * @param program memory location to write the program to, has to hold PROGRAM_HEADER_SIZE + length bytes
+ * @param code instructions
+ * @param length size of the instructions in bytes
+ * @return uint16_t size of the program in bytes
+ */
+static uint16_t buildProgram(uint8_t *program, const uint8_t *code, uint16_t length) {
+    uint16_t crc = crc16Ccitt(code, length);
+    const uint8_t header[PROGRAM_HEADER_SIZE] = {'Q', 'P', PROGRAM_VERSION, (uint8_t)(length & 0xFF), (uint8_t)(length >> 8),
+                                                 (uint8_t)(crc & 0xFF), (uint8_t)(crc >> 8)};
+    memcpy(program, header, PROGRAM_HEADER_SIZE);
+    memcpy(program + PROGRAM_HEADER_SIZE, code, length);
+    return PROGRAM_HEADER_SIZE + length;
+}
+
+/**
+ * @brief Call handle() of the program and the stepper once, reporting a stalled motor while the approach of homing has gone on for a
+ * while
+ *
+ * @param program program to be handled
+ * @param stepper stepper used by the program
+ * @param homingCalls handle()-calls spent homing so far, counted up here
+ */
+static void cycle(MachineProgram &program, Stepper &stepper, uint16_t &homingCalls) {
+    homingCalls = stepper.getCurrentMode() == HOMING ? homingCalls + 1 : 0;
+    HostSim::setDrvStatus(CS_PIN, homingCalls > HOMING_CALLS ? STATUS_STALLED : STATUS_IDLE);
+    program.handle();
+    stepper.handle();
+    HostSim::advanceUs(HANDLE_PERIOD_US);
+}
+
+/**
+ * @brief Check that load() rejects broken programs and programs with operands out of range
+ *
+ * @param program interpreter to load into
+ */
+static void checkRejections(MachineProgram &program) {
+    uint8_t buffer[PROGRAM_HEADER_SIZE + sizeof(SEQUENCE)];
+    uint16_t length = buildProgram(buffer, SEQUENCE, sizeof(SEQUENCE));
+    CHECK(program.load(buffer, length));
+    CHECK(program.getState() == PROGRAM_LOADED);
+
+    buffer[PROGRAM_HEADER_SIZE + 2] ^= 1;  // Code changed after the CRC was calculated
+    CHECK(!program.load(buffer, length));
+    CHECK(program.getState() == PROGRAM_EMPTY);
+
+    // All instructions valid, but OP_END missing
+    length = buildProgram(buffer, SEQUENCE, sizeof(SEQUENCE) - 1);
+    CHECK(!program.load(buffer, length));
+
+    // Unknown controller
+    const uint8_t otherStepper[] = {OP_HOME, 1, 60, 0, OP_END};
+    length = buildProgram(buffer, otherStepper, sizeof(otherStepper));
+    CHECK(!program.load(buffer, length));
+
+    // The pwm of a motor has to fit into analogWrite()
+    const uint8_t motorFull[] = {OP_MOTOR, 0, 0x01, 0xFF, OP_END};  // -255
+    length = buildProgram(buffer, motorFull, sizeof(motorFull));
+    CHECK(program.load(buffer, length));
+    const uint8_t motorTooFast[] = {OP_MOTOR, 0, 0xE8, 0x03, OP_END};  // 1000
+    length = buildProgram(buffer, motorTooFast, sizeof(motorTooFast));
+    CHECK(!program.load(buffer, length));
+    const uint8_t motorTooFastLeft[] = {OP_MOTOR, 0, 0x00, 0xFF, OP_END};  // -256
+    length = buildProgram(buffer, motorTooFastLeft, sizeof(motorTooFastLeft));
+    CHECK(!program.load(buffer, length));
+}
+
+/**
+ * @brief Run the sequence and check each instruction as the program counter moves on
+ *
+ * @param program interpreter to run on
+ * @param stepper stepper used by the program
+ */
+static void checkSequence(MachineProgram &program, Stepper &stepper) {
+    uint8_t buffer[PROGRAM_HEADER_SIZE + sizeof(SEQUENCE)];
+    uint16_t length = buildProgram(buffer, SEQUENCE, sizeof(SEQUENCE));
+    CHECK(program.load(buffer, length));
+    program.start();
+    CHECK(program.getState() == PROGRAM_RUNNING);
+    CHECK(program.getProgramCounter() == 0);
+
+    uint16_t homingCalls = 0;
+    uint16_t counter = 0;
+    uint64_t waitStartUs = 0;
+    for (uint16_t i = 0; i < MAX_CALLS && program.getState() == PROGRAM_RUNNING; ++i) {
+        cycle(program, stepper, homingCalls);
+        if (program.getProgramCounter() == counter) continue;
+
+        // The program counter only moves forward, one instruction at a time
+        uint16_t previous = counter;
+        counter = program.getProgramCounter();
+        switch (counter) {
+            case PC_MOVE:
+                CHECK(previous == 0);
+                CHECK(stepper.isHomed());
+                break;
+            case PC_OSCILLATE:
+                CHECK(previous == PC_MOVE);
+                CHECK_NEAR(fabsf(stepper.getCurrentRotations()) * MM_PER_ROTATION, 20, 0.01);
+                break;
+            case PC_WAIT:
+                CHECK(previous == PC_OSCILLATE);
+                // The approach from 20mm and two more strokes end at 10mm, the next stroke barely started when standby was ordered
+                CHECK_NEAR(fabsf(stepper.getCurrentRotations()) * MM_PER_ROTATION, 10, 0.1);
+                CHECK(stepper.hasPendingCommand());
+                waitStartUs = HostSim::getTimeUs();
+                break;
+            case PC_END:
+                CHECK(previous == PC_WAIT);
+                CHECK_NEAR(HostSim::getTimeUs() - waitStartUs, WAIT_MS * 1000, 2 * HANDLE_PERIOD_US);
+                CHECK(stepper.getCurrentMode() == STANDBY);
+                break;
+            default:
+                printf("unexpected program counter %u after %u\n", counter, previous);
+                CHECK(false);
+                break;
+        }
+    }
+    CHECK(counter == PC_END);
+    CHECK(program.getState() == PROGRAM_FINISHED);
+    CHECK(stepper.isIdle());
+}
+
+/**
+ * @brief Switch the stepper off while the program waits for its move, the program has to abort at the move
+ *
+ * @param program interpreter to run on
+ * @param stepper stepper used by the program, homed
+ */
+static void checkStepperOff(MachineProgram &program, Stepper &stepper) {
+    const uint8_t code[] = {OP_MOVE, 0, 60, 0, 100, 0, OP_END};
+    uint8_t buffer[PROGRAM_HEADER_SIZE + sizeof(code)];
+    uint16_t length = buildProgram(buffer, code, sizeof(code));
+    CHECK(program.load(buffer, length));
+    program.start();
+
+    uint16_t homingCalls = 0;
+    for (uint8_t i = 0; i < 50; ++i) cycle(program, stepper, homingCalls);
+    CHECK(program.getState() == PROGRAM_RUNNING);
+    CHECK(stepper.getCurrentMode() == POSITIONING);
+
+    stepper.switchModeOff();
+    for (uint8_t i = 0; i < 5; ++i) cycle(program, stepper, homingCalls);
+    CHECK(program.getState() == PROGRAM_ABORTED);
+    CHECK(program.getProgramCounter() == 0);
+}
+
+int main() {
+    HostSim::reset();
+    HostSim::setDrvStatus(CS_PIN, STATUS_IDLE);
+    FastAccelStepperEngine engine;
+    Stepper stepper(stepperConfig, &engine);
+    DcMotor motor(motorConfig);
+    engine.init();
+    stepper.init();
+    motor.init();
+    Stepper *steppers[] = {&stepper};
+    DcMotor *motors[] = {&motor};
+    machineControllers_s controllers = {.steppers = steppers, .stepperCount = 1, .heaters = NULL, .heaterCount = 0, .motors = motors,
+                                        .motorCount = 1};
+    MachineProgram program(controllers);
+    program.init();
+
+    checkRejections(program);
+    checkSequence(program, stepper);
+    checkStepperOff(program, stepper);
+    return TEST_RESULT();
+}
@@ -0,0 +1,387 @@
+/**
+ * @brief Host test of the command protocol, run via "make -C test"
+ *
+ * Frames passed to receive() directly, with the acks captured from Serial: a frame carries commands for several axes, a frame with an
+ * invalid command executes none of them, a repeated sequence number is acknowledged without executing again, broken frames are
+ * counted and dropped without ack, and an oversized frame is skipped up to the next delimiter.
+ *
+ * Then over a pty loopback: Serial is attached to the slave side of a pty, the test is the host on the master side. It sends rotate
+ * commands while telemetry and log output share the line at a low baud rate, so frames are sent in chunks over several handle()-calls.
+ * Every zero-delimited chunk the host receives has to be a valid ack, a valid telemetry frame or plain log text, and every command has
+ * to be acknowledged.
+ */
+
+// Related
+// System / External
+#include <Arduino.h>
+#include <FastAccelStepper.h>
+#include <HostSim.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+// Selfmade
+// Project
+#include "../src/controller/stepper/Stepper.h"
+#include "../src/logger/logging.h"
+#include "../src/protocol/CommandProtocol.h"
+#include "../src/protocol/TelemetryPublisher.h"
+#include "../src/utils/Utils.h"
+#include "HostTest.h"
+
+const uint32_t HANDLE_PERIOD_US = 10000;  // Simulated time between two handle()-calls
+const uint32_t BAUD = 4800;               // Slow enough that frames often wait for the transmit FIFO and are sent in chunks
+const uint8_t COMMANDS = 40;              // Rotate commands sent by the host
+const uint8_t COMMAND_INTERVAL = 7;       // handle()-calls between two commands
+const uint16_t SETTLE_CALLS = 200;        // handle()-calls after the last command until all output is received
+const uint8_t CS_PIN = 13;                // Chip select of the stepper
+const uint8_t SECOND_CS_PIN = 5;          // Chip select of the second axis
+const uint16_t RUN_CALLS = 100;           // handle()-calls until a command took effect, 1 s of simulated time
+const uint8_t MAX_ACKS = 8;               // Acks taken from Serial at once
+
+stepperConfiguration_s stepperConfig = {.stepperId = "ferrari",
+                                        .maxCurrent = 700,
+                                        .microstepsPerStep = 32,
+                                        .stepsPerRotation = 200,
+                                        .mmPerRotation = 8,
+                                        .gearRatio = 1,
+                                        .stall = 5,
+                                        .pins = {.en = 12, .dir = 14, .step = 17, .cs = CS_PIN, .diag = 0}};
+stepperConfiguration_s secondConfig = {.stepperId = "puller",
+                                       .maxCurrent = 700,
+                                       .microstepsPerStep = 32,
+                                       .stepsPerRotation = 200,
+                                       .mmPerRotation = 10,
+                                       .gearRatio = 1,
+                                       .stall = 8,
+                                       .pins = {.en = 12, .dir = 27, .step = 25, .cs = SECOND_CS_PIN, .diag = 0}};
+
+/**
+ * @brief Received chunks by kind
+ *
+ */
+struct received_s {
+    uint32_t acks;           // Acks with a valid CRC
+    uint8_t nextAck;         // Sequence number of the next expected ack
+    uint32_t telemetry;      // Telemetry frames with a valid CRC
+    uint16_t nextTelemetry;  // Sequence number of the next expected telemetry frame
+    bool telemetryStarted;   // Flag whether a telemetry frame was received yet
+    uint32_t text;           // Chunks of log text
+    uint32_t corrupted;      // Chunks that are neither, i.e. frames mixed with other output
+};
+
+/**
+ * @brief Write a rotate command
+ *
+ * @param command memory location to write the command to, has to hold 6 bytes
+ * @param index stepper addressed
+ * @param rpm speed of the command
+ * @return size_t size of the command in bytes
+ */
+static size_t putRotate(uint8_t *command, uint8_t index, float rpm) {
+    command[0] = CMD_ROTATE;
+    command[1] = index;
+    memcpy(command + 2, &rpm, sizeof(rpm));
+    return 2 + sizeof(rpm);
+}
+
+/**
+ * @brief Build a frame as sent by the host: sequence number, commands and CRC, COBS encoded and followed by the delimiter
+ *
+ * @param sequence sequence number of the frame
+ * @param commands commands of the frame
+ * @param length size of the commands in bytes, at most 64
+ * @param encoded memory location to write the frame to, has to hold length + 6 bytes
+ * @return size_t size of the encoded frame including the delimiter
+ */
+static size_t encodeFrame(uint8_t sequence, const uint8_t *commands, size_t length, uint8_t *encoded) {
+    uint8_t frame[64 + 3];
+    frame[0] = sequence;
+    memcpy(frame + 1, commands, length);
+    uint16_t crc = crc16Ccitt(frame, length + 1);
+    frame[length + 1] = crc & 0xFF;
+    frame[length + 2] = crc >> 8;
+
+    size_t encodedLength = cobsEncode(frame, length + 3, encoded);
+    encoded[encodedLength++] = 0;
+    return encodedLength;
+}
+
+/**
+ * @brief Send a frame with one rotate command from the host
+ *
+ * @param master file descriptor of the host side
+ * @param sequence sequence number of the frame
+ * @param rpm speed of the command
+ */
+static void sendRotate(int master, uint8_t sequence, float rpm) {
+    uint8_t command[6];
+    uint8_t encoded[sizeof(command) + 6];
+    size_t length = encodeFrame(sequence, command, putRotate(command, 0, rpm), encoded);
+    CHECK(write(master, encoded, length) == (ssize_t)length);
+}
+
+/**
+ * @brief Take the acks the protocol sent since the last call out of the captured Serial output
+ *
+ * @param sequences memory location to write the acknowledged sequence numbers to, has to hold MAX_ACKS
+ * @param status memory location to write the status of each ack to, has to hold MAX_ACKS
+ * @return uint8_t number of acks, chunks that are no valid ack are not counted
+ */
+static uint8_t takeAcks(uint8_t *sequences, uint8_t *status) {
+    uint8_t count = 0;
+    size_t start = 0;
+    while (start < Serial.captured.size()) {
+        size_t end = Serial.captured.find('\0', start);
+        if (end == std::string::npos) end = Serial.captured.size();
+        std::string chunk = Serial.captured.substr(start, end - start);
+        start = end + 1;
+
+        uint8_t *data = (uint8_t *)&chunk[0];
+        if (chunk.empty() || cobsDecode(data, chunk.size()) != 4) continue;
+        if (crc16Ccitt(data, 2) != (data[2] | data[3] << 8) || count == MAX_ACKS) continue;
+        sequences[count] = data[0];
+        status[count] = data[1];
+        count++;
+    }
+    Serial.captured.clear();
+    return count;
+}
+
+/**
+ * @brief Call handle() of both steppers, so they act on the commands given
+ *
+ * @param first first axis
+ * @param second second axis
+ * @param calls handle()-calls
+ */
+static void run(Stepper &first, Stepper &second, uint16_t calls) {
+    for (uint16_t i = 0; i < calls; ++i) {
+        first.handle();
+        second.handle();
+        HostSim::advanceUs(HANDLE_PERIOD_US);
+    }
+}
+
+/**
+ * @brief Pass frames to receive() and check batching, all-or-nothing execution, retries, broken frames and overflows
+ *
+ */
+static void checkFrames() {
+    HostSim::reset();
+    HostSim::setDrvStatus(CS_PIN, 600);
+    HostSim::setDrvStatus(SECOND_CS_PIN, 600);
+    Serial.begin(115200);
+    Serial.capture = true;
+    FastAccelStepperEngine engine;
+    Stepper first(stepperConfig, &engine);
+    Stepper second(secondConfig, &engine);
+    engine.init();
+    first.init();
+    second.init();
+    Stepper *steppers[] = {&first, &second};
+    machineControllers_s controllers = {.steppers = steppers, .stepperCount = 2, .heaters = NULL, .heaterCount = 0, .motors = NULL,
+                                        .motorCount = 0};
+    CommandProtocol protocol(controllers);
+    protocol.init();
+
+    uint8_t commands[32];
+    uint8_t encoded[sizeof(commands) + 6];
+    uint8_t sequences[MAX_ACKS], status[MAX_ACKS];
+
+    // Both axes in one frame
+    size_t length = putRotate(commands, 0, 30);
+    length += putRotate(commands + length, 1, -20);
+    protocol.receive(encoded, encodeFrame(1, commands, length, encoded));
+    CHECK(takeAcks(sequences, status) == 1);
+    CHECK(sequences[0] == 1 && status[0] == COMMAND_OK);
+    run(first, second, RUN_CALLS);
+    CHECK_NEAR(first.getCurrentRpm(), 30, 0.5);
+    CHECK_NEAR(second.getCurrentRpm(), -20, 0.5);
+
+    // The second command addresses a stepper that does not exist, the first one must not be executed either
+    length = putRotate(commands, 0, 60);
+    length += putRotate(commands + length, 7, 60);
+    protocol.receive(encoded, encodeFrame(2, commands, length, encoded));
+    CHECK(takeAcks(sequences, status) == 1);
+    CHECK(sequences[0] == 2 && status[0] == COMMAND_INVALID);
+    CHECK(!first.hasPendingCommand());
+
+    // Same for a second command cut short
+    length = putRotate(commands, 0, 60);
+    length += putRotate(commands + length, 1, 60) - 2;
+    protocol.receive(encoded, encodeFrame(3, commands, length, encoded));
+    CHECK(takeAcks(sequences, status) == 1);
+    CHECK(sequences[0] == 3 && status[0] == COMMAND_INVALID);
+    CHECK(!first.hasPendingCommand() && !second.hasPendingCommand());
+    run(first, second, RUN_CALLS);
+    CHECK_NEAR(first.getCurrentRpm(), 30, 0.5);
+    CHECK(protocol.getCounters().invalid == 2);
+
+    // A retry after a lost ack is acknowledged again, but the command was already executed and is not repeated
+    length = putRotate(commands, 1, 45);
+    size_t frameLength = encodeFrame(4, commands, length, encoded);
+    protocol.receive(encoded, frameLength);
+    CHECK(takeAcks(sequences, status) == 1);
+    run(first, second, RUN_CALLS);
+    second.switchModeStandby();
+    run(first, second, RUN_CALLS);
+    protocol.receive(encoded, frameLength);
+    CHECK(takeAcks(sequences, status) == 1);
+    CHECK(sequences[0] == 4 && status[0] == COMMAND_OK);
+    CHECK(protocol.getCounters().duplicates == 1);
+    CHECK(!second.hasPendingCommand());
+    CHECK(second.getCurrentMode() == STANDBY);
+
+    // Broken CRC and broken COBS encoding are dropped silently, the sender retries after its timeout
+    commandProtocolCounters_s before = protocol.getCounters();
+    length = putRotate(commands, 0, -15);
+    frameLength = encodeFrame(5, commands, length, encoded);
+    encoded[frameLength - 2] ^= 0x01;  // Last CRC byte
+    protocol.receive(encoded, frameLength);
+    frameLength = encodeFrame(5, commands, length, encoded);
+    encoded[0] = 0xFE;  // First block reaching beyond the frame
+    protocol.receive(encoded, frameLength);
+    CHECK(takeAcks(sequences, status) == 0);
+    CHECK(protocol.getCounters().crcErrors == before.crcErrors + 2);
+    CHECK(protocol.getCounters().frames == before.frames);
+    CHECK(!first.hasPendingCommand());
+
+    // A frame longer than the receive buffer is skipped up to the next delimiter, received in pieces like from a UART
+    uint8_t garbage[COMMAND_PROTOCOL_RX_LENGTH * 2 + 20];  // Fills the buffer twice, still one frame
+    memset(garbage, 0x55, sizeof(garbage));
+    protocol.receive(garbage, COMMAND_PROTOCOL_RX_LENGTH / 2);
+    protocol.receive(garbage, sizeof(garbage));
+    uint8_t tail[sizeof(encoded) + 2] = {0x55, 0};  // End of the oversized frame, then the retry of the frame with sequence 5
+    size_t tailLength = 2 + encodeFrame(5, commands, length, tail + 2);
+    protocol.receive(tail, tailLength);
+    CHECK(protocol.getCounters().overflows == before.overflows + 1);
+    CHECK(protocol.getCounters().crcErrors == before.crcErrors + 2);
+    CHECK(takeAcks(sequences, status) == 1);
+    CHECK(sequences[0] == 5 && status[0] == COMMAND_OK);
+    run(first, second, RUN_CALLS);
+    CHECK_NEAR(first.getCurrentRpm(), -15, 0.5);
+
+    Serial.capture = false;
+}
+
+/**
+ * @brief Sort a received chunk between two delimiters into acks, telemetry frames, text or corrupted output
+ *
+ * @param received counters to update
+ * @param chunk chunk without delimiters, decoded in place
+ */
+static void classifyChunk(received_s &received, std::string chunk) {
+    bool printable = true;
+    for (size_t i = 0; i < chunk.size(); ++i) printable &= (uint8_t)chunk[i] >= 0x1B || chunk[i] == '\n';
+    if (printable && chunk.find("\x1B[") != std::string::npos) {
+        received.text++;
+        return;
+    }
+
+    uint8_t *data = (uint8_t *)&chunk[0];
+    size_t length = cobsDecode(data, chunk.size());
+    if (length < 3 || crc16Ccitt(data, length - 2) != (data[length - 2] | data[length - 1] << 8)) {
+        received.corrupted++;
+        return;
+    }
+    if (length == 4) {
+        CHECK(data[0] == received.nextAck);
+        CHECK(data[1] == COMMAND_OK);
+        received.nextAck = data[0] + 1;
+        received.acks++;
+    } else {
+        uint16_t sequence = data[4] | data[5] << 8;
+        CHECK(data[0] == TELEMETRY_SCHEMA);
+        CHECK(!received.telemetryStarted || sequence == received.nextTelemetry);
+        received.telemetryStarted = true;
+        received.nextTelemetry = sequence + 1;
+        received.telemetry++;
+    }
+}
+
+/**
+ * @brief Read everything the device sent so far and classify the completed chunks
+ *
+ * @param master file descriptor of the host side
+ * @param pending bytes of the chunk being received
+ * @param received counters to update
+ */
+static void receive(int master, std::string &pending, received_s &received) {
+    uint8_t buffer[256];
+    ssize_t length;
+    while ((length = read(master, buffer, sizeof(buffer))) > 0) {
+        for (ssize_t i = 0; i < length; ++i) {
+            if (buffer[i] != 0) {
+                pending += (char)buffer[i];
+                continue;
+            }
+            if (!pending.empty()) classifyChunk(received, pending);
+            pending.clear();
+        }
+    }
+}
+
+/**
+ * @brief Exchange commands, acks, telemetry and log output over a pty at a low baud rate
+ *
+ */
+static void checkLoopback() {
+    int master, slave;
+    if (!openPty(master, slave)) {
+        printf("%s: loopback skipped, no pty available\n", __FILE__);
+        return;
+    }
+
+    HostSim::reset();
+    HostSim::setDrvStatus(CS_PIN, 600);
+    Serial.begin(BAUD);
+    Serial.hostAttach(slave);
+    FastAccelStepperEngine engine;
+    Stepper stepper(stepperConfig, &engine);
+    engine.init();
+    stepper.init();
+    Stepper *steppers[] = {&stepper};
+    machineControllers_s controllers = {.steppers = steppers, .stepperCount = 1, .heaters = NULL, .heaterCount = 0, .motors = NULL,
+                                        .motorCount = 0};
+    CommandProtocol protocol(controllers);
+    TelemetryPublisher telemetry(controllers);
+    protocol.init();
+    telemetry.init();
+    CHECK(telemetry.start(20));
+
+    received_s received = {};
+    std::string pending;
+    uint8_t sent = 0;
+    for (uint32_t i = 0; sent < COMMANDS || i < (uint32_t)COMMANDS * COMMAND_INTERVAL + SETTLE_CALLS; ++i) {
+        if (sent < COMMANDS && i % COMMAND_INTERVAL == 0) {
+            sendRotate(master, sent, 10 + sent);
+            sent++;
+        }
+        if (i % 3 == 0) logPrint(INFO, INFO, "cycle %u\n", i);
+        protocol.handle();
+        stepper.handle();
+        telemetry.handle();
+        HostSim::advanceUs(HANDLE_PERIOD_US);
+        receive(master, pending, received);
+    }
+
+    CHECK_NEAR(stepper.getCurrentRpm(), 10 + COMMANDS - 1, 0.5);
+    CHECK(received.acks == COMMANDS);
+    CHECK(protocol.getCounters().frames == COMMANDS);
+    CHECK(protocol.getCounters().droppedAcks == 0);
+    CHECK(received.telemetry > 0);
+    CHECK(received.text > 0);
+    CHECK(received.corrupted == 0);
+    printf("%u acks, %u telemetry frames, %u log lines, %u corrupted\n", received.acks, received.telemetry, received.text,
+           received.corrupted);
+
+    Serial.hostAttach(-1);
+    close(slave);
+    close(master);
+}
+
+int main() {
+    checkFrames();
+    checkLoopback();
+    return TEST_RESULT();
+}
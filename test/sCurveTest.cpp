@@ -0,0 +1,200 @@
+/**
+ * @brief Host test of the jerk-limited S-curve profiles against the analytic curves, run via "make -C test"
+ *
+ * The analytic reference integrates the seven phases of piecewise constant jerk in closed form, independent of the phase layout of
+ * MotionProfile.cpp. Planned profiles have to match it in position and speed, respect the limits and, fed through StepperQueue, move
+ * the simulated step generator along the same curve.
+ */
+
+// Related
+// System / External
+#include <Arduino.h>
+#include <FastAccelStepper.h>
+#include <HostSim.h>
+#include <math.h>
+// Selfmade
+// Project
+#include "../src/controller/stepper/StepperQueue.h"
+#include "../src/motion/MotionProfile.h"
+#include "HostTest.h"
+
+const float V_MAX = 8000;            // Highest speed in steps/s
+const float ACCEL = 20000;           // Highest acceleration in steps/s²
+const float JERK = 200000;           // Highest jerk in steps/s³
+const uint16_t SAMPLES = 1000;       // Points compared along each profile
+const float V_FAST = 20000;          // Speed of the blended short moves in steps/s, a single step takes less than MIN_CMD_TICKS
+const uint32_t SHORT_DWELL_US = 50;  // Dwell below MIN_CMD_TICKS
+
+/**
+ * @brief Phases of constant jerk of a move from standstill to standstill
+ *
+ */
+struct analyticCurve_s {
+    double durations[7];  // Duration of each phase in s
+    double jerks[7];      // Jerk of each phase in steps/s³
+};
+
+/**
+ * @brief Build the reference from the speed actually reached and the jerk, the acceleration follows from them
+ *
+ * @param speed cruise speed in steps/s
+ * @param distance length of the move in steps
+ * @return analyticCurve_s phases of the move
+ */
+static analyticCurve_s buildCurve(double speed, double distance) {
+    // Ramp without a phase of constant acceleration if the acceleration limit is not reached on the way to the speed
+    double tJerk = fmin(ACCEL / JERK, sqrt(speed / JERK));
+    double tConstant = speed / (JERK * tJerk) - tJerk;
+    double rampDistance = speed * (2 * tJerk + tConstant);
+    analyticCurve_s curve = {{tJerk, tConstant, tJerk, (distance - rampDistance) / speed, tJerk, tConstant, tJerk},
+                             {JERK, 0, -JERK, 0, -JERK, 0, JERK}};
+    return curve;
+}
+
+/**
+ * @brief Evaluate the reference by integrating the polynomials of the phases
+ *
+ * @param curve phases of the move
+ * @param t time since start in s
+ * @param position memory location to write the travelled distance in steps to
+ * @param velocity memory location to write the speed in steps/s to
+ */
+static void evaluateCurve(const analyticCurve_s &curve, double t, double &position, double &velocity) {
+    double acceleration = 0;
+    position = 0;
+    velocity = 0;
+    for (uint8_t phase = 0; phase < 7 && t > 0; ++phase) {
+        double tau = fmin(t, curve.durations[phase]);
+        double jerk = curve.jerks[phase];
+        position += velocity * tau + acceleration * tau * tau / 2 + jerk * tau * tau * tau / 6;
+        velocity += acceleration * tau + jerk * tau * tau / 2;
+        acceleration += jerk * tau;
+        t -= tau;
+    }
+}
+
+/**
+ * @brief Compare a planned profile with the reference and check its limits
+ *
+ * @param distance length of the move in steps
+ * @param fullAccel true = the move is long enough to reach the acceleration limit
+ * @param fullSpeed true = the move is long enough to reach V_MAX
+ */
+static void checkProfile(float distance, bool fullAccel, bool fullSpeed) {
+    motionProfile_s profile;
+    planSCurveProfile(profile, distance, V_MAX, ACCEL, JERK);
+    CHECK(profile.vCruise <= V_MAX * 1.0001);
+    CHECK(profile.accel <= ACCEL * 1.0001);
+    CHECK(fullSpeed == (fabsf(profile.vCruise - V_MAX) < 1));
+    CHECK(fullAccel == (fabsf(profile.accel - ACCEL) < 1));
+
+    analyticCurve_s curve = buildCurve(profile.vCruise, distance);
+    double duration = 0;
+    for (uint8_t phase = 0; phase < 7; ++phase) {
+        CHECK(curve.durations[phase] >= -1e-6);
+        duration += curve.durations[phase];
+    }
+    CHECK_NEAR(profileDuration(profile), duration, 1e-4 * duration);
+
+    double position, velocity;
+    evaluateCurve(curve, duration, position, velocity);
+    CHECK_NEAR(position, distance, 1e-3 * distance);
+    CHECK_NEAR(velocity, 0, 1e-3 * V_MAX);
+
+    // Along the move, also the inverse lookup of the time at a position
+    float maxPositionError = 0, maxVelocityError = 0, maxTimeError = 0;
+    for (uint16_t i = 0; i <= SAMPLES; ++i) {
+        double t = duration * i / SAMPLES;
+        evaluateCurve(curve, t, position, velocity);
+        maxPositionError = fmaxf(maxPositionError, fabs(profilePositionAt(profile, t) - position));
+        maxVelocityError = fmaxf(maxVelocityError, fabs(profileVelocityAt(profile, t) - velocity));
+        if (velocity > 0.01 * V_MAX) maxTimeError = fmaxf(maxTimeError, fabs(profileTimeAtPosition(profile, position) - t));
+    }
+    CHECK(maxPositionError < 1e-4 * distance + 0.01);
+    CHECK(maxVelocityError < 1e-3 * V_MAX);
+    CHECK(maxTimeError < 1e-4);
+    printf("%.0f steps: %.4f s, position error %.4f steps, speed error %.3f steps/s, time error %.1f us\n", distance, duration,
+           maxPositionError, maxVelocityError, maxTimeError * 1e6);
+}
+
+/**
+ * @brief Run a planned profile through StepperQueue and compare the simulated step generator with the reference
+ *
+ * @param distance length of the move in steps
+ */
+static void checkExecution(float distance) {
+    HostSim::reset();
+    FastAccelStepperEngine engine;
+    FastAccelStepper *stepper = engine.stepperConnectToPin(17);
+    StepperQueue queue;
+    queue.init(stepper);
+
+    motionProfile_s profile;
+    planSCurveProfile(profile, distance, V_MAX, ACCEL, JERK);
+    analyticCurve_s curve = buildCurve(profile.vCruise, distance);
+    CHECK(queue.addMove(profile, true));
+    uint64_t startUs = HostSim::getTimeUs();
+    queue.fill();
+
+    // Commands are sampled from the curve, so the steps follow it closely and the queue never runs dry before the end
+    double maxError = 0;
+    while (!queue.isIdle()) {
+        HostSim::advanceUs(1000);
+        queue.fill();
+        double position, velocity;
+        evaluateCurve(curve, (HostSim::getTimeUs() - startUs) / 1e6, position, velocity);
+        maxError = fmax(maxError, fabs(stepper->getCurrentPosition() - position));
+    }
+    CHECK(stepper->getCurrentPosition() == lroundf(distance));
+    CHECK(maxError < 2);
+    CHECK(stepper->hostGetStats().drained == 1);
+    printf("%.0f steps executed, largest deviation %.1f steps\n", distance, maxError);
+}
+
+/**
+ * @brief Run short moves blended at a high speed and a short dwell through StepperQueue, no command may be refused
+ *
+ */
+static void checkShortCommands() {
+    HostSim::reset();
+    FastAccelStepperEngine engine;
+    FastAccelStepper *stepper = engine.stepperConnectToPin(17);
+    StepperQueue queue;
+    queue.init(stepper);
+
+    // One and three steps at full speed, then a stroke back behind a dwell too short for a single pause
+    const float distances[] = {1, 3, 1};
+    int32_t position = 0;
+    for (uint8_t i = 0; i < 3; ++i) {
+        motionProfile_s profile;
+        planTrapezoidProfile(profile, distances[i], V_FAST, V_FAST, V_FAST, ACCEL);
+        CHECK(queue.addMove(profile, true, i == 2 ? SHORT_DWELL_US : 0));
+        position += distances[i];
+    }
+    motionProfile_s back;
+    planTrapezoidProfile(back, 2, V_FAST, V_FAST, 0, ACCEL);
+    CHECK(queue.addMove(back, false));
+    position -= 2;
+
+    // Refused commands used to block the queue, so the moves never finished
+    queue.fill();
+    for (uint16_t i = 0; i < 100 && !queue.isIdle(); ++i) {
+        HostSim::advanceUs(1000);
+        queue.fill();
+    }
+    CHECK(queue.isIdle());
+    CHECK(stepper->hostGetStats().rejected == 0);
+    CHECK(queue.getRejectedCommands() == 0);
+    CHECK(stepper->getCurrentPosition() == position);
+    CHECK(queue.getEndPosition() == position);
+}
+
+int main() {
+    checkProfile(20000, true, true);   // Cruises at V_MAX
+    checkProfile(2000, true, false);   // Reaches the acceleration limit, but not V_MAX
+    checkProfile(100, false, false);   // Jerk phases only
+    checkExecution(20000);
+    checkExecution(100);
+    checkShortCommands();
+    return TEST_RESULT();
+}
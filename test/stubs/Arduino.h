@@ -0,0 +1,160 @@
+#pragma once
+
+// Host replacement of the Arduino core of the ESP32, only what the library uses. Time, pins and the serial ports are simulated, see
+// HostSim.h for controlling them from tests
+
+// Related
+// System / External
+#include <inttypes.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <string>
+// Selfmade
+// Project
+
+using std::abs;
+using std::max;
+using std::min;
+
+#define IRAM_ATTR
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define LSBFIRST 0
+#define MSBFIRST 1
+#define RISING 1
+#define FALLING 2
+#define CHANGE 3
+#define SERIAL_8N1 0x800001c
+
+typedef uint8_t byte;
+
+// Critical sections, the host runs everything in one thread unless a test starts its own
+#define portMUX_TYPE int
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) (void)(mux)
+#define portEXIT_CRITICAL(mux) (void)(mux)
+#define portENTER_CRITICAL_ISR(mux) (void)(mux)
+#define portEXIT_CRITICAL_ISR(mux) (void)(mux)
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+void analogWrite(uint8_t pin, int value);
+uint8_t shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder);
+
+#define digitalPinToInterrupt(pin) (pin)
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode);
+void attachInterruptArg(uint8_t pin, void (*handler)(void *), void *arg, int mode);
+void detachInterrupt(uint8_t pin);
+
+/**
+ * @brief Output base of all serial ports, like Print of the Arduino core
+ *
+ */
+class Print {
+   public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t byte) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    virtual int availableForWrite() { return 0; }
+    size_t write(const char *text) { return text == NULL ? 0 : write((const uint8_t *)text, strlen(text)); }
+    size_t print(const char *text) { return write(text); }
+    size_t println(const char *text = "");
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+/**
+ * @brief Bidirectional byte stream, like Stream of the Arduino core
+ *
+ */
+class Stream : public Print {
+   public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    virtual void flush() {}
+    size_t readBytes(uint8_t *buffer, size_t length);
+};
+
+typedef std::function<void(void)> OnReceiveCb;
+
+/**
+ * @brief Serial port of the ESP32. On the host, transmitted bytes drain at the baud rate in simulated time into a capture buffer or a
+ * file descriptor (e.g. a pty), received bytes come from injected data or the file descriptor
+ *
+ */
+class HardwareSerial : public Stream {
+   private:
+    uint32_t _baud = 115200;         // Baud rate, decides how fast the transmit FIFO drains
+    int _fd = -1;                    // File descriptor bytes are exchanged with, -1 = capture and injection only
+    uint8_t _rx[4096];               // Received bytes not read yet
+    size_t _rxHead = 0;              // Index of the next byte to be read
+    size_t _rxCount = 0;             // Number of received bytes not read yet
+    uint32_t _txFifo = 0;            // Bytes waiting in the simulated transmit FIFO
+    unsigned long _txDrainedUs = 0;  // micros() the FIFO was drained last
+    uint8_t _rxTimeoutSymbols = 2;   // Silence in characters that raises the receive callback
+    OnReceiveCb _onReceive;          // Receive callback, only raised on silence on the host
+
+    /**
+     * @brief Drain the transmit FIFO by the time passed since the last call
+     *
+     */
+    void drainTx();
+
+    /**
+     * @brief Take over everything the file descriptor has received
+     *
+     * @return size_t number of new bytes
+     */
+    size_t pollFd();
+
+   public:
+    static const uint16_t TX_FIFO_LENGTH = 128;  // Hardware transmit FIFO of the ESP32 UART
+    std::string captured;                         // Transmitted bytes while no file descriptor is attached
+    bool capture = false;                         // Flag whether transmitted bytes are kept in captured
+
+    void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1);
+    void end() {}
+    int available() override;
+    int read() override;
+    int peek() override;
+    int availableForWrite() override;
+    size_t write(uint8_t byte) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+    void onReceive(OnReceiveCb function, bool onlyOnTimeout = false);
+    void setRxTimeout(uint8_t symbols);
+
+    // Host simulation
+    void hostAttach(int fd);
+    void hostInject(const uint8_t *data, size_t length);
+
+    /**
+     * @brief Receive from the file descriptor until the line was silent for the receive timeout, then raise the receive callback
+     *
+     * @param waitMs longest time to wait for the first byte in real time
+     * @return true bytes were received and the callback raised
+     * @return false nothing received within waitMs
+     */
+    bool hostPump(uint32_t waitMs);
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
@@ -0,0 +1,125 @@
+#pragma once
+
+// Host replacement of FastAccelStepper. The ramp generator and the command queue are simulated over the simulated time of Arduino.h,
+// so positions and speeds evolve like on the target while handle() is called in a loop
+
+// Related
+// System / External
+#include <Arduino.h>
+#include <stdint.h>
+// Selfmade
+// Project
+
+#define MOVE_OK 0
+#define AQE_OK 0
+#define AQE_QUEUE_FULL 1
+#define AQE_ERROR_TICKS_TOO_LOW -1
+#define TICKS_PER_S 16000000L
+#define MIN_CMD_TICKS (TICKS_PER_S / 5000)
+
+struct stepper_command_s {
+    uint16_t ticks;  // Step period, or the length of a pause if steps is 0
+    uint8_t steps;   // Number of steps, 0 = pause
+    bool count_up;   // Direction
+};
+
+/**
+ * @brief Statistics of the simulation, e.g. to judge whether the queue was fed in time
+ *
+ */
+struct hostStepperStats_s {
+    uint32_t commands;   // Queue commands executed
+    uint32_t drained;    // Times the queue ran empty and the motion stopped, more than once per path means it was fed too late
+    uint32_t rejected;   // Commands refused by addQueueEntry() for being shorter than MIN_CMD_TICKS
+};
+
+class FastAccelStepper {
+   private:
+    static const uint8_t QUEUE_LENGTH = 32;  // Commands of the hardware queue on the ESP32
+
+    enum rampMode_e { RAMP_IDLE, RAMP_RUN, RAMP_MOVE, RAMP_STOP };
+
+    uint8_t _stepPin = 0;             // Pin the stepper is connected to
+    double _position = 0;             // Position in steps, fractional while the ramp generator runs
+    double _speed = 0;                // Speed in steps/s, negative = counting down
+    double _maxSpeed = 1000;          // Speed set via setSpeedInUs() in steps/s
+    double _rampSpeed = 1000;         // Speed the ramp generator works with, taken over by applySpeedAcceleration() and moves
+    double _acceleration = 1000;      // Acceleration in steps/s²
+    rampMode_e _rampMode = RAMP_IDLE;  // Current task of the ramp generator
+    int8_t _runDirection = 1;         // Direction in RAMP_RUN
+    int32_t _target = 0;              // Target in RAMP_MOVE
+    stepper_command_s _queue[QUEUE_LENGTH];  // Command queue
+    uint8_t _queueHead = 0;                  // Index of the running command
+    uint8_t _queueCount = 0;                 // Number of commands in the queue
+    bool _queueRunning = false;              // Flag whether the queue is executed
+    uint64_t _commandTicks = 0;              // Ticks of the running command already executed
+    uint64_t _lastUs = 0;                    // Simulated time of the last update
+    hostStepperStats_s _stats = {0, 0, 0};   // Statistics
+
+    /**
+     * @brief Advance the simulation to the current simulated time
+     *
+     */
+    void update();
+
+    /**
+     * @brief Advance the command queue
+     *
+     * @param ticks time to be simulated in ticks
+     */
+    void updateQueue(uint64_t ticks);
+
+    /**
+     * @brief Advance the ramp generator
+     *
+     * @param seconds time to be simulated in s
+     */
+    void updateRamp(double seconds);
+
+   public:
+    /**
+     * @brief Connect to a step pin, done by FastAccelStepperEngine::stepperConnectToPin()
+     *
+     * @param stepPin step pin
+     */
+    void connect(uint8_t stepPin);
+
+    void setDirectionPin(uint8_t pin) {}
+    void setEnablePin(uint8_t pin) {}
+    int8_t setAcceleration(int32_t acceleration);
+    int8_t setSpeedInUs(uint32_t speedUs);
+    void applySpeedAcceleration();
+    int8_t runForward();
+    int8_t runBackward();
+    int8_t moveTo(int32_t position, bool blocking = false);
+    int8_t move(int32_t steps, bool blocking = false);
+    void stopMove();
+    void forceStopAndNewPosition(int32_t position);
+    int32_t getCurrentPosition();
+    int32_t getCurrentSpeedInUs();
+    int32_t getCurrentSpeedInMilliHz();
+    bool isRampGeneratorActive();
+    bool isRunning();
+    int8_t addQueueEntry(const stepper_command_s *command, bool start = true);
+    bool isQueueFull();
+    bool isQueueEmpty();
+    uint32_t ticksInQueue();
+
+    // Host simulation
+    hostStepperStats_s hostGetStats() { return _stats; }
+    uint8_t hostGetStepPin() { return _stepPin; }
+};
+
+class FastAccelStepperEngine {
+   private:
+    static const uint8_t MAX_STEPPERS = 8;    // Steppers of one engine, stored inline like on the target
+    FastAccelStepper _steppers[MAX_STEPPERS];  // Connected steppers
+    uint8_t _count = 0;                        // Number of connected steppers
+
+   public:
+    void init() {}
+    FastAccelStepper *stepperConnectToPin(uint8_t stepPin);
+
+    // Host simulation, steppers in the order they were connected
+    FastAccelStepper *hostGetStepper(uint8_t index) { return index < _count ? &_steppers[index] : NULL; }
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+// Control of the simulated hardware behind the host stubs, only used by tests and benchmarks
+
+// Related
+// System / External
+#include <stdint.h>
+// Selfmade
+// Project
+
+namespace HostSim {
+const uint8_t PIN_COUNT = 64;  // Simulated GPIOs
+
+/**
+ * @brief Reset time, pins, interrupts and driver states, e.g. at the start of a test
+ *
+ */
+void reset();
+
+/**
+ * @brief Advance the simulated time returned by micros() and millis(), timers of esp_timer.h fire on the way
+ *
+ * @param us time in us
+ */
+void advanceUs(uint64_t us);
+
+// Getter-method, simulated time in us
+uint64_t getTimeUs();
+
+// Getter-method, level last written to a pin
+uint8_t getPinLevel(uint8_t pin);
+
+/**
+ * @brief Raise the interrupt attached to a pin, like a rising edge
+ *
+ * @param pin pin with an attached interrupt
+ * @return true handler called
+ * @return false no interrupt attached
+ */
+bool triggerInterrupt(uint8_t pin);
+
+/**
+ * @brief Set the value the driver on a chip select pin returns as DRV_STATUS
+ *
+ * @param cs chip select pin of the driver
+ * @param status raw register value, see TMC2130_n::DRV_STATUS_t
+ */
+void setDrvStatus(uint8_t cs, uint32_t status);
+
+// Getter-method, SPI transactions of the driver on a chip select pin since reset()
+uint32_t getSpiTransactions(uint8_t cs);
+
+/**
+ * @brief Count a SPI transaction, used by the driver stub
+ *
+ * @param cs chip select pin of the driver
+ * @return uint32_t DRV_STATUS to be returned if the transaction reads it
+ */
+uint32_t transfer(uint8_t cs);
+}  // namespace HostSim
@@ -0,0 +1,626 @@
+// Implementation of the host stubs and the simulation controlled via HostSim.h
+
+// Related
+#include "HostSim.h"
+// System / External
+#include <Arduino.h>
+#include <FastAccelStepper.h>
+#include <SPI.h>
+#include <TMCStepper.h>
+#include <esp_timer.h>
+#include <poll.h>
+#include <unistd.h>
+// Selfmade
+// Project
+
+HardwareSerial Serial;
+HardwareSerial Serial1;
+SPIClass SPI;
+
+/**
+ * @brief Interrupt attached to a pin
+ *
+ */
+struct hostInterrupt_s {
+    void (*handler)(void);       // Handler without argument, attachInterrupt()
+    void (*handlerArg)(void *);  // Handler with argument, attachInterruptArg()
+    void *arg;                   // Argument of handlerArg
+};
+
+static uint64_t hostTimeUs = 0;                             // Simulated time
+static uint8_t hostPins[HostSim::PIN_COUNT];                // Levels last written to the pins
+static hostInterrupt_s hostInterrupts[HostSim::PIN_COUNT];  // Attached interrupts
+static uint32_t hostDrvStatus[HostSim::PIN_COUNT];          // DRV_STATUS per chip select pin
+static uint32_t hostSpiTransactions[HostSim::PIN_COUNT];    // SPI transactions per chip select pin
+
+/**
+ * @brief Timer created via esp_timer_create()
+ *
+ */
+struct hostTimer_s {
+    esp_timer_create_args_t args;  // Callback and its argument
+    uint64_t periodUs;             // Period, 0 = stopped
+    uint64_t nextUs;               // Simulated time the timer fires next
+    bool used;                     // Flag whether the slot holds a created timer
+};
+
+const uint8_t HOST_TIMER_COUNT = 16;              // Timers that can exist at the same time
+static hostTimer_s hostTimers[HOST_TIMER_COUNT];  // Created timers
+
+/*
+ * HostSim
+ */
+
+void HostSim::reset() {
+    hostTimeUs = 0;
+    memset(hostPins, 0, sizeof(hostPins));
+    memset(hostInterrupts, 0, sizeof(hostInterrupts));
+    memset(hostDrvStatus, 0, sizeof(hostDrvStatus));
+    memset(hostSpiTransactions, 0, sizeof(hostSpiTransactions));
+    memset(hostTimers, 0, sizeof(hostTimers));
+}
+
+void HostSim::advanceUs(uint64_t us) {
+    // Fire the timers in order of their due time, a callback sees the time it was due at
+    uint64_t endUs = hostTimeUs + us;
+    while (true) {
+        hostTimer_s *next = NULL;
+        for (uint8_t i = 0; i < HOST_TIMER_COUNT; ++i) {
+            hostTimer_s &timer = hostTimers[i];
+            if (timer.used && timer.periodUs > 0 && timer.nextUs <= endUs && (next == NULL || timer.nextUs < next->nextUs)) next = &timer;
+        }
+        if (next == NULL) break;
+        hostTimeUs = max(hostTimeUs, next->nextUs);
+        next->nextUs += next->periodUs;
+        next->args.callback(next->args.arg);
+    }
+    hostTimeUs = endUs;
+}
+
+uint64_t HostSim::getTimeUs() { return hostTimeUs; }
+
+uint8_t HostSim::getPinLevel(uint8_t pin) { return pin < PIN_COUNT ? hostPins[pin] : 0; }
+
+bool HostSim::triggerInterrupt(uint8_t pin) {
+    if (pin >= PIN_COUNT) return false;
+    hostInterrupt_s &interrupt = hostInterrupts[pin];
+    if (interrupt.handlerArg != NULL) {
+        interrupt.handlerArg(interrupt.arg);
+        return true;
+    }
+    if (interrupt.handler != NULL) {
+        interrupt.handler();
+        return true;
+    }
+    return false;
+}
+
+void HostSim::setDrvStatus(uint8_t cs, uint32_t status) {
+    if (cs < PIN_COUNT) hostDrvStatus[cs] = status;
+}
+
+uint32_t HostSim::getSpiTransactions(uint8_t cs) { return cs < PIN_COUNT ? hostSpiTransactions[cs] : 0; }
+
+uint32_t HostSim::transfer(uint8_t cs) {
+    if (cs >= PIN_COUNT) return 0;
+    hostSpiTransactions[cs]++;
+    return hostDrvStatus[cs];
+}
+
+/*
+ * Arduino core
+ */
+
+unsigned long millis() { return hostTimeUs / 1000; }
+
+unsigned long micros() { return hostTimeUs; }
+
+void delay(uint32_t ms) { HostSim::advanceUs((uint64_t)ms * 1000); }
+
+void delayMicroseconds(uint32_t us) { HostSim::advanceUs(us); }
+
+void pinMode(uint8_t pin, uint8_t mode) {}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+    if (pin < HostSim::PIN_COUNT) hostPins[pin] = value;
+}
+
+int digitalRead(uint8_t pin) { return HostSim::getPinLevel(pin); }
+
+void analogWrite(uint8_t pin, int value) {
+    if (pin < HostSim::PIN_COUNT) hostPins[pin] = value > 0 ? HIGH : LOW;
+}
+
+uint8_t shiftIn(uint8_t dataPin, uint8_t clockPin, uint8_t bitOrder) { return 0; }
+
+void attachInterrupt(uint8_t pin, void (*handler)(void), int mode) {
+    if (pin < HostSim::PIN_COUNT) hostInterrupts[pin] = {handler, NULL, NULL};
+}
+
+void attachInterruptArg(uint8_t pin, void (*handler)(void *), void *arg, int mode) {
+    if (pin < HostSim::PIN_COUNT) hostInterrupts[pin] = {NULL, handler, arg};
+}
+
+void detachInterrupt(uint8_t pin) {
+    if (pin < HostSim::PIN_COUNT) hostInterrupts[pin] = {NULL, NULL, NULL};
+}
+
+/*
+ * esp_timer
+ */
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *handle) {
+    for (uint8_t i = 0; i < HOST_TIMER_COUNT; ++i) {
+        if (hostTimers[i].used) continue;
+        hostTimers[i] = {*args, 0, 0, true};
+        *handle = &hostTimers[i];
+        return ESP_OK;
+    }
+    return ESP_FAIL;
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t periodUs) {
+    if (timer == NULL || !timer->used || timer->periodUs > 0) return ESP_FAIL;  // Like the ESP-IDF, a running timer is not restarted
+    timer->periodUs = max(periodUs, (uint64_t)1);
+    timer->nextUs = hostTimeUs + timer->periodUs;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+    if (timer == NULL || timer->periodUs == 0) return ESP_FAIL;
+    timer->periodUs = 0;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t timer) {
+    if (timer == NULL) return ESP_FAIL;
+    timer->used = false;
+    return ESP_OK;
+}
+
+int64_t esp_timer_get_time() { return hostTimeUs; }
+
+/*
+ * Print / Stream
+ */
+
+size_t Print::write(const uint8_t *buffer, size_t size) {
+    size_t written = 0;
+    while (written < size && write(buffer[written]) == 1) written++;
+    return written;
+}
+
+size_t Print::println(const char *text) { return write(text) + write("\r\n"); }
+
+size_t Print::printf(const char *format, ...) {
+    // Formatted on the stack like logPrint(), so printing never allocates
+    char buffer[512];
+    va_list arg;
+    va_start(arg, format);
+    int len = vsnprintf(buffer, sizeof(buffer), format, arg);
+    va_end(arg);
+    if (len < 0) return 0;
+    return write((const uint8_t *)buffer, min((size_t)len, sizeof(buffer) - 1));
+}
+
+size_t Stream::readBytes(uint8_t *buffer, size_t length) {
+    size_t count = 0;
+    while (count < length && available() > 0) buffer[count++] = read();
+    return count;
+}
+
+/*
+ * HardwareSerial
+ */
+
+void HardwareSerial::drainTx() {
+    unsigned long now = micros();
+    uint64_t drained = (uint64_t)(now - _txDrainedUs) * _baud / 10 / 1000000;  // 10 bits per character
+    if (drained >= _txFifo) {
+        _txFifo = 0;
+        _txDrainedUs = now;
+    } else if (drained > 0) {
+        _txFifo -= drained;
+        _txDrainedUs += drained * 10 * 1000000 / _baud;
+    }
+}
+
+size_t HardwareSerial::pollFd() {
+    if (_fd < 0) return 0;
+    size_t received = 0;
+    while (_rxCount < sizeof(_rx)) {
+        size_t tail = (_rxHead + _rxCount) % sizeof(_rx);
+        size_t space = min(sizeof(_rx) - _rxCount, sizeof(_rx) - tail);
+        ssize_t len = ::read(_fd, _rx + tail, space);
+        if (len <= 0) break;
+        _rxCount += len;
+        received += len;
+    }
+    return received;
+}
+
+void HardwareSerial::begin(unsigned long baud, uint32_t config, int8_t rxPin, int8_t txPin) {
+    _baud = baud;
+    _txFifo = 0;
+    _txDrainedUs = micros();
+}
+
+int HardwareSerial::available() {
+    pollFd();
+    return _rxCount;
+}
+
+int HardwareSerial::read() {
+    if (available() == 0) return -1;
+    uint8_t byte = _rx[_rxHead];
+    _rxHead = (_rxHead + 1) % sizeof(_rx);
+    _rxCount--;
+    return byte;
+}
+
+int HardwareSerial::peek() { return available() > 0 ? _rx[_rxHead] : -1; }
+
+int HardwareSerial::availableForWrite() {
+    drainTx();
+    return TX_FIFO_LENGTH - _txFifo;
+}
+
+size_t HardwareSerial::write(uint8_t byte) { return write(&byte, 1); }
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size) {
+    // Like on the target a write blocks until everything fits into the FIFO, which takes simulated time
+    drainTx();
+    _txFifo += size;
+    if (_txFifo > TX_FIFO_LENGTH) {
+        uint32_t waiting = _txFifo - TX_FIFO_LENGTH;
+        hostTimeUs += (uint64_t)waiting * 10 * 1000000 / _baud;
+        drainTx();
+    }
+
+    if (_fd >= 0) {
+        size_t written = 0;
+        while (written < size) {
+            ssize_t len = ::write(_fd, buffer + written, size - written);
+            if (len <= 0) break;
+            written += len;
+        }
+    } else if (capture) {
+        captured.append((const char *)buffer, size);
+    }
+    return size;
+}
+
+void HardwareSerial::onReceive(OnReceiveCb function, bool onlyOnTimeout) { _onReceive = function; }
+
+void HardwareSerial::setRxTimeout(uint8_t symbols) { _rxTimeoutSymbols = symbols; }
+
+void HardwareSerial::hostAttach(int fd) { _fd = fd; }
+
+void HardwareSerial::hostInject(const uint8_t *data, size_t length) {
+    for (size_t i = 0; i < length && _rxCount < sizeof(_rx); ++i) {
+        _rx[(_rxHead + _rxCount) % sizeof(_rx)] = data[i];
+        _rxCount++;
+    }
+    if (_onReceive) _onReceive();
+}
+
+bool HardwareSerial::hostPump(uint32_t waitMs) {
+    if (_fd < 0) return false;
+    pollfd descriptor = {_fd, POLLIN, 0};
+    if (poll(&descriptor, 1, waitMs) <= 0 || pollFd() == 0) return false;
+
+    // Real time silence of the receive timeout, at least a few ms since the other end is a process scheduled by the host
+    int silenceMs = max(2, (int)((uint64_t)_rxTimeoutSymbols * 10 * 1000 / _baud) + 1);
+    while (poll(&descriptor, 1, silenceMs) > 0 && pollFd() > 0) {
+    }
+    if (_onReceive) _onReceive();
+    return true;
+}
+
+/*
+ * TMC2130Stepper
+ */
+
+void TMC2130Stepper::transfer() { HostSim::transfer(_cs); }
+
+void TMC2130Stepper::begin() {
+    // Like the library, begin() writes the default configuration
+    GCONF(_gconf);
+    CHOPCONF(_chopconf);
+    COOLCONF(_coolconf);
+    PWMCONF(_pwmconf);
+    IHOLD_IRUN(_iholdIrun);
+}
+
+uint32_t TMC2130Stepper::GCONF() {
+    transfer();
+    return _gconf;
+}
+
+void TMC2130Stepper::GCONF(uint32_t value) {
+    transfer();
+    _gconf = value;
+}
+
+void TMC2130Stepper::IHOLD_IRUN(uint32_t value) {
+    transfer();
+    _iholdIrun = value;
+}
+
+void TMC2130Stepper::TPWMTHRS(uint32_t value) {
+    transfer();
+    _tpwmthrs = value;
+}
+
+void TMC2130Stepper::TCOOLTHRS(uint32_t value) {
+    transfer();
+    _tcoolthrs = value;
+}
+
+void TMC2130Stepper::THIGH(uint32_t value) {
+    transfer();
+    _thigh = value;
+}
+
+uint32_t TMC2130Stepper::CHOPCONF() {
+    transfer();
+    return _chopconf;
+}
+
+void TMC2130Stepper::CHOPCONF(uint32_t value) {
+    transfer();
+    _chopconf = value;
+}
+
+void TMC2130Stepper::COOLCONF(uint32_t value) {
+    transfer();
+    _coolconf = value;
+}
+
+void TMC2130Stepper::PWMCONF(uint32_t value) {
+    transfer();
+    _pwmconf = value;
+}
+
+uint32_t TMC2130Stepper::DRV_STATUS() { return HostSim::transfer(_cs); }
+
+void TMC2130Stepper::rms_current(uint16_t currentMa) {
+    // IRUN in 1/32 of the 1.77 A full scale current with vsense set, IHOLD at half of it
+    uint32_t irun = min((uint32_t)31, (uint32_t)currentMa * 32 / 1770);
+    CHOPCONF(_chopconf | (1UL << 17));
+    IHOLD_IRUN((irun / 2) | (irun << 8));
+}
+
+void TMC2130Stepper::microsteps(uint16_t microsteps) {
+    uint32_t mres = 8;
+    while (mres > 0 && (1U << (8 - mres)) < microsteps) mres--;
+    CHOPCONF((_chopconf & ~(0xFUL << 24)) | (mres << 24));
+}
+
+/*
+ * FastAccelStepper
+ */
+
+void FastAccelStepper::connect(uint8_t stepPin) {
+    _stepPin = stepPin;
+    _lastUs = hostTimeUs;
+}
+
+void FastAccelStepper::update() {
+    uint64_t elapsed = hostTimeUs - _lastUs;
+    _lastUs = hostTimeUs;
+    if (_queueRunning) {
+        updateQueue(elapsed * (TICKS_PER_S / 1000000));
+        return;
+    }
+    if (_rampMode == RAMP_IDLE) return;
+
+    // The ramp is integrated in steps of 100 us, fine enough compared to the 10 ms between handle() calls
+    const uint64_t RAMP_STEP_US = 100;
+    while (elapsed > 0 && _rampMode != RAMP_IDLE) {
+        uint64_t step = min(elapsed, RAMP_STEP_US);
+        updateRamp(step / 1e6);
+        elapsed -= step;
+    }
+}
+
+void FastAccelStepper::updateQueue(uint64_t ticks) {
+    while (ticks > 0 && _queueCount > 0) {
+        const stepper_command_s &command = _queue[_queueHead];
+        uint64_t length = command.steps == 0 ? command.ticks : (uint64_t)command.ticks * command.steps;
+        uint64_t taken = min(ticks, length - _commandTicks);
+        if (command.steps > 0) {
+            uint64_t stepsBefore = _commandTicks / command.ticks;
+            uint64_t stepsAfter = (_commandTicks + taken) / command.ticks;
+            _position += (command.count_up ? 1.0 : -1.0) * (stepsAfter - stepsBefore);
+            _speed = (command.count_up ? 1.0 : -1.0) * TICKS_PER_S / command.ticks;
+        } else {
+            _speed = 0;
+        }
+        _commandTicks += taken;
+        ticks -= taken;
+
+        if (_commandTicks >= length) {
+            _queueHead = (_queueHead + 1) % QUEUE_LENGTH;
+            _queueCount--;
+            _commandTicks = 0;
+            _stats.commands++;
+        }
+    }
+    if (_queueCount == 0) {
+        _queueRunning = false;
+        _speed = 0;
+        _stats.drained++;
+    }
+}
+
+void FastAccelStepper::updateRamp(double seconds) {
+    double targetSpeed = 0;
+    switch (_rampMode) {
+        case RAMP_RUN:
+            targetSpeed = _runDirection * _rampSpeed;
+            break;
+        case RAMP_MOVE: {
+            double remaining = _target - _position;
+            double direction = remaining >= 0 ? 1 : -1;
+            double brakeDistance = _speed * _speed / (2 * _acceleration);
+            if (fabs(remaining) <= fmax(0.5, fabs(_speed) * seconds) && brakeDistance <= fabs(remaining) + 1) {
+                _position = _target;
+                _speed = 0;
+                _rampMode = RAMP_IDLE;
+                return;
+            }
+            bool approaching = _speed * direction >= 0;
+            targetSpeed = (approaching && fabs(remaining) <= brakeDistance) ? 0 : direction * _rampSpeed;
+            break;
+        }
+        case RAMP_STOP:
+            targetSpeed = 0;
+            break;
+        default:
+            return;
+    }
+
+    double change = _acceleration * seconds;
+    if (fabs(targetSpeed - _speed) <= change) {
+        _speed = targetSpeed;
+    } else {
+        _speed += targetSpeed > _speed ? change : -change;
+    }
+    _position += _speed * seconds;
+    if (_rampMode == RAMP_STOP && _speed == 0) _rampMode = RAMP_IDLE;
+}
+
+int8_t FastAccelStepper::setAcceleration(int32_t acceleration) {
+    if (acceleration <= 0) return -1;
+    _acceleration = acceleration;
+    return 0;
+}
+
+int8_t FastAccelStepper::setSpeedInUs(uint32_t speedUs) {
+    if (speedUs == 0) return -1;
+    _maxSpeed = 1e6 / speedUs;
+    return 0;
+}
+
+void FastAccelStepper::applySpeedAcceleration() {
+    update();
+    _rampSpeed = _maxSpeed;
+}
+
+int8_t FastAccelStepper::runForward() {
+    update();
+    _rampMode = RAMP_RUN;
+    _runDirection = 1;
+    _rampSpeed = _maxSpeed;
+    return MOVE_OK;
+}
+
+int8_t FastAccelStepper::runBackward() {
+    update();
+    _rampMode = RAMP_RUN;
+    _runDirection = -1;
+    _rampSpeed = _maxSpeed;
+    return MOVE_OK;
+}
+
+int8_t FastAccelStepper::moveTo(int32_t position, bool blocking) {
+    update();
+    _rampMode = RAMP_MOVE;
+    _target = position;
+    _rampSpeed = _maxSpeed;
+    return MOVE_OK;
+}
+
+int8_t FastAccelStepper::move(int32_t steps, bool blocking) {
+    update();
+    return moveTo((_rampMode == RAMP_MOVE ? _target : getCurrentPosition()) + steps, blocking);
+}
+
+void FastAccelStepper::stopMove() {
+    update();
+    if (_rampMode != RAMP_IDLE) _rampMode = RAMP_STOP;
+}
+
+void FastAccelStepper::forceStopAndNewPosition(int32_t position) {
+    _lastUs = hostTimeUs;
+    _rampMode = RAMP_IDLE;
+    _speed = 0;
+    _position = position;
+    _queueCount = 0;
+    _queueRunning = false;
+    _commandTicks = 0;
+}
+
+int32_t FastAccelStepper::getCurrentPosition() {
+    update();
+    return lround(_position);
+}
+
+int32_t FastAccelStepper::getCurrentSpeedInUs() {
+    update();
+    if (fabs(_speed) < 1) return 0;
+    return lround(1e6 / _speed);
+}
+
+int32_t FastAccelStepper::getCurrentSpeedInMilliHz() {
+    update();
+    return lround(_speed * 1000);
+}
+
+bool FastAccelStepper::isRampGeneratorActive() {
+    update();
+    return _rampMode != RAMP_IDLE;
+}
+
+bool FastAccelStepper::isRunning() {
+    update();
+    return _rampMode != RAMP_IDLE || _queueRunning;
+}
+
+int8_t FastAccelStepper::addQueueEntry(const stepper_command_s *command, bool start) {
+    update();
+    if (command != NULL) {
+        if (_queueCount >= QUEUE_LENGTH) return AQE_QUEUE_FULL;
+        // Like on the target, a command has to last at least MIN_CMD_TICKS: the period times the steps, or the pause
+        uint32_t commandTicks = command->steps > 1 ? (uint32_t)command->ticks * command->steps : command->ticks;
+        if (commandTicks < MIN_CMD_TICKS) {
+            _stats.rejected++;
+            return AQE_ERROR_TICKS_TOO_LOW;
+        }
+        _queue[(_queueHead + _queueCount) % QUEUE_LENGTH] = *command;
+        _queueCount++;
+    }
+    if (start && !_queueRunning && _queueCount > 0) {
+        _queueRunning = true;
+        _commandTicks = 0;
+    }
+    return AQE_OK;
+}
+
+bool FastAccelStepper::isQueueFull() {
+    update();
+    return _queueCount >= QUEUE_LENGTH;
+}
+
+bool FastAccelStepper::isQueueEmpty() {
+    update();
+    return _queueCount == 0;
+}
+
+uint32_t FastAccelStepper::ticksInQueue() {
+    update();
+    uint64_t ticks = 0;
+    for (uint8_t i = 0; i < _queueCount; ++i) {
+        const stepper_command_s &command = _queue[(_queueHead + i) % QUEUE_LENGTH];
+        ticks += command.steps == 0 ? command.ticks : (uint64_t)command.ticks * command.steps;
+    }
+    return ticks - (_queueCount > 0 ? _commandTicks : 0);
+}
+
+FastAccelStepper *FastAccelStepperEngine::stepperConnectToPin(uint8_t stepPin) {
+    if (_count >= MAX_STEPPERS) return NULL;
+    FastAccelStepper *stepper = &_steppers[_count++];
+    stepper->connect(stepPin);
+    return stepper;
+}
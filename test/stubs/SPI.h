@@ -0,0 +1,16 @@
+#pragma once
+
+// Host replacement of the SPI driver, transactions are simulated by TMCStepper.h
+
+// Related
+// System / External
+#include <stdint.h>
+// Selfmade
+// Project
+
+class SPIClass {
+   public:
+    void begin() {}
+};
+
+extern SPIClass SPI;
@@ -0,0 +1,70 @@
+#pragma once
+
+// Host replacement of the TMC2130 driver. Registers are kept in memory, every access that would cause SPI traffic on the real driver
+// is counted per chip select pin, and DRV_STATUS returns what a test set via HostSim::setDrvStatus()
+
+// Related
+// System / External
+#include <Arduino.h>
+#include <SPI.h>
+#include <stdint.h>
+// Selfmade
+// Project
+
+namespace TMC2130_n {
+struct DRV_STATUS_t {
+    union {
+        uint32_t sr;
+        struct {
+            uint32_t sg_result : 10, : 5;
+            uint32_t fsactive : 1;
+            uint32_t cs_actual : 5, : 3;
+            uint32_t stallGuard : 1, ot : 1, otpw : 1, s2ga : 1, s2gb : 1, ola : 1, olb : 1, stst : 1;
+        };
+    };
+};
+}  // namespace TMC2130_n
+
+class TMC2130Stepper {
+   private:
+    uint16_t _cs;                // Chip select pin, identifies the driver in the simulation
+    uint32_t _gconf = 0;         // GCONF
+    uint32_t _iholdIrun = 0;     // IHOLD_IRUN, write only
+    uint32_t _tpwmthrs = 0;      // TPWMTHRS, write only
+    uint32_t _tcoolthrs = 0;     // TCOOLTHRS, write only
+    uint32_t _thigh = 0;         // THIGH, write only
+    uint32_t _chopconf = 0;      // CHOPCONF
+    uint32_t _coolconf = 0;      // COOLCONF, write only
+    uint32_t _pwmconf = 0;       // PWMCONF, write only
+
+    /**
+     * @brief Count a SPI transaction of this driver
+     *
+     */
+    void transfer();
+
+   public:
+    TMC2130Stepper(uint16_t pinCs) : _cs(pinCs) {}
+    void begin();
+
+    uint32_t GCONF();
+    void GCONF(uint32_t value);
+    uint32_t IHOLD_IRUN() { return _iholdIrun; }
+    void IHOLD_IRUN(uint32_t value);
+    uint32_t TPWMTHRS() { return _tpwmthrs; }
+    void TPWMTHRS(uint32_t value);
+    uint32_t TCOOLTHRS() { return _tcoolthrs; }
+    void TCOOLTHRS(uint32_t value);
+    uint32_t THIGH() { return _thigh; }
+    void THIGH(uint32_t value);
+    uint32_t CHOPCONF();
+    void CHOPCONF(uint32_t value);
+    uint32_t COOLCONF() { return _coolconf; }
+    void COOLCONF(uint32_t value);
+    uint32_t PWMCONF() { return _pwmconf; }
+    void PWMCONF(uint32_t value);
+    uint32_t DRV_STATUS();
+
+    void rms_current(uint16_t currentMa);
+    void microsteps(uint16_t microsteps);
+};
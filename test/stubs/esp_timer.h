@@ -0,0 +1,33 @@
+#pragma once
+
+// Host replacement of the high resolution timer of the ESP-IDF. Periodic timers fire while the simulated time advances, see
+// HostSim::advanceUs()
+
+// Related
+// System / External
+#include <stdint.h>
+// Selfmade
+// Project
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+typedef void (*esp_timer_cb_t)(void *arg);
+typedef struct hostTimer_s *esp_timer_handle_t;
+
+typedef enum { ESP_TIMER_TASK } esp_timer_dispatch_t;
+
+typedef struct {
+    esp_timer_cb_t callback;               // Function called when the timer fires
+    void *arg;                             // Argument of the callback
+    esp_timer_dispatch_t dispatch_method;  // Only ESP_TIMER_TASK on the host
+    const char *name;                      // Name for debugging
+    bool skip_unhandled_events;            // Ignored on the host, events are never late
+} esp_timer_create_args_t;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *handle);
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t timer, uint64_t periodUs);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+esp_err_t esp_timer_delete(esp_timer_handle_t timer);
+int64_t esp_timer_get_time();
@@ -0,0 +1,99 @@
+/**
+ * @brief Host test of the spool diameter estimation against a simulated winding, run via "make -C test"
+ *
+ * A puller feeds the line at a constant speed, a spool follows it and grows with the wound line. The line tension is modelled by
+ * the reported load: a spool surface faster than the line pulls and reads as full load, a slower one as light load. The follower has
+ * to find the spool speed through the estimated diameter, since the growth needs more speed change than the load trim allows.
+ */
+
+// Related
+// System / External
+#include <Arduino.h>
+#include <FastAccelStepper.h>
+#include <HostSim.h>
+#include <math.h>
+// Selfmade
+// Project
+#include "../src/controller/stepper/Stepper.h"
+#include "HostTest.h"
+
+const uint32_t HANDLE_PERIOD_US = 10000;  // Simulated time between two handle()-calls
+const uint32_t WINDING_CALLS = 12000;     // handle()-calls of the winding, 120 s of simulated time
+const uint8_t SPOOL_CS_PIN = 13;          // Chip select of the spool
+const uint8_t PULLER_CS_PIN = 2;          // Chip select of the puller
+const uint32_t STATUS_IDLE = 600;         // DRV_STATUS with a StallGuard value of light load
+const uint32_t STATUS_STALLED = 0;        // DRV_STATUS with a StallGuard value of full load
+const float PULLER_RPM = 30;              // Line speed as puller speed, 3000 mm/min
+const float CORE_DIAMETER = 50;           // Diameter of the empty spool in mm
+const float MAX_DIAMETER = 150;           // Diameter of the full spool in mm
+const float GROWTH_PER_MM = 1.0 / 120;    // Diameter growth per wound line in mm, 50 mm more after 6 m
+const float FIXED_RATIO = 0.5;            // Fixed ratio set while estimating, must be used again once the estimation is disabled
+
+stepperConfiguration_s spoolConfig = {.stepperId = "spool",
+                                      .maxCurrent = 700,
+                                      .microstepsPerStep = 32,
+                                      .stepsPerRotation = 200,
+                                      .mmPerRotation = 8,
+                                      .gearRatio = 1,
+                                      .stall = 5,
+                                      .pins = {.en = 12, .dir = 14, .step = 17, .cs = SPOOL_CS_PIN, .diag = 0}};
+stepperConfiguration_s pullerConfig = {.stepperId = "puller",
+                                       .maxCurrent = 700,
+                                       .microstepsPerStep = 32,
+                                       .stepsPerRotation = 200,
+                                       .mmPerRotation = 100,
+                                       .gearRatio = 1,
+                                       .stall = 8,
+                                       .pins = {.en = 12, .dir = 16, .step = 26, .cs = PULLER_CS_PIN, .diag = 0}};
+
+int main() {
+    HostSim::reset();
+    HostSim::setDrvStatus(SPOOL_CS_PIN, STATUS_IDLE);
+    HostSim::setDrvStatus(PULLER_CS_PIN, STATUS_IDLE);
+    FastAccelStepperEngine engine;
+    Stepper spool(spoolConfig, &engine);
+    Stepper puller(pullerConfig, &engine);
+    engine.init();
+    puller.init();
+    spool.init();
+
+    puller.moveRotate(PULLER_RPM);
+    spool.moveFollow(&puller, 1, 30);
+    spool.getGearing().enableDiameterEstimation(CORE_DIAMETER, MAX_DIAMETER);
+    spool.getGearing().adjustFollowRatio(FIXED_RATIO);  // Only kept for later, the estimate is in use
+    CHECK_NEAR(spool.getGearing().getFollowRatio(), pullerConfig.mmPerRotation / (M_PI * CORE_DIAMETER), 0.001);
+
+    float lineStart = puller.getCurrentRotations() * pullerConfig.mmPerRotation;
+    float diameter = CORE_DIAMETER;
+    float maxError = 0;
+    for (uint32_t i = 0; i < WINDING_CALLS; ++i) {
+        puller.handle();
+        spool.handle();
+        HostSim::advanceUs(HANDLE_PERIOD_US);
+
+        diameter = CORE_DIAMETER + (puller.getCurrentRotations() * pullerConfig.mmPerRotation - lineStart) * GROWTH_PER_MM;
+        float lineSpeed = puller.getCurrentRpm() * pullerConfig.mmPerRotation;
+        float surfaceSpeed = spool.getCurrentRpm() * M_PI * diameter;
+        HostSim::setDrvStatus(SPOOL_CS_PIN, surfaceSpeed > lineSpeed ? STATUS_STALLED : STATUS_IDLE);
+
+        // After the first measurements the estimate has to keep up with the growing spool
+        if (i >= WINDING_CALLS / 4) maxError = fmaxf(maxError, fabsf(spool.getStatus().diameter - diameter) / diameter);
+    }
+    CHECK(diameter > CORE_DIAMETER * 1.9);
+    CHECK(maxError < 0.05);
+    float lineSpeed = PULLER_RPM * pullerConfig.mmPerRotation;
+    CHECK_NEAR(spool.getCurrentRpm() * M_PI * diameter, lineSpeed, lineSpeed * 0.05);
+
+    // Back to the fixed ratio, only the trim is added on top
+    spool.getGearing().disableDiameterEstimation();
+    CHECK_NEAR(spool.getGearing().getFollowRatio(), FIXED_RATIO, 0.0001);
+    HostSim::setDrvStatus(SPOOL_CS_PIN, STATUS_IDLE);
+    for (uint32_t i = 0; i < 100; ++i) {
+        puller.handle();
+        spool.handle();
+        HostSim::advanceUs(HANDLE_PERIOD_US);
+    }
+    CHECK_NEAR(spool.getCurrentRpm(), PULLER_RPM * FIXED_RATIO, 5.5);
+    CHECK_NEAR(spool.getStatus().diameter, 0, 0.0001);
+    return TEST_RESULT();
+}
@@ -0,0 +1,85 @@
+/**
+ * @brief Converts binary stepper trace dumps (see Stepper::dumpTrace()) into csv
+ *
+ * Build: g++ -o stepperTraceToCsv tools/stepperTraceToCsv.cpp src/controller/stepper/StepperTest.cpp
+ * Usage: stepperTraceToCsv < serial_capture.bin > trace.csv
+ *
+ * The input may contain arbitrary other serial output, every dump found in it is converted.
+ */
+
+// Related
+// System / External
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+// Selfmade
+// Project
+#include "../src/controller/stepper/StepperTest.h"
+#include "../src/controller/stepper/StepperTrace.h"
+
+/**
+ * @brief Read exactly length bytes from a file
+ *
+ * @param file file to read from
+ * @param out memory location to write the bytes to
+ * @param length number of bytes to read
+ * @return true all bytes read
+ * @return false end of file reached before
+ */
+bool readExactly(FILE *file, void *out, size_t length) { return fread(out, 1, length, file) == length; }
+
+/**
+ * @brief Convert the samples following an already parsed header into csv lines
+ *
+ * @param file file positioned at the first sample
+ * @param header header of the dump
+ * @return true dump converted
+ * @return false dump was truncated or malformed
+ */
+bool convertDump(FILE *file, const stepperTraceHeader_s &header) {
+    if (header.version != STEPPER_TRACE_VERSION || header.sampleSize != sizeof(stepperTraceSample_s)) {
+        fprintf(stderr, "Unsupported trace format (version %u, sample size %u)\n", header.version, header.sampleSize);
+        return false;
+    }
+
+    const char *id = header.stepperId;
+    for (uint16_t i = 0; i < header.sampleCount; ++i) {
+        stepperTraceSample_s sample;
+        if (!readExactly(file, &sample, sizeof(sample))) {
+            fprintf(stderr, "Trace of '%s' truncated after %u samples\n", id, i);
+            return false;
+        }
+        char mode[20] = "UNKNOWN";
+        if (sample.mode <= PATH) modeToString((stepperMode_e)sample.mode, mode);
+        printf("%s,%u,%u,%d,%d,%u,%s,%u,%d,%d,%d,%d,%d,%d,%d\n", id, i, sample.timeUs, sample.speedUs, sample.position, sample.stall,
+               mode, sample.load, (sample.flags & TRACE_FLAG_STALLGUARD) != 0, (sample.flags & TRACE_FLAG_OVERHEATING) != 0,
+               (sample.flags & TRACE_FLAG_SHUTDOWN_HEAT) != 0, (sample.flags & TRACE_FLAG_SHORT_CIRCUIT) != 0,
+               (sample.flags & TRACE_FLAG_OPEN_LOAD) != 0, (sample.flags & TRACE_FLAG_STANDSTILL) != 0,
+               (sample.flags & TRACE_FLAG_TRIGGER) != 0);
+    }
+    return true;
+}
+
+int main() {
+    printf("stepper,index,timeUs,speedUs,position,stall,mode,load,stallguard,overheating,shutdownHeat,shortCircuit,openLoad,standstill,"
+           "trigger\n");
+
+    // Scan byte by byte for the magic number, then read the rest of the header
+    uint32_t window = 0;
+    int byte;
+    uint16_t dumps = 0;
+    while ((byte = fgetc(stdin)) != EOF) {
+        window = (window >> 8) | ((uint32_t)byte << 24);
+        if (window != STEPPER_TRACE_MAGIC) continue;
+
+        stepperTraceHeader_s header;
+        header.magic = window;
+        if (!readExactly(stdin, (uint8_t *)&header + sizeof(header.magic), sizeof(header) - sizeof(header.magic))) break;
+        header.stepperId[sizeof(header.stepperId) - 1] = '\0';
+        if (convertDump(stdin, header)) dumps++;
+        window = 0;
+    }
+
+    fprintf(stderr, "%u trace dump(s) converted\n", dumps);
+    return dumps > 0 ? 0 : 1;
+}
@@ -0,0 +1,211 @@
+/**
+ * @brief Converts binary telemetry frames (see TelemetryPublisher) into csv
+ *
+ * Build: g++ -o telemetryToCsv tools/telemetryToCsv.cpp src/utils/Utils.cpp
+ * Usage: telemetryToCsv < serial_capture.bin > telemetry.csv
+ *        stty -F /dev/ttyUSB0 115200 raw && telemetryToCsv < /dev/ttyUSB0
+ *
+ * Every frame becomes one line with the latest value of every channel, groups not sampled in a frame keep their previous value.
+ * Other zero-delimited output on the same line, e.g. acks of the CommandProtocol, is skipped by its length and CRC.
+ */
+
+// Related
+// System / External
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+// Selfmade
+// Project
+#include "../src/protocol/TelemetryFormat.h"
+#include "../src/utils/Utils.h"
+
+const uint16_t MAX_FRAME_LENGTH = 1024;  // Longer frames are skipped
+const uint16_t MAX_CHANNELS = 256;       // Channels of all controllers together
+
+// Column names and scale of the channels of each controller kind, in the order of the channel enums
+const char *STEPPER_NAMES[TELEMETRY_STEPPER_CHANNELS] = {"rpm", "load", "positionMm", "current", "errors", "diameterMm", "mode"};
+const float STEPPER_SCALES[TELEMETRY_STEPPER_CHANNELS] = {100, 1, 1, 1, 1, 10, 1};
+const char *HEATER_NAMES[TELEMETRY_HEATER_CHANNELS] = {"temperature", "target", "pidMs", "heating"};
+const float HEATER_SCALES[TELEMETRY_HEATER_CHANNELS] = {100, 100, 1, 1};
+const char *MOTOR_NAMES[TELEMETRY_MOTOR_CHANNELS] = {"rpm", "position"};
+const float MOTOR_SCALES[TELEMETRY_MOTOR_CHANNELS] = {100, 1};
+
+/**
+ * @brief State of the decoder, carried from frame to frame
+ *
+ */
+struct decoderState_s {
+    bool synchronised;             // Flag whether a keyframe was received since the last gap
+    uint8_t counts[3];             // Steppers, heaters and motors of the current layout
+    uint16_t nextSequence;         // Sequence number expected next
+    uint32_t timeMs;               // Time of the last frame
+    int32_t values[MAX_CHANNELS];  // Latest value of every channel
+    float scales[MAX_CHANNELS];    // Divisor of every channel to get its unit
+    uint16_t channelCount;         // Channels of the current layout
+    uint32_t frames;               // Decoded frames
+    uint32_t skipped;              // Frames skipped while not synchronised
+    uint32_t invalid;              // Zero-delimited chunks that were no telemetry frame
+};
+
+/**
+ * @brief Print the csv header of a layout and remember the scale of its channels
+ *
+ * @param state decoder state, counts already set
+ */
+void startLayout(decoderState_s &state) {
+    state.channelCount = 0;
+    printf("timeMs");
+    for (uint8_t i = 0; i < state.counts[0]; ++i) {
+        for (uint8_t c = 0; c < TELEMETRY_STEPPER_CHANNELS; ++c) {
+            printf(",stepper%u_%s", i, STEPPER_NAMES[c]);
+            state.scales[state.channelCount++] = STEPPER_SCALES[c];
+        }
+    }
+    for (uint8_t i = 0; i < state.counts[1]; ++i) {
+        for (uint8_t c = 0; c < TELEMETRY_HEATER_CHANNELS; ++c) {
+            printf(",heater%u_%s", i, HEATER_NAMES[c]);
+            state.scales[state.channelCount++] = HEATER_SCALES[c];
+        }
+    }
+    for (uint8_t i = 0; i < state.counts[2]; ++i) {
+        for (uint8_t c = 0; c < TELEMETRY_MOTOR_CHANNELS; ++c) {
+            printf(",motor%u_%s", i, MOTOR_NAMES[c]);
+            state.scales[state.channelCount++] = MOTOR_SCALES[c];
+        }
+    }
+    printf("\n");
+}
+
+/**
+ * @brief Read the channels of one group from the frame
+ *
+ * @param state decoder state
+ * @param data frame
+ * @param length size of the frame without CRC
+ * @param offset current position in the frame, advanced by the read values
+ * @param first index of the first channel of the group
+ * @param count number of channels of the group
+ * @param keyframe true = absolute values, false = differences
+ * @return true read
+ * @return false frame truncated
+ */
+bool readGroup(decoderState_s &state, const uint8_t *data, uint16_t length, uint16_t &offset, uint16_t first, uint16_t count,
+               bool keyframe) {
+    for (uint16_t channel = first; channel < first + count; ++channel) {
+        uint32_t code;
+        size_t read = varintDecode(data + offset, length - offset, code);
+        if (read == 0) return false;
+        offset += read;
+        int32_t value = zigzagDecode(code);
+        state.values[channel] = keyframe ? value : (int32_t)((uint32_t)state.values[channel] + (uint32_t)value);
+    }
+    return true;
+}
+
+/**
+ * @brief Decode one zero-delimited chunk and print it if it is a telemetry frame
+ *
+ * @param state decoder state
+ * @param data COBS encoded chunk, decoded in place
+ * @param length size of the chunk
+ */
+void decodeFrame(decoderState_s &state, uint8_t *data, uint16_t length) {
+    length = cobsDecode(data, length);
+    if (length < TELEMETRY_HEADER_SIZE + 3 || data[0] != TELEMETRY_SCHEMA) {
+        state.invalid++;
+        return;
+    }
+    length -= 2;
+    if (crc16Ccitt(data, length) != (data[length] | data[length + 1] << 8)) {
+        state.invalid++;
+        return;
+    }
+
+    uint16_t sequence = data[4] | data[5] << 8;
+    uint8_t flags = data[6];
+    bool keyframe = flags & TELEMETRY_KEYFRAME;
+    uint16_t channels = data[1] * TELEMETRY_STEPPER_CHANNELS + data[2] * TELEMETRY_HEATER_CHANNELS + data[3] * TELEMETRY_MOTOR_CHANNELS;
+    if (channels > MAX_CHANNELS) {
+        state.invalid++;
+        return;
+    }
+
+    // Differences are only usable on top of a complete history
+    if (memcmp(state.counts, data + 1, 3) != 0) {
+        state.synchronised = false;
+        if (keyframe) {
+            memcpy(state.counts, data + 1, 3);
+            startLayout(state);
+        }
+    }
+    if (!keyframe && (!state.synchronised || sequence != state.nextSequence)) {
+        if (state.synchronised) fprintf(stderr, "Frame(s) lost before sequence %u, waiting for the next keyframe\n", sequence);
+        state.synchronised = false;
+        state.skipped++;
+        return;
+    }
+    state.synchronised = true;
+    state.nextSequence = sequence + 1;
+
+    uint16_t offset = TELEMETRY_HEADER_SIZE;
+    uint32_t time;
+    size_t read = varintDecode(data + offset, length - offset, time);
+    if (read == 0) return;
+    offset += read;
+    state.timeMs = keyframe ? time : state.timeMs + time;
+
+    uint16_t stepperChannels = state.counts[0] * TELEMETRY_STEPPER_CHANNELS;
+    uint16_t heaterChannels = state.counts[1] * TELEMETRY_HEATER_CHANNELS;
+    uint16_t motorChannels = state.counts[2] * TELEMETRY_MOTOR_CHANNELS;
+    bool complete = true;
+    if (flags & TELEMETRY_STEPPERS) complete &= readGroup(state, data, length, offset, 0, stepperChannels, keyframe);
+    if (flags & TELEMETRY_HEATERS) complete &= readGroup(state, data, length, offset, stepperChannels, heaterChannels, keyframe);
+    if (flags & TELEMETRY_MOTORS) {
+        complete &= readGroup(state, data, length, offset, stepperChannels + heaterChannels, motorChannels, keyframe);
+    }
+    if (!complete || offset != length) {
+        fprintf(stderr, "Malformed frame %u\n", sequence);
+        state.synchronised = false;
+        return;
+    }
+
+    state.frames++;
+    printf("%u", state.timeMs);
+    for (uint16_t channel = 0; channel < state.channelCount; ++channel) {
+        if (state.values[channel] == TELEMETRY_NO_VALUE) {
+            printf(",");
+        } else if (state.scales[channel] == 1) {
+            printf(",%d", state.values[channel]);
+        } else {
+            printf(",%.2f", state.values[channel] / state.scales[channel]);
+        }
+    }
+    printf("\n");
+}
+
+int main() {
+    static decoderState_s state;
+    static uint8_t frame[MAX_FRAME_LENGTH];
+    uint16_t length = 0;
+    bool overlong = false;
+
+    int byte;
+    while ((byte = fgetc(stdin)) != EOF) {
+        if (byte != 0) {
+            if (length < MAX_FRAME_LENGTH) {
+                frame[length++] = byte;
+            } else {
+                overlong = true;
+            }
+            continue;
+        }
+        if (length > 0 && !overlong) decodeFrame(state, frame, length);
+        length = 0;
+        overlong = false;
+        fflush(stdout);
+    }
+
+    fprintf(stderr, "%u frames decoded, %u skipped while waiting for a keyframe, %u other chunks ignored\n", state.frames, state.skipped,
+            state.invalid);
+    return 0;
+}